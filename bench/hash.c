@@ -0,0 +1,358 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pizza/memory.h"
+#include "pizza/timer.h"
+#include "pizza/hash.h"
+#include "pizza/hashmap.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BENCH_RDTSC 1
+#include <x86intrin.h>
+#else
+#define BENCH_RDTSC 0
+#endif
+
+/*
+ * Compare the hash functions in hash.h, on speed and on quality:
+ *
+ * speed: cycles per byte for keys from 4 bytes to 1 MiB; cycles come from
+ *   the time stamp counter, which ticks at a fixed rate that can differ from
+ *   the actual clock of the core.  Without it, ns per byte are shown.
+ *
+ * collisions: for several sets of keys, how many keys collide on the low 32
+ *   bits of the hash, and how many land in an already used bucket, for a
+ *   table with 2^20 buckets indexed by low or by high bits; as a percentage
+ *   of what a random function would give.
+ *
+ * avalanche: flipping any input bit should flip each output bit half of the
+ *   time; the worst bias found, as a percentage, for keys of a few lengths.
+ *
+ * hash_wang() and hash_pcg() hash a single 32-bit integer, so they are only
+ * used with 4-byte keys.
+ */
+
+#define SPEED_BYTES     (16 * 1024 * 1024)  // bytes hashed for each length
+#define SPEED_ROUNDS    5                   // best of these many runs
+#define KEY_COUNT       1000000             // keys in each key set
+#define BUCKET_BITS     20                  // bits for the bucket index
+#define AVALANCHE_KEYS  10000               // random keys for each length
+
+typedef uint64_t (HashFunc)(const char* str, size_t len);
+
+typedef struct Hash {
+    const char* name;
+    HashFunc* func;
+    unsigned bits;      // bits in the hash value
+    unsigned int_only;  // only hashes 4-byte keys
+} Hash;
+
+static uint64_t run_djb2(const char* str, size_t len) {
+    return hash_djb2(str, len);
+}
+
+static uint64_t run_murmur3(const char* str, size_t len) {
+    return hash_murmur3(str, len, 0);
+}
+
+static uint64_t run_wang(const char* str, size_t len) {
+    uint32_t v = 0;
+    memcpy(&v, str, len < 4 ? len : 4);
+    return hash_wang(v);
+}
+
+static uint64_t run_pcg(const char* str, size_t len) {
+    uint32_t v = 0;
+    memcpy(&v, str, len < 4 ? len : 4);
+    return hash_pcg(v);
+}
+
+static uint64_t run_xxh3_64(const char* str, size_t len) {
+    return hash_xxh3_64(str, len, 0);
+}
+
+static uint64_t run_xxh3_128(const char* str, size_t len) {
+    Hash128 h = hash_xxh3_128(str, len, 0);
+    return h.lo ^ h.hi;
+}
+
+static const Hash hashes[] = {
+    { "djb2",     run_djb2,     32, 0 },
+    { "murmur3",  run_murmur3,  32, 0 },
+    { "wang",     run_wang,     32, 1 },
+    { "pcg",      run_pcg,      32, 1 },
+    { "xxh3_64",  run_xxh3_64,  64, 0 },
+    { "xxh3_128", run_xxh3_128, 64, 0 },
+};
+#define HASH_COUNT (sizeof(hashes) / sizeof(hashes[0]))
+
+static uint64_t rng_state = 0x9e3779b97f4a7c15ULL;
+
+static uint64_t rng_next(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static void rng_fill(char* ptr, size_t len) {
+    for (size_t j = 0; j < len; ++j) {
+        ptr[j] = (char) (rng_next() >> 56);
+    }
+}
+
+static inline uint64_t ticks(void) {
+#if BENCH_RDTSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static void bench_speed(void) {
+    static const size_t lengths[] = { 4, 8, 16, 32, 64, 256, 1024, 4096, 65536, 1024 * 1024 };
+    size_t max = lengths[sizeof(lengths) / sizeof(lengths[0]) - 1];
+    char* data = (char*) memory_realloc(0, max + 64);
+    rng_fill(data, max + 64);
+
+    printf("# speed: %s per byte\n", BENCH_RDTSC ? "cycles" : "ns");
+    printf("%-10s", "hash");
+    for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); ++l) {
+        size_t len = lengths[l];
+        char label[16];
+        if (len >= 1024 * 1024) {
+            sprintf(label, "%zuM", len / (1024 * 1024));
+        } else if (len >= 1024) {
+            sprintf(label, "%zuK", len / 1024);
+        } else {
+            sprintf(label, "%zu", len);
+        }
+        printf(" %7s", label);
+    }
+    printf("\n");
+
+    uint64_t sum = 0;
+    for (size_t h = 0; h < HASH_COUNT; ++h) {
+        printf("%-10s", hashes[h].name);
+        for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); ++l) {
+            size_t len = lengths[l];
+            if (hashes[h].int_only && len != 4) {
+                printf(" %7s", "-");
+                continue;
+            }
+            size_t count = SPEED_BYTES / len;
+            double best = 0;
+            for (int r = 0; r < SPEED_ROUNDS; ++r) {
+                Timer t;
+                timer_start(&t);
+                uint64_t start = ticks();
+                for (size_t j = 0; j < count; ++j) {
+                    // move around a bit, so that keys are not all the same
+                    sum += hashes[h].func(data + (j & 63), len);
+                }
+                uint64_t cycles = ticks() - start;
+                timer_stop(&t);
+                double per_byte = (double) (BENCH_RDTSC ? cycles : timer_elapsed_ns(&t)) / (double) (count * len);
+                if (r == 0 || per_byte < best) {
+                    best = per_byte;
+                }
+            }
+            printf(" %7.2f", best);
+        }
+        printf("\n");
+    }
+    memory_realloc(data, 0);
+    // so that nothing is optimized away
+    if (sum == 42) {
+        printf("\n");
+    }
+}
+
+// Key sets for the collision tests; each key is at most 32 bytes.
+#define KEY_MAX 32
+
+typedef struct KeySet {
+    const char* name;
+    unsigned int_only;  // keys are 4 bytes long
+} KeySet;
+
+static const KeySet key_sets[] = {
+    { "int-seq",   1 },  // 0, 1, 2, ... as 4 bytes
+    { "int-step",  1 },  // multiples of 1024, as 4 bytes
+    { "int-rand",  1 },  // random 4 bytes
+    { "u64-seq",   0 },  // 0, 1, 2, ... as 8 bytes
+    { "decimal",   0 },  // "0", "1", "2", ...
+    { "user-id",   0 },  // "user:1000000", "user:1000001", ...
+    { "path",      0 },  // "/api/v1/items/0/details", ...
+    { "word",      0 },  // random lowercase words, 3 to 12 letters
+};
+#define KEY_SET_COUNT (sizeof(key_sets) / sizeof(key_sets[0]))
+
+static size_t make_key(int set, uint32_t j, char* key) {
+    switch (set) {
+        case 0:
+            memcpy(key, &j, 4);
+            return 4;
+        case 1: {
+            uint32_t v = j * 1024;
+            memcpy(key, &v, 4);
+            return 4;
+        }
+        case 2: {
+            uint32_t v = (uint32_t) rng_next();
+            memcpy(key, &v, 4);
+            return 4;
+        }
+        case 3: {
+            uint64_t v = j;
+            memcpy(key, &v, 8);
+            return 8;
+        }
+        case 4:
+            return sprintf(key, "%u", j);
+        case 5:
+            return sprintf(key, "user:%u", 1000000 + j);
+        case 6:
+            return sprintf(key, "/api/v1/items/%u/details", j);
+        default: {
+            size_t len = 3 + rng_next() % 10;
+            for (size_t k = 0; k < len; ++k) {
+                key[k] = 'a' + rng_next() % 26;
+            }
+            return len;
+        }
+    }
+}
+
+static int compare_u32(const void* l, const void* r) {
+    uint32_t a = *(const uint32_t*) l;
+    uint32_t b = *(const uint32_t*) r;
+    return a < b ? -1 : a > b;
+}
+
+// Keys that land in a bucket already used by an earlier key.
+static size_t bucket_collisions(const uint32_t* hashes32, size_t count, int high) {
+    static uint8_t used[1 << BUCKET_BITS];
+    memset(used, 0, sizeof(used));
+    size_t collisions = 0;
+    for (size_t j = 0; j < count; ++j) {
+        uint32_t b = high ? hashes32[j] >> (32 - BUCKET_BITS) : hashes32[j] & ((1U << BUCKET_BITS) - 1);
+        collisions += used[b];
+        used[b] = 1;
+    }
+    return collisions;
+}
+
+static void bench_collisions(void) {
+    char (*keys)[KEY_MAX] = memory_realloc(0, KEY_COUNT * KEY_MAX);
+    size_t* lens = (size_t*) memory_realloc(0, KEY_COUNT * sizeof(size_t));
+    uint32_t* hashes32 = (uint32_t*) memory_realloc(0, KEY_COUNT * sizeof(uint32_t));
+
+    // what a random function would give
+    double n = KEY_COUNT;
+    double buckets = 1 << BUCKET_BITS;
+    double expected_hash = n * (n - 1) / 2 / 4294967296.0;
+    double expected_bucket = n - buckets * (1 - pow(1 - 1 / buckets, n));
+
+    printf("# collisions: %d keys, %% of what a random function gives\n", KEY_COUNT);
+    printf("# (32-bit: %.1f expected; %d buckets: %.0f expected)\n",
+           expected_hash, 1 << BUCKET_BITS, expected_bucket);
+    printf("%-10s %-10s %10s %10s %10s\n", "keys", "hash", "32-bit", "low", "high");
+    for (size_t s = 0; s < KEY_SET_COUNT; ++s) {
+        // distinct keys only; random sets could repeat some
+        HashMap seen; hashmap_build(&seen, HASHMAP_KEY_SLICE, 0);
+        size_t count = 0;
+        rng_state = 0x9e3779b97f4a7c15ULL;
+        for (uint32_t j = 0; count < KEY_COUNT; ++j) {
+            lens[count] = make_key(s, j, keys[count]);
+            int added = 0;
+            hashmap_insert_slice(&seen, slice_from_memory(keys[count], lens[count]), &added);
+            count += added;
+        }
+        hashmap_destroy(&seen);
+
+        for (size_t h = 0; h < HASH_COUNT; ++h) {
+            if (hashes[h].int_only && !key_sets[s].int_only) {
+                continue;
+            }
+            for (size_t j = 0; j < count; ++j) {
+                hashes32[j] = (uint32_t) hashes[h].func(keys[j], lens[j]);
+            }
+            size_t low = bucket_collisions(hashes32, count, 0);
+            size_t high = bucket_collisions(hashes32, count, 1);
+            qsort(hashes32, count, sizeof(uint32_t), compare_u32);
+            size_t full = 0;
+            for (size_t j = 1; j < count; ++j) {
+                full += hashes32[j] == hashes32[j - 1];
+            }
+            printf("%-10s %-10s %9.0f%% %9.0f%% %9.0f%%\n", key_sets[s].name, hashes[h].name,
+                   100.0 * full / expected_hash, 100.0 * low / expected_bucket, 100.0 * high / expected_bucket);
+        }
+    }
+
+    memory_realloc(keys, 0);
+    memory_realloc(lens, 0);
+    memory_realloc(hashes32, 0);
+}
+
+static void bench_avalanche(void) {
+    static const size_t lengths[] = { 4, 8, 16, 64 };
+    static uint32_t flips[64 * 8][64];
+    printf("# avalanche: worst bias, %% (with %d keys, ~%.0f%% is noise)\n",
+           AVALANCHE_KEYS, 100.0 * 4.5 / sqrt(AVALANCHE_KEYS));
+    printf("%-10s", "hash");
+    for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); ++l) {
+        printf(" %7zu", lengths[l]);
+    }
+    printf("\n");
+
+    char key[64];
+    for (size_t h = 0; h < HASH_COUNT; ++h) {
+        printf("%-10s", hashes[h].name);
+        for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); ++l) {
+            size_t len = lengths[l];
+            if (hashes[h].int_only && len != 4) {
+                printf(" %7s", "-");
+                continue;
+            }
+            memset(flips, 0, sizeof(flips));
+            rng_state = 0x9e3779b97f4a7c15ULL;
+            for (int k = 0; k < AVALANCHE_KEYS; ++k) {
+                rng_fill(key, len);
+                uint64_t base = hashes[h].func(key, len);
+                for (size_t bit = 0; bit < len * 8; ++bit) {
+                    key[bit / 8] ^= (char) (1 << (bit % 8));
+                    uint64_t diff = base ^ hashes[h].func(key, len);
+                    key[bit / 8] ^= (char) (1 << (bit % 8));
+                    for (unsigned out = 0; out < hashes[h].bits; ++out) {
+                        flips[bit][out] += (diff >> out) & 1;
+                    }
+                }
+            }
+            double worst = 0;
+            for (size_t bit = 0; bit < len * 8; ++bit) {
+                for (unsigned out = 0; out < hashes[h].bits; ++out) {
+                    double bias = fabs(2.0 * flips[bit][out] / AVALANCHE_KEYS - 1.0);
+                    if (bias > worst) {
+                        worst = bias;
+                    }
+                }
+            }
+            printf(" %7.1f", 100.0 * worst);
+        }
+        printf("\n");
+    }
+}
+
+int main (int argc, char* argv[]) {
+    (void) argc;
+    (void) argv;
+
+    bench_speed();
+    printf("\n");
+    bench_collisions();
+    printf("\n");
+    bench_avalanche();
+    return 0;
+}
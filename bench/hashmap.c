@@ -0,0 +1,271 @@
+#include <stdio.h>
+#include <string.h>
+#include "pizza/hash.h"
+#include "pizza/memory.h"
+#include "pizza/timer.h"
+#include "pizza/hashmap.h"
+
+/*
+ * Compare HashMap against a classic chained hash table, where each key lives
+ * in its own heap node and buckets are linked lists of nodes.  Both use the
+ * same hash functions, and keep a 64-bit value for each key.
+ * Times are in ns per operation, for tables of different sizes.
+ */
+
+#define BENCH_HASH_SEED 0x5bd1e995U
+
+typedef struct Node {
+    struct Node* next;
+    Slice skey;
+    uint64_t ikey;
+    uint64_t value;
+} Node;
+
+typedef struct Chained {
+    Node** buckets;
+    size_t mask;
+    size_t size;
+} Chained;
+
+static inline uint64_t hash_int(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return key;
+}
+
+static inline uint64_t hash_slice(Slice key) {
+    return hash_xxh3_64(key.ptr, key.len, BENCH_HASH_SEED);
+}
+
+static void chained_build(Chained* c) {
+    c->mask = 15;
+    c->size = 0;
+    c->buckets = (Node**) memory_realloc(0, (c->mask + 1) * sizeof(Node*));
+    memset(c->buckets, 0, (c->mask + 1) * sizeof(Node*));
+}
+
+static void chained_destroy(Chained* c) {
+    for (size_t j = 0; j <= c->mask; ++j) {
+        Node* n = c->buckets[j];
+        while (n) {
+            Node* next = n->next;
+            memory_realloc(n, 0);
+            n = next;
+        }
+    }
+    memory_realloc(c->buckets, 0);
+}
+
+static Node** chained_find(Chained* c, uint64_t hash, Slice skey, uint64_t ikey, int is_int) {
+    Node** p = &c->buckets[hash & c->mask];
+    for (; *p; p = &(*p)->next) {
+        Node* n = *p;
+        if (is_int ? n->ikey == ikey
+                   : n->skey.len == skey.len && memcmp(n->skey.ptr, skey.ptr, skey.len) == 0) {
+            break;
+        }
+    }
+    return p;
+}
+
+static void chained_grow(Chained* c, int is_int) {
+    size_t size = 2 * (c->mask + 1);
+    Node** buckets = (Node**) memory_realloc(0, size * sizeof(Node*));
+    memset(buckets, 0, size * sizeof(Node*));
+    for (size_t j = 0; j <= c->mask; ++j) {
+        Node* n = c->buckets[j];
+        while (n) {
+            Node* next = n->next;
+            uint64_t hash = is_int ? hash_int(n->ikey) : hash_slice(n->skey);
+            n->next = buckets[hash & (size - 1)];
+            buckets[hash & (size - 1)] = n;
+            n = next;
+        }
+    }
+    memory_realloc(c->buckets, 0);
+    c->buckets = buckets;
+    c->mask = size - 1;
+}
+
+static uint64_t* chained_insert(Chained* c, Slice skey, uint64_t ikey, int is_int) {
+    uint64_t hash = is_int ? hash_int(ikey) : hash_slice(skey);
+    Node** p = chained_find(c, hash, skey, ikey, is_int);
+    if (*p) {
+        return &(*p)->value;
+    }
+    if (c->size >= c->mask + 1) {
+        chained_grow(c, is_int);
+        p = chained_find(c, hash, skey, ikey, is_int);
+    }
+    Node* n = (Node*) memory_realloc(0, sizeof(Node));
+    n->next = 0;
+    n->skey = skey;
+    n->ikey = ikey;
+    n->value = 0;
+    *p = n;
+    ++c->size;
+    return &n->value;
+}
+
+static uint64_t* chained_lookup(Chained* c, Slice skey, uint64_t ikey, int is_int) {
+    uint64_t hash = is_int ? hash_int(ikey) : hash_slice(skey);
+    Node* n = *chained_find(c, hash, skey, ikey, is_int);
+    return n ? &n->value : 0;
+}
+
+static void chained_erase(Chained* c, Slice skey, uint64_t ikey, int is_int) {
+    uint64_t hash = is_int ? hash_int(ikey) : hash_slice(skey);
+    Node** p = chained_find(c, hash, skey, ikey, is_int);
+    Node* n = *p;
+    if (n) {
+        *p = n->next;
+        memory_realloc(n, 0);
+        --c->size;
+    }
+}
+
+// Keys: integers, and the same integers formatted as strings.
+typedef struct Keys {
+    uint64_t* ints;
+    Slice* slices;
+    char* text;
+    size_t count;   // first half are inserted, second half are misses
+} Keys;
+
+static void keys_build(Keys* k, size_t count) {
+    k->count = count;
+    k->ints = (uint64_t*) memory_realloc(0, 2 * count * sizeof(uint64_t));
+    k->slices = (Slice*) memory_realloc(0, 2 * count * sizeof(Slice));
+    k->text = (char*) memory_realloc(0, 2 * count * 24);
+    uint64_t seed = 0x9e3779b97f4a7c15ULL;
+    for (size_t j = 0; j < 2 * count; ++j) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        k->ints[j] = seed;
+        int len = sprintf(k->text + 24 * j, "key:%llu", (unsigned long long) (seed % 1000000000000ULL));
+        k->slices[j] = slice_from_memory(k->text + 24 * j, len);
+    }
+}
+
+static void keys_destroy(Keys* k) {
+    memory_realloc(k->ints, 0);
+    memory_realloc(k->slices, 0);
+    memory_realloc(k->text, 0);
+}
+
+typedef struct Result {
+    double insert;
+    double hit;
+    double miss;
+    double erase;
+} Result;
+
+static double per_op(Timer* t, size_t count) {
+    return (double) timer_elapsed_ns(t) / (double) count;
+}
+
+static uint64_t run_hashmap(const Keys* k, int is_int, Result* r) {
+    uint64_t sum = 0;
+    Timer t;
+    HashMap m; hashmap_build(&m, is_int ? HASHMAP_KEY_INT : HASHMAP_KEY_SLICE, sizeof(uint64_t));
+
+    timer_start(&t);
+    for (size_t j = 0; j < k->count; ++j) {
+        uint64_t* v = is_int ? hashmap_insert_int(&m, k->ints[j], 0) : hashmap_insert_slice(&m, k->slices[j], 0);
+        *v = j;
+    }
+    timer_stop(&t);
+    r->insert = per_op(&t, k->count);
+
+    timer_start(&t);
+    for (size_t j = 0; j < k->count; ++j) {
+        uint64_t* v = is_int ? hashmap_find_int(&m, k->ints[j]) : hashmap_find_slice(&m, k->slices[j]);
+        sum += *v;
+    }
+    timer_stop(&t);
+    r->hit = per_op(&t, k->count);
+
+    timer_start(&t);
+    for (size_t j = k->count; j < 2 * k->count; ++j) {
+        sum += is_int ? !hashmap_find_int(&m, k->ints[j]) : !hashmap_find_slice(&m, k->slices[j]);
+    }
+    timer_stop(&t);
+    r->miss = per_op(&t, k->count);
+
+    timer_start(&t);
+    for (size_t j = 0; j < k->count; ++j) {
+        sum += is_int ? hashmap_erase_int(&m, k->ints[j]) : hashmap_erase_slice(&m, k->slices[j]);
+    }
+    timer_stop(&t);
+    r->erase = per_op(&t, k->count);
+
+    hashmap_destroy(&m);
+    return sum;
+}
+
+static uint64_t run_chained(const Keys* k, int is_int, Result* r) {
+    uint64_t sum = 0;
+    Slice none = { .ptr = 0, .len = 0 };
+    Timer t;
+    Chained c; chained_build(&c);
+
+    timer_start(&t);
+    for (size_t j = 0; j < k->count; ++j) {
+        *chained_insert(&c, is_int ? none : k->slices[j], k->ints[j], is_int) = j;
+    }
+    timer_stop(&t);
+    r->insert = per_op(&t, k->count);
+
+    timer_start(&t);
+    for (size_t j = 0; j < k->count; ++j) {
+        sum += *chained_lookup(&c, is_int ? none : k->slices[j], k->ints[j], is_int);
+    }
+    timer_stop(&t);
+    r->hit = per_op(&t, k->count);
+
+    timer_start(&t);
+    for (size_t j = k->count; j < 2 * k->count; ++j) {
+        sum += !chained_lookup(&c, is_int ? none : k->slices[j], k->ints[j], is_int);
+    }
+    timer_stop(&t);
+    r->miss = per_op(&t, k->count);
+
+    timer_start(&t);
+    for (size_t j = 0; j < k->count; ++j) {
+        chained_erase(&c, is_int ? none : k->slices[j], k->ints[j], is_int);
+        ++sum;
+    }
+    timer_stop(&t);
+    r->erase = per_op(&t, k->count);
+
+    chained_destroy(&c);
+    return sum;
+}
+
+int main (int argc, char* argv[]) {
+    (void) argc;
+    (void) argv;
+
+    static const size_t sizes[] = { 1000, 100000, 1000000 };
+    uint64_t sum = 0;
+    printf("%-6s %8s  %-8s %8s %8s %8s %8s\n", "keys", "count", "table", "insert", "hit", "miss", "erase");
+    for (int is_int = 1; is_int >= 0; --is_int) {
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+            Keys k; keys_build(&k, sizes[s]);
+            Result r;
+            sum += run_hashmap(&k, is_int, &r);
+            printf("%-6s %8zu  %-8s %8.1f %8.1f %8.1f %8.1f\n", is_int ? "int" : "slice", sizes[s], "hashmap",
+                   r.insert, r.hit, r.miss, r.erase);
+            sum += run_chained(&k, is_int, &r);
+            printf("%-6s %8zu  %-8s %8.1f %8.1f %8.1f %8.1f\n", is_int ? "int" : "slice", sizes[s], "chained",
+                   r.insert, r.hit, r.miss, r.erase);
+            keys_destroy(&k);
+        }
+    }
+    // so that nothing is optimized away
+    return sum == 42;
+}
@@ -0,0 +1,69 @@
+#ifndef ARENA_H_
+#define ARENA_H_
+
+/*
+ * Arena -- a bump allocator.
+ * Memory is carved out of large chunks, one allocation after the other.
+ * Individual allocations are never released; instead, the whole Arena can be
+ * rewound to a previous mark, or reset, in a single step.
+ * Chunks are kept around after a rewind / reset, so a reused Arena quickly
+ * stops asking for more memory altogether.
+ */
+
+#include <stddef.h>
+#include "memory.h"
+
+// Default size for each chunk in the Arena.
+#define ARENA_DEFAULT_CHUNK_SIZE (64UL * 1024UL)
+
+// All pointers returned by the Arena are aligned to this many bytes.
+#define ARENA_ALIGNMENT 16UL
+
+typedef struct ArenaChunk ArenaChunk;
+
+typedef struct Arena {
+    ArenaChunk* head;    // first chunk in the list
+    ArenaChunk* current; // chunk where allocations are happening now
+    void* last;          // last allocation, can be grown / shrunk in place
+    size_t chunk_size;   // size for new chunks
+} Arena;
+
+// A position in an Arena, to which it can be rewound later.
+typedef struct ArenaMark {
+    ArenaChunk* chunk;
+    size_t pos;
+} ArenaMark;
+
+// Arena constructor.
+// If chunk_size == 0, use ARENA_DEFAULT_CHUNK_SIZE.
+void arena_build(Arena* a, size_t chunk_size);
+
+// Arena destructor -- releases all chunks.
+void arena_destroy(Arena* a);
+
+// Allocate len bytes from the Arena; contents are NOT cleared.
+void* arena_alloc(Arena* a, size_t len);
+
+// Change the size of a block allocated from the Arena, from olen to nlen bytes.
+// If the block was the last allocation, it is resized in place when possible;
+// otherwise, a new block is allocated and the data is copied over.
+// If nlen == 0, release the block (only reclaimed if it was the last one).
+void* arena_realloc(Arena* a, void* ptr, size_t olen, size_t nlen);
+
+// Get a mark for the current position in the Arena.
+ArenaMark arena_mark(const Arena* a);
+
+// Release all allocations made after mark was taken.
+void arena_rewind(Arena* a, ArenaMark mark);
+
+// Release all allocations -- does NOT release memory for chunks.
+void arena_reset(Arena* a);
+
+// Return the total number of bytes reserved in chunks.
+size_t arena_capacity(const Arena* a);
+
+// Fill in allocator so that, once installed, memory_realloc() takes its
+// memory from Arena a.
+void arena_allocator(Arena* a, MemoryAllocator* allocator);
+
+#endif
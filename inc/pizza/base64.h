@@ -7,7 +7,7 @@
 
 #include "buffer.h"
 
-int base64_decode(Slice encoded, Buffer *decoded);
-int base64_encode(Slice decoded, Buffer *encoded);
+SliceLen base64_decode(Slice encoded, Buffer *decoded);
+SliceLen base64_encode(Slice decoded, Buffer *encoded);
 
 #endif
@@ -21,6 +21,9 @@ typedef struct Blowfish {
 // Initialize a Blowfish context to encrypt / decrypt using key with len bytes.
 void blowfish_init(Blowfish* bf, const char* key, uint32_t len);
 
+// Wipe all key material from a Blowfish context.
+void blowfish_destroy(Blowfish* bf);
+
 // Encrypt a block of len bytes where the data is stored in Little Endian order.
 void blowfish_encrypt_LE(Blowfish* bf, uint8_t* ptr, uint32_t len);
 
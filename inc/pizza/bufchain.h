@@ -0,0 +1,67 @@
+#ifndef BUFCHAIN_H_
+#define BUFCHAIN_H_
+
+/*
+ * BufferChain -- a sequence of byte segments, assembled without copying.
+ * Slices and Buffers are appended BY REFERENCE: the chain only remembers
+ * where their data is, so that data MUST stay alive and unchanged for as long
+ * as the chain is used.
+ * Small pieces that have nowhere else to live can be copied into storage
+ * owned by the chain.
+ * Segments are kept as an iovec array, ready to be handed to writev(); a few
+ * of them live inside the struct, more are allocated as needed.
+ */
+
+#include <stdint.h>
+#include <sys/uio.h>
+#include "arena.h"
+#include "buffer.h"
+
+// Number of segments kept inside the BufferChain struct itself.
+#define BUFCHAIN_INLINE_SEGMENTS 4
+
+typedef struct BufferChain {
+    struct iovec* seg;                          // segments, ready for writev()
+    uint32_t cap;                               // total segment capacity
+    uint32_t cnt;                               // current number of segments
+    SliceLen len;                               // total bytes in all segments
+    Arena copies;                               // storage for copied bytes
+    char* tail;                                 // where next copy goes
+    size_t room;                                // bytes left after tail
+    struct iovec buf[BUFCHAIN_INLINE_SEGMENTS]; // space for a few segments
+} BufferChain;
+
+// BufferChain constructor.
+void bufchain_build(BufferChain* c);
+
+// BufferChain destructor -- releases the segments and any copied bytes, but
+// not the data that was appended by reference.
+void bufchain_destroy(BufferChain* c);
+
+// Remove all segments -- does NOT release memory.
+void bufchain_clear(BufferChain* c);
+
+// Append a Slice by reference.
+// Data contiguous with the last segment just extends that segment.
+void bufchain_append_slice(BufferChain* c, Slice s);
+
+// Append the current contents of a Buffer by reference.
+// The Buffer must not be modified while the chain is in use, since appending
+// to it can move its data.
+void bufchain_append_buffer(BufferChain* c, const Buffer* b);
+
+// Append a copy of a Slice, kept in storage owned by the chain.
+void bufchain_append_copy(BufferChain* c, Slice s);
+
+// Return the segments as an iovec array, and their count in cnt.
+const struct iovec* bufchain_iovec(const BufferChain* c, int* cnt);
+
+// Append all segments to a Buffer, making one contiguous copy.
+void bufchain_flatten(const BufferChain* c, Buffer* b);
+
+// Write all segments to a file descriptor with writev(), dealing with
+// partial writes.
+// Return 0 for success, non-zero for error conditions.
+int bufchain_write_fd(const BufferChain* c, int fd);
+
+#endif
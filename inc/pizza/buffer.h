@@ -6,13 +6,18 @@
  * write-only access to an array of bytes.
  * Space is automatically grown as needed -- hopefully no overflows.
  * Small buffers use an internal array, larger buffers allocate.
+ * Very large buffers live in their own memory mapping, which can grow without
+ * copying the data; these are page-aligned, and optionally use huge pages.
  * User always looks at buffer->ptr, whether small or large.
+ * Data can also be consumed from the front, which makes a Buffer work as a
+ * FIFO: the unconsumed data starts at buffer->ptr + buffer->pos.
  * It does NOT add a null terminator at the end.
  * Do NOT use with C standard strXXX() functions.
  */
 
 #include <stdarg.h>
 #include <stdint.h>
+#include "arena.h"
 #include "slice.h"
 
 #define BUFFER_FLAG_SET(b, f) do { (b)->flg |= ( f); } while (0)
@@ -22,6 +27,19 @@
 // Flags used for a Buffer.
 #define BUFFER_FLAG_BUF_IN_HEAP (1U<<0)
 #define BUFFER_FLAG_PTR_IN_HEAP (1U<<1)
+#define BUFFER_FLAG_PTR_IN_MMAP (1U<<2) // ptr is a memory mapping
+#define BUFFER_FLAG_HUGE_PAGES  (1U<<3) // set to use huge pages when mapped
+
+// Buffers with at least this capacity are moved into a memory mapping.
+#if !defined(BUFFER_MMAP_THRESHOLD)
+#define BUFFER_MMAP_THRESHOLD (4UL * 1024UL * 1024UL)
+#endif
+
+// Consumed data is only moved out of the way once there is at least this much
+// of it, and it is no less than the data still left to consume.
+#if !defined(BUFFER_COMPACT_THRESHOLD)
+#define BUFFER_COMPACT_THRESHOLD 4096UL
+#endif
 
 // Total size we want Buffer struct to have.
 #define BUFFER_DESIRED_SIZE 64UL
@@ -30,9 +48,12 @@
 // MUST BE KEPT IN SYNC WITH DECLARATION OF struct Buffer.
 #define BUFFER_FIELDS_SIZE (\
     sizeof(char*)     /* ptr */ + \
-    sizeof(uint32_t)  /* cap */ + \
-    sizeof(uint32_t)  /* len */ + \
+    sizeof(SliceLen)  /* cap */ + \
+    sizeof(SliceLen)  /* len */ + \
+    sizeof(Arena*)    /* arena */ + \
+    sizeof(SliceLen)  /* pos */ + \
     sizeof(uint8_t)   /* flg */ + \
+    sizeof(uint8_t)   /* tag */ + \
     0)
 
 // Size allowed for a Buffer's static data array.
@@ -40,9 +61,12 @@
 
 typedef struct Buffer {
     char* ptr;                    // pointer to beginning of data
-    uint32_t cap;                 // total data capacity
-    uint32_t len;                 // current buffer length
+    SliceLen cap;                 // total data capacity
+    SliceLen len;                 // current buffer length
+    Arena* arena;                 // if not null, where heap data comes from
+    SliceLen pos;                 // data before this has been consumed
     uint8_t flg;                  // flags for Buffer
+    uint8_t tag;                  // MemoryTag used to account for heap data
     char buf[BUFFER_DATA_SIZE];   // stack space for small Buffer
 } Buffer;
 
@@ -56,6 +80,7 @@ static_assert(sizeof(Buffer) == BUFFER_DESIRED_SIZE, "Buffer has wrong size");
 #define buffer_clear(b) \
     do { \
         (b)->len = 0; \
+        (b)->pos = 0; \
     } while (0)
 
 // Append a NUL (\0) character to the buffer
@@ -65,32 +90,68 @@ static_assert(sizeof(Buffer) == BUFFER_DESIRED_SIZE, "Buffer has wrong size");
     } while (0)
 
 // Ensure buffer has space for extra bytes.
+// The check is written so that it cannot overflow when len is close to the
+// maximum SliceLen.
 #define buffer_ensure_extra(b, extra) \
     do { \
-        uint32_t total = (extra) + (b)->len; \
-        if (total > (b)->cap) { \
-            buffer_ensure_total(b, total); \
+        if ((SliceLen) (extra) > (b)->cap - (b)->len) { \
+            buffer_grow(b, extra); \
         } \
     } while (0)
 
+// Add n bytes, already written at the pointer returned by
+// buffer_reserve_tail(), to current contents of Buffer.
+#define buffer_commit(b, n) \
+    do { \
+        (b)->len += (n); \
+    } while (0)
+
 // Buffer default constructor.
 void buffer_build(Buffer* b);
 
+// Buffer constructor that takes its heap memory from an Arena.
+// Destroying the Buffer only gives memory back to the Arena when possible;
+// all of it is released when the Arena is rewound / reset / destroyed.
+void buffer_build_in_arena(Buffer* b, Arena* arena);
+
 // Buffer destructor.
 void buffer_destroy(Buffer* b);
 
 // Ensure buffer has space for total bytes.
-void buffer_ensure_total(Buffer* b, uint32_t total);
+void buffer_ensure_total(Buffer* b, SliceLen total);
 
-// Create a slice that wraps the contents of the buffer.
+// Grow buffer so that it has space for extra bytes after its current length.
+// Aborts if the resulting length cannot be represented as a SliceLen.
+void buffer_grow(Buffer* b, SliceLen extra);
+
+// Ensure buffer has space for n extra bytes, and return a pointer to where
+// they go; write up to n bytes there and then call buffer_commit() with the
+// number of bytes actually written.  The pointer is invalidated by any other
+// operation that changes the Buffer.
+char* buffer_reserve_tail(Buffer* b, SliceLen n);
+
+// Create a slice that wraps the contents of the buffer that have not been
+// consumed yet.
 Slice buffer_slice(const Buffer* b);
 
+// Consume n bytes from the front of Buffer (or all of them, if there are
+// fewer); they are no longer part of its contents.  Consumed data is only
+// moved out of the way when that is worth it, so consuming is cheap.
+void buffer_consume(Buffer* b, SliceLen n);
+
+// Move unconsumed data to the beginning of Buffer, right now.
+void buffer_compact(Buffer* b);
+
 // Reallocate memory so that current data fits exactly into Buffer.
 void buffer_pack(Buffer* b);
 
 // Set contents of Buffer to a Slice, optionally null-terminated.
 void buffer_set_to_slice(Buffer* b, Slice s, bool zero);
 
+// Convert the contents of Buffer to ASCII lower / upper case, in place.
+void buffer_to_lower(Buffer* b);
+void buffer_to_upper(Buffer* b);
+
 // Append a single byte to current contents of Buffer.
 void buffer_append_byte(Buffer* b, char t);
 
@@ -108,12 +169,34 @@ void buffer_append_buffer(Buffer* b, const Buffer* buf);
 void buffer_format_signed(Buffer* b, long long l);
 void buffer_format_unsigned(Buffer* b, unsigned long long l);
 
-// Append a formatted double to current contents of Buffer.
+// Append a formatted double to current contents of Buffer, as printf("%f").
 void buffer_format_double(Buffer* b, double d);
 
+// Append the shortest representation of a double that reads back as exactly
+// the same value, such as 3.14 or 1e+21 -- see dtoa.h.
+void buffer_format_double_shortest(Buffer* b, double d);
+
 // Append a printf-formatted string to current contents of Buffer.
 // THESE ARE EXPENSIVE.
 void buffer_format_print(Buffer* b, const char* fmt, ...);
 void buffer_format_vprint(Buffer* b, const char* fmt, va_list ap);
 
+// Append to Buffer everything read from file descriptor fd, until end of
+// file, reading straight into the Buffer in large chunks.  For a regular
+// file, the Buffer is sized for the whole file before reading.
+// Return 0 for success, non-zero for error conditions.
+int buffer_read_fd(Buffer* b, int fd);
+
+// Write the contents of Buffer to file descriptor fd, dealing with partial
+// writes.
+// Return 0 for success, non-zero for error conditions.
+int buffer_write_fd(const Buffer* b, int fd);
+
+// Copy everything from file descriptor src to file descriptor dst, until end
+// of file, and store in copied (if not null) the number of bytes copied.
+// When src is a regular file or either one is a pipe, the kernel copies the
+// data with sendfile() / splice(); otherwise it goes through a Buffer.
+// Return 0 for success, non-zero for error conditions.
+int buffer_copy_fd(int src, int dst, uint64_t* copied);
+
 #endif
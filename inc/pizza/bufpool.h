@@ -0,0 +1,62 @@
+#ifndef BUFPOOL_H_
+#define BUFPOOL_H_
+
+/*
+ * BufPool -- per-thread recycling of Buffer heap blocks.
+ * Buffers grow in powers of two; when a Buffer releases a block, instead of
+ * going back to the allocator it is kept in a free list for its size class,
+ * owned by the current thread, and reused the next time a Buffer in that
+ * thread needs a block of the same size.
+ * Each class keeps at most a configurable number of blocks; the rest are
+ * released as usual.  Blocks held in the pool still count as live Buffer
+ * memory, and are released when their thread exits.
+ * Blocks are only recycled while the system allocator is installed;
+ * memory_set_allocator() flushes the pool of the calling thread, so other
+ * threads should not have pooled blocks when the allocator is switched.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define BUFPOOL_MIN_SHIFT    6                    // smallest class: 64 bytes
+#define BUFPOOL_MAX_SHIFT   20                    // largest class: 1 MiB
+#define BUFPOOL_MIN_SIZE    (1UL << BUFPOOL_MIN_SHIFT)
+#define BUFPOOL_MAX_SIZE    (1UL << BUFPOOL_MAX_SHIFT)
+#define BUFPOOL_NUM_CLASSES (BUFPOOL_MAX_SHIFT - BUFPOOL_MIN_SHIFT + 1)
+
+// By default, each class keeps as many blocks as fit in this many bytes,
+// and at least one.
+#define BUFPOOL_DEFAULT_CLASS_BYTES (64UL * 1024UL)
+
+// Counters for the pool of the current thread.
+typedef struct BufPoolStats {
+    uint64_t hits;                         // blocks reused from the pool
+    uint64_t misses;                       // blocks requested but not there
+    uint64_t puts;                         // blocks kept in the pool
+    uint64_t drops;                        // blocks released, class was full
+    uint32_t cached[BUFPOOL_NUM_CLASSES];  // blocks currently in each class
+} BufPoolStats;
+
+// Set / get the maximum number of blocks kept for the class of size bytes,
+// for all threads; 0 disables recycling for that class.
+// size must be a power of two between BUFPOOL_MIN_SIZE and BUFPOOL_MAX_SIZE.
+void bufpool_set_limit(size_t size, uint32_t limit);
+uint32_t bufpool_get_limit(size_t size);
+
+// Get a block of exactly size bytes from the current thread's pool.
+// Return 0 if there is none, size is not one of the classes, or the system
+// allocator is not installed.
+void* bufpool_get(size_t size);
+
+// Offer a block of size bytes to the current thread's pool; it must have
+// been obtained from the system allocator.
+// Return 1 if the pool kept it, 0 if the caller must release it.
+int bufpool_put(void* ptr, size_t size);
+
+// Release all blocks held in the current thread's pool.
+void bufpool_flush(void);
+
+// Get the counters for the current thread's pool.
+void bufpool_stats(BufPoolStats* stats);
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef BYTES_H_
+#define BYTES_H_
+
+/*
+ * Bytes -- an immutable, reference-counted array of bytes.
+ * A Buffer can be frozen into Bytes without copying its data; from then on
+ * the data never changes, so it can be shared freely, including across
+ * threads: each user retains the Bytes while it needs it, and the data is
+ * released when the last reference goes away.
+ * Slices into the data are valid for as long as a reference is held.
+ * Retaining and releasing are atomic; everything else only reads.
+ */
+
+#include <stdint.h>
+#include "buffer.h"
+
+// Opaque type of a Bytes.
+typedef struct Bytes Bytes;
+
+// Create a Bytes with the contents of Buffer b, taking over its data without
+// copying it; b is left empty and can be reused or destroyed.
+// If b takes its memory from an Arena, the data still lives in that Arena,
+// and is NOT released with the Bytes; the Bytes can still be released from
+// any thread, but it MUST NOT be used after the Arena is rewound / reset /
+// destroyed.
+// The returned Bytes has a single reference.
+Bytes* bytes_freeze(Buffer* b);
+
+// Create a Bytes with a copy of the contents of Slice s.
+// The returned Bytes has a single reference.
+Bytes* bytes_from_slice(Slice s);
+
+// Add a reference to Bytes; return the same Bytes.
+Bytes* bytes_retain(Bytes* bytes);
+
+// Drop a reference to Bytes; the last one releases it, with its data.
+void bytes_release(Bytes* bytes);
+
+// Return the current number of references to Bytes.
+// Only meaningful as a hint while other threads hold references.
+uint32_t bytes_refs(const Bytes* bytes);
+
+// Create a Slice with all the data in Bytes.
+Slice bytes_slice(const Bytes* bytes);
+
+// Create a Slice with len bytes of data in Bytes, starting at pos.
+// The view is clamped to the available data.
+Slice bytes_view(const Bytes* bytes, SliceLen pos, SliceLen len);
+
+#endif
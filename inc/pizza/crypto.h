@@ -10,6 +10,9 @@
  * These work IN-PLACE, so the original contents of ptr are overwritten.
  * NOTE: encryption might use up MORE than len bytes; up to CRYPTO_BLOCK_SIZE
  * more bytes, in fact, due to padding.
+ *
+ * A Crypto holds key material; consider allocating it with
+ * memory_secure_alloc(), and always call crypto_destroy() when done with it.
  */
 
 #include "blowfish.h"
@@ -26,6 +29,9 @@ typedef struct Crypto {
 
 void crypto_init(Crypto* crypto, Slice passphrase, Slice iv);
 
+// wipes all key material from crypto
+void crypto_destroy(Crypto* crypto);
+
 // decrypts in-place len bytes in ptr;
 // never uses more than len bytes;
 // returns length of decrypted data, which might be smaller than len;
@@ -4,8 +4,7 @@
 #include "buffer.h"
 
 typedef struct Deflator {
-    uint32_t chunk_size;
-    unsigned char* chunk;
+    uint32_t chunk_size;   // input / output is processed in steps of this size
 } Deflator;
 
 void deflator_build(Deflator* deflator, int chunk_size);
@@ -0,0 +1,22 @@
+#ifndef DTOA_H_
+#define DTOA_H_
+
+/*
+ * dtoa -- convert doubles to their shortest decimal representation.
+ * Uses the Grisu2 algorithm by Florian Loitsch ("Printing Floating-Point
+ * Numbers Quickly and Accurately with Integers", PLDI 2010), which only needs
+ * 64-bit integer arithmetic: the output always reads back as exactly the same
+ * double, and is the shortest such representation in the vast majority of
+ * cases (otherwise it is one digit longer).
+ */
+
+// Maximum number of bytes written by dtoa_shortest(), with room to spare.
+#define DTOA_MAX_LEN 32
+
+// Write the representation of d into out, which must have space for at least
+// DTOA_MAX_LEN bytes; no null terminator is added.
+// Return the number of bytes written.
+// Output looks like JavaScript's: 3.14, 100, 0.001, 1e+21, -1.5e-7, -0, nan, inf.
+int dtoa_shortest(double d, char* out);
+
+#endif
@@ -3,10 +3,41 @@
 
 /*
  * Useful hash functions.
+ *
+ * The 32-bit hashes are fine for short keys.  For long inputs, and whenever
+ * 64 or 128 bits are needed, use XXH3, which processes large inputs at close
+ * to memory bandwidth (with SSE2 / AVX2, according to scan_get_level()).
+ * XXH3 can also hash data that arrives in pieces, such as the segments of a
+ * BufferChain or the chunks of a big file, without first putting it together;
+ * the result is the same as hashing all the data in one go.
  */
 
+#include <stddef.h>
 #include <stdint.h>
 
+// Size of the secret used by XXH3.
+#define HASH_XXH3_SECRET_LEN 192
+
+// Size of the buffer used by the XXH3 streaming API.
+#define HASH_XXH3_BUFFER_LEN 256
+
+// A 128-bit hash value.
+typedef struct Hash128 {
+    uint64_t lo;
+    uint64_t hi;
+} Hash128;
+
+// State for computing XXH3 hashes in pieces.
+typedef struct HashXXH3 {
+    uint64_t acc[8];                            // accumulators
+    uint8_t secret[HASH_XXH3_SECRET_LEN];       // secret derived from seed
+    uint8_t buffer[HASH_XXH3_BUFFER_LEN];       // input not yet processed
+    uint64_t seed;                              // seed for the hash
+    uint64_t total;                             // total bytes hashed so far
+    uint32_t buffered;                          // bytes in buffer
+    uint32_t stripes;                           // stripes done in current block
+} HashXXH3;
+
 /*
  * http://www.cse.yorku.ca/~oz/hash.html
  */
@@ -27,4 +58,20 @@ uint32_t hash_wang(uint32_t input);
  */
 uint32_t hash_pcg(uint32_t v);
 
+/*
+ * https://github.com/Cyan4973/xxHash -- XXH3, compatible with version 0.8.
+ */
+uint64_t hash_xxh3_64(const char* str, size_t len, uint64_t seed);
+Hash128 hash_xxh3_128(const char* str, size_t len, uint64_t seed);
+
+// Reset state to start a new computation with a given seed.
+void hash_xxh3_reset(HashXXH3* h, uint64_t seed);
+
+// Add data to the computation; can be called multiple times.
+void hash_xxh3_update(HashXXH3* h, const char* str, size_t len);
+
+// Return the hash of all data added so far; more data can still be added.
+uint64_t hash_xxh3_final64(const HashXXH3* h);
+Hash128 hash_xxh3_final128(const HashXXH3* h);
+
 #endif
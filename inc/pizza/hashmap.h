@@ -0,0 +1,93 @@
+#ifndef HASHMAP_H_
+#define HASHMAP_H_
+
+/*
+ * HashMap -- an open-addressing hash table, in the style of Swiss tables.
+ * Every bucket has a control byte, which says whether it is empty, deleted,
+ * or full; full buckets also keep 7 bits of the hash of their key.  A
+ * lookup compares those bits for a whole group of 16 buckets with a couple of
+ * SSE2 instructions, and only looks at the keys whose bits match.
+ * Keys are either Slices or 64-bit integers, chosen when building the map;
+ * Slice keys are NOT copied, so their data must outlive the map -- atoms from
+ * an Interner, or copies in an Arena, are good choices.
+ * Values have a fixed size, and live in the table itself; pointers to them
+ * are valid until the table is rehashed, which only happens when adding a
+ * key, or when calling hashmap_reserve() / hashmap_rehash().
+ * Memory comes from memory_realloc_tag(), or optionally from an Arena.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include "arena.h"
+#include "slice.h"
+
+// Buckets in a group, probed together.
+#define HASHMAP_GROUP 16
+
+// Kinds of keys.
+#define HASHMAP_KEY_SLICE 0
+#define HASHMAP_KEY_INT   1
+
+typedef struct HashMap {
+    int8_t* ctrl;           // control bytes, buckets + HASHMAP_GROUP
+    char* slots;            // key and value for each bucket
+    Arena* arena;           // if not null, where memory comes from
+    size_t buckets;         // power of 2, or 0 before the first insertion
+    size_t size;            // number of keys
+    size_t growth_left;     // keys that can be added before rehashing
+    uint32_t value_size;    // size of each value
+    uint32_t slot_size;     // size of key + value, aligned
+    uint8_t kind;           // kind of keys
+} HashMap;
+
+// HashMap constructor, for keys of a given kind and values of value_size
+// bytes.
+void hashmap_build(HashMap* m, unsigned kind, size_t value_size);
+
+// HashMap constructor that takes its memory from an Arena.
+// Releasing memory only gives it back to the Arena when possible; all of it is
+// released when the Arena is rewound / reset / destroyed.
+void hashmap_build_in_arena(HashMap* m, unsigned kind, size_t value_size, Arena* arena);
+
+// HashMap destructor.
+void hashmap_destroy(HashMap* m);
+
+// Remove all keys -- does NOT release memory.
+void hashmap_clear(HashMap* m);
+
+// Make room for count keys in total, so that adding them does not rehash.
+void hashmap_reserve(HashMap* m, size_t count);
+
+// Rebuild the table with room for count keys (or the current number of
+// keys, if larger), dropping all deleted buckets; this can shrink it.
+void hashmap_rehash(HashMap* m, size_t count);
+
+// Return a pointer to the value for a key, or null if it is not there.
+void* hashmap_find_slice(const HashMap* m, Slice key);
+void* hashmap_find_int(const HashMap* m, uint64_t key);
+
+// Return a pointer to the value for a key, adding the key with a value
+// cleared to zeros if it was not there; if added is not null, set it to 1
+// when the key was added, and to 0 otherwise.
+void* hashmap_insert_slice(HashMap* m, Slice key, int* added);
+void* hashmap_insert_int(HashMap* m, uint64_t key, int* added);
+
+// Remove a key; return 1 if it was there, 0 otherwise.
+int hashmap_erase_slice(HashMap* m, Slice key);
+int hashmap_erase_int(HashMap* m, uint64_t key);
+
+// Return the first bucket at or after bucket j that has a key, or
+// m->buckets if there is none.  Keys can be erased while iterating:
+//
+//   for (size_t j = hashmap_scan(m, 0); j < m->buckets; j = hashmap_scan(m, j + 1)) {
+//       Slice key = hashmap_key_slice(m, j);
+//       MyValue* val = hashmap_value(m, j);
+//   }
+size_t hashmap_scan(const HashMap* m, size_t j);
+
+// Return the key / value in bucket j, which must have a key.
+Slice hashmap_key_slice(const HashMap* m, size_t j);
+uint64_t hashmap_key_int(const HashMap* m, size_t j);
+void* hashmap_value(const HashMap* m, size_t j);
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef INTERN_H_
+#define INTERN_H_
+
+/*
+ * Interner -- a table of interned byte strings, or atoms.
+ * Each distinct byte string is stored once, in an Arena, and gets a compact
+ * 32-bit id; interning the same bytes again returns the same id.  From then
+ * on, two atoms are equal exactly when their ids are, and their hash was
+ * computed when they were interned.
+ * Atoms are never removed, so their ids and bytes stay valid until the
+ * Interner is destroyed.
+ * An Interner can be used from several threads at the same time: lookups
+ * share a read lock, and only adding a new atom takes the write lock.
+ * Getting the bytes or hash for an atom takes no lock at all.
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include "arena.h"
+#include "slice.h"
+
+// Seed for hash_murmur3().
+#if !defined(INTERN_HASH_SEED)
+#define INTERN_HASH_SEED 0x9747b28cU
+#endif
+
+// Atoms are stored in segments of growing size; the first one has room for
+// this many atoms, and each one after that doubles it.
+#define INTERN_SEGMENT_BASE 256U
+#define INTERN_SEGMENTS      24
+
+// Not a valid atom; returned when an atom is not found.
+#define ATOM_NONE 0U
+
+typedef uint32_t Atom;
+
+typedef struct InternEntry InternEntry;
+
+typedef struct Interner {
+    pthread_rwlock_t lock;
+    Arena arena;                              // atom bytes and segments
+    InternEntry* segments[INTERN_SEGMENTS];   // atoms, by id
+    uint64_t* slots;                          // hash << 32 | id, or 0 if empty
+    uint32_t mask;                            // number of slots - 1
+    uint32_t count;                           // number of atoms
+} Interner;
+
+// Interner constructor.
+void intern_build(Interner* in);
+
+// Interner destructor -- all atoms become invalid.
+void intern_destroy(Interner* in);
+
+// Return the atom for the bytes in Slice s, adding it if necessary; the bytes
+// are copied.
+// Return ATOM_NONE only if the Interner is full.
+Atom intern_add(Interner* in, Slice s);
+
+// Return the atom for the bytes in Slice s, or ATOM_NONE if they were never
+// interned.
+Atom intern_find(Interner* in, Slice s);
+
+// Return the bytes for an atom, which are followed by a null byte; the data
+// is valid until the Interner is destroyed.
+// For ATOM_NONE, return a null Slice; any other atom MUST have been returned
+// by this Interner.
+Slice intern_slice(const Interner* in, Atom atom);
+
+// Return the hash_murmur3() hash for the bytes of an atom.
+// For ATOM_NONE, return 0; any other atom MUST have been returned by this
+// Interner.
+uint32_t intern_hash(const Interner* in, Atom atom);
+
+// Return the number of atoms in Interner.
+uint32_t intern_count(Interner* in);
+
+#endif
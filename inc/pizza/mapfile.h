@@ -0,0 +1,44 @@
+#ifndef MAPFILE_H_
+#define MAPFILE_H_
+
+/*
+ * MappedFile -- read-only access to the contents of a file, mapped into
+ * memory and exposed as a Slice.
+ * Nothing is copied: the Slice points straight into the page cache, and
+ * pages are only read from disk when they are touched.  This is the
+ * cheapest way to scan or hash a large file.
+ * The Slice MUST NOT be used after the MappedFile is destroyed; if the file
+ * is truncated while mapped, touching the missing pages raises SIGBUS.
+ */
+
+#include "path.h"
+#include "slice.h"
+
+// Hints about how a MappedFile will be accessed; they can be combined.
+#define MAPFILE_ADVISE_SEQUENTIAL (1U<<0) // read from start to end, aggressively
+#define MAPFILE_ADVISE_RANDOM     (1U<<1) // no read-ahead
+#define MAPFILE_ADVISE_WILLNEED   (1U<<2) // start reading all pages now
+#define MAPFILE_ADVISE_HUGEPAGE   (1U<<3) // use huge pages, if supported
+
+typedef struct MappedFile {
+    char* ptr;      // start of mapping, null for an empty file
+    SliceLen len;   // size of the file
+} MappedFile;
+
+// MappedFile constructor -- map the whole file given by p.
+// Return 0 for success, non-zero for error conditions.
+int mapfile_build(MappedFile* m, Path* p);
+
+// MappedFile destructor -- unmaps the file.
+void mapfile_destroy(MappedFile* m);
+
+// Return a Slice with the contents of the file.
+Slice mapfile_slice(const MappedFile* m);
+
+// Tell the kernel how the file will be accessed, using MAPFILE_ADVISE_XXX
+// flags.  Huge pages are only a wish: many file systems cannot provide them,
+// so failing to get them is not an error.
+// Return 0 for success, non-zero for error conditions.
+int mapfile_advise(MappedFile* m, unsigned flags);
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef MATCHER_H_
+#define MATCHER_H_
+
+/*
+ * SliceMatcher -- find ALL occurrences of a set of patterns in a single pass.
+ * The patterns are compiled once, when building the SliceMatcher, and the
+ * result can then be used to search any number of texts, even from several
+ * threads.  The search strategy depends on the patterns:
+ *
+ * - A single pattern is searched with the Two-Way algorithm, in linear time
+ *   and without any extra memory.
+ * - A few patterns are searched with a Teddy-style SIMD filter: 32 positions
+ *   at a time are checked against the first bytes of all patterns, and only
+ *   the candidates are compared in full.  This requires AVX2.
+ * - Any other set of patterns is searched with an Aho-Corasick automaton,
+ *   looking at each byte of the text exactly once.
+ *
+ * Every occurrence of every pattern is reported, including those that
+ * overlap, but not in any particular order.  Empty patterns never match.
+ */
+
+#include <stdint.h>
+#include "arena.h"
+#include "slice.h"
+
+// Sets with at most this many patterns can use the SIMD filter.
+#define MATCHER_TEDDY_MAX_PATTERNS 32
+
+typedef struct MatcherTwoWay MatcherTwoWay;
+typedef struct MatcherTeddy MatcherTeddy;
+typedef struct MatcherAuto MatcherAuto;
+
+typedef struct SliceMatcher {
+    Arena arena;            // holds the patterns and all the tables below
+    Slice* patterns;        // copy of each pattern
+    uint32_t count;         // number of patterns
+    MatcherTwoWay* twoway;  // for a single pattern
+    MatcherTeddy* teddy;    // for a few patterns
+    MatcherAuto* automaton; // for any number of patterns
+} SliceMatcher;
+
+// One occurrence of a pattern: the pattern index and the position where it
+// starts in the text.
+typedef struct SliceMatch {
+    SliceLen pos;
+    uint32_t pattern;
+} SliceMatch;
+
+// Called for each occurrence found, with the pattern index and the position
+// where it starts in the text; return non-zero to stop the search.
+typedef int (MatcherVisitor)(uint32_t pattern, SliceLen pos, void* arg);
+
+// SliceMatcher constructor, for count patterns; patterns are identified by
+// their index, and are copied, so they do not have to outlive the matcher.
+void matcher_build(SliceMatcher* m, const Slice* patterns, uint32_t count);
+
+// SliceMatcher destructor.
+void matcher_destroy(SliceMatcher* m);
+
+// Find all occurrences of the patterns in text, calling visit for each one.
+// Return the number of occurrences reported.
+SliceLen matcher_search(const SliceMatcher* m, Slice text, MatcherVisitor visit, void* arg);
+
+// Find all occurrences of the patterns in text, storing at most cap of them
+// in matches.
+// Return the number of occurrences in text, which may be larger than cap.
+SliceLen matcher_find_all(const SliceMatcher* m, Slice text, SliceMatch* matches, SliceLen cap);
+
+// Find the first occurrence of t in s with the Two-Way algorithm, without
+// building a SliceMatcher; return a null Slice if not found.
+Slice matcher_find_slice(Slice s, Slice t);
+
+#endif
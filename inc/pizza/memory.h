@@ -3,12 +3,20 @@
 
 /*
  * Functions to deal with memory.
+ *
+ * Ordinary allocations are NOT cleared when obtained, resized or released;
+ * define MEMORY_ZERO_OUT as 1 to get that behaviour back (for debugging).
+ * Sensitive data (keys, passphrases) should use the memory_secure_XXX()
+ * functions instead, which always wipe memory when releasing it.
  */
 
 #include <stddef.h>
+#include <stdint.h>
 #include <string.h>
 
-#define MEMORY_ZERO_OUT 1
+#if !defined(MEMORY_ZERO_OUT)
+#define MEMORY_ZERO_OUT 0
+#endif
 
 #if MEMORY_ZERO_OUT
 #define MEMORY_CLEAR(ptr, len) memset(ptr, 0, len)
@@ -19,37 +27,144 @@
 #define MEMORY_ALLOC(var, type) MEMORY_ALLOC_ARRAY(var, type, 1)
 
 #define MEMORY_ALLOC_ARRAY(var, type, count) \
+    MEMORY_ALLOC_ARRAY_TAG(var, type, count, MEMORY_TAG_OTHER)
+
+#define MEMORY_ALLOC_ARRAY_TAG(var, type, count, tag) \
     do { \
-        var = (type*) memory_realloc(0, count * sizeof(type)); \
+        var = (type*) memory_realloc_tag(0, 0, count * sizeof(type), tag); \
         MEMORY_CLEAR(var, count * sizeof(type)); \
     } while (0)
 
 #define MEMORY_FREE(var, type) MEMORY_FREE_ARRAY(var, type, 1)
 
 #define MEMORY_FREE_ARRAY(var, type, count) \
+    MEMORY_FREE_ARRAY_TAG(var, type, count, MEMORY_TAG_OTHER)
+
+#define MEMORY_FREE_ARRAY_TAG(var, type, count, tag) \
     do { \
         MEMORY_CLEAR(var, count * sizeof(type)); \
-        var = memory_realloc(var, 0); \
+        var = memory_realloc_tag(var, count * sizeof(type), 0, tag); \
     } while (0)
 
 #define MEMORY_ADJUST(var, ptr, olen, nlen) \
+    MEMORY_ADJUST_TAG(var, ptr, olen, nlen, MEMORY_TAG_OTHER)
+
+#define MEMORY_ADJUST_TAG(var, ptr, olen, nlen, tag) \
     do { \
         if (nlen < olen) { \
             MEMORY_CLEAR(ptr + nlen, olen - nlen); \
         } \
-        var = memory_realloc(ptr, nlen); \
+        var = memory_realloc_tag(ptr, olen, nlen, tag); \
         if (nlen > olen) { \
             MEMORY_CLEAR(var + olen, nlen - olen); \
         } \
     } while (0)
 
+// Flags for mapped memory.
+#define MEMORY_MAP_HUGE_PAGES (1U<<0) // ask for transparent huge pages
+
+// Flags for sensitive allocations.
+#define MEMORY_SECURE_LOCK (1U<<0) // lock memory so it never goes to swap
+
+// Subsystems that allocations are accounted for.
+typedef enum MemoryTag {
+    MEMORY_TAG_OTHER,
+    MEMORY_TAG_BUFFER,
+    MEMORY_TAG_PATH,
+    MEMORY_TAG_DEFLATOR,
+    MEMORY_TAG_THRPOOL,
+    MEMORY_TAG_CRYPTO,
+    MEMORY_TAG_LAST,
+} MemoryTag;
+
+// Allocation sizes are counted in power-of-two buckets; the last bucket
+// counts everything that is larger.
+#define MEMORY_HISTOGRAM_BUCKETS 24
+
+// Accounting for all allocations with a given tag.
+typedef struct MemoryTagStats {
+    int64_t live;       // bytes currently allocated
+    int64_t peak;       // maximum value ever seen for live
+    uint64_t allocs;    // number of allocations
+    uint64_t reallocs;  // number of size changes
+    uint64_t frees;     // number of releases
+    uint64_t histogram[MEMORY_HISTOGRAM_BUCKETS]; // sizes requested
+} MemoryTagStats;
+
+typedef struct MemoryStats {
+    MemoryTagStats tag[MEMORY_TAG_LAST];
+} MemoryStats;
+
+// An allocator that services all calls to memory_realloc().
+// Its realloc function follows the same conventions as memory_realloc(), with
+// an additional ctx argument; it should return 0 if it cannot get memory.
+typedef struct MemoryAllocator {
+    const char* name;
+    void* (*realloc)(void* ctx, void* ptr, size_t len);
+    void* ctx;
+} MemoryAllocator;
+
+// Default allocator, using the system's realloc() / free().
+extern const MemoryAllocator memory_allocator_system;
+
 // Dump a block of bytes into stderr with nice formatting.
 void dump_bytes(const void* ptr, size_t len);
 
-// Realloc a chunk of memory to a given size.  Useful to:
+// Realloc a chunk of memory to a given size, using the installed allocator.
+// Useful to:
 // len == 0            free memory pointed to by ptr
 // len > 0, ptr == 0   allocate a new chunk of memory of len bytes
 // len > 0, ptr != 0   reallocate memory of len bytes (larger or smaller)
+// If the allocator runs out of memory, this will abort().
 void* memory_realloc(void* ptr, size_t len);
 
+// Same as memory_realloc(), but also knowing the old size of the memory, and
+// the tag for the subsystem that requested it, so it can be accounted for.
+void* memory_realloc_tag(void* ptr, size_t olen, size_t nlen, MemoryTag tag);
+
+// Same as memory_realloc(), but always going straight to the system.
+// Allocators use this to get their own backing memory.
+void* memory_realloc_system(void* ptr, size_t len);
+
+// Map / remap / unmap anonymous memory straight from the OS, accounting for
+// it with tag.  Useful for large blocks, which can then grow without copying.
+// Conventions are the same as memory_realloc_tag(); memory is page-aligned.
+void* memory_remap(void* ptr, size_t olen, size_t nlen, unsigned flags, MemoryTag tag);
+
+// Allocate len bytes for sensitive data; memory is cleared.
+// With MEMORY_SECURE_LOCK, memory gets its own pages, which are locked in RAM
+// (if allowed) and excluded from core dumps.
+void* memory_secure_alloc(size_t len, unsigned flags);
+
+// Wipe and release memory obtained with memory_secure_alloc().
+// Both len and flags MUST be the same used when allocating.
+void memory_secure_free(void* ptr, size_t len, unsigned flags);
+
+// Wipe len bytes in a way that cannot be optimized away by the compiler.
+void memory_secure_wipe(void* ptr, size_t len);
+
+// Install an allocator for memory_realloc(); if 0, install the default one.
+// Return the previously installed allocator.
+// Memory MUST be released with the same allocator that obtained it, so this
+// should be done before any memory is allocated, or after all of it has been
+// released.  Blocks recycled by the calling thread's BufPool are released
+// before switching.
+const MemoryAllocator* memory_set_allocator(const MemoryAllocator* allocator);
+
+// Get the currently installed allocator.
+const MemoryAllocator* memory_get_allocator(void);
+
+// Enable / disable accounting of tagged allocations; disabled by default.
+// Counters are kept per thread, so they are cheap to update.
+void memory_stats_enable(int enabled);
+
+// Take a snapshot of the accounting for all threads.
+void memory_stats_snapshot(MemoryStats* stats);
+
+// Dump a snapshot of the accounting into stderr with nice formatting.
+void memory_stats_dump(const MemoryStats* stats);
+
+// Get the name for a tag.
+const char* memory_tag_name(MemoryTag tag);
+
 #endif
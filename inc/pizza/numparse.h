@@ -0,0 +1,32 @@
+#ifndef NUMPARSE_H_
+#define NUMPARSE_H_
+
+/*
+ * numparse -- fast and exact parsing of numbers from text.
+ * The whole input must be the number: no white space, no trailing garbage.
+ * Digits are checked and converted eight at a time with SWAR (SIMD within a
+ * register) arithmetic on 64-bit words.
+ * Doubles are always correctly rounded (round to nearest, ties to even): the
+ * common cases use Clinger's exact fast path or the Eisel-Lemire algorithm
+ * (Lemire, "Number Parsing at a Gigabyte per Second", 2021); only inputs with
+ * more than 19 significant digits that fall right between two doubles go
+ * through the much slower strtod().
+ *
+ * All functions return 0 for success, EINVAL if the input is not a valid
+ * number, and ERANGE if it cannot be represented; in that case the value is
+ * saturated as strtoll() / strtoull() / strtod() would.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Parse an optional sign followed by decimal digits.
+// Unsigned numbers only accept a '+' sign.
+int numparse_u64(const char* ptr, size_t len, uint64_t* val);
+int numparse_i64(const char* ptr, size_t len, int64_t* val);
+
+// Parse a double such as 3.14, -.5, 1e10, 6.02E+23, inf, -infinity or nan
+// (the last three in any case).
+int numparse_double(const char* ptr, size_t len, double* val);
+
+#endif
@@ -12,6 +12,7 @@
 
 #include <dirent.h>
 #include "buffer.h"
+#include "bufchain.h"
 
 typedef struct Path {
     Buffer name;
@@ -67,9 +68,16 @@ int path_touch(Path* p);
 int path_unlink(Path* p);
 
 // Append to a Buffer the contents of file given by p.
+// The Buffer is sized for the whole file before reading.
 // Return 0 for success, non-zero for error conditions.
 int path_slurp(Path* p, Buffer* b);
 
+// Copy the contents of file given by p to file given by to, letting the
+// kernel move the data when possible.
+// Return 0 for success, non-zero for error conditions.
+// File to will be created / overwritten.
+int path_copy(Path* p, Path* to);
+
 // Write the contents of a Slice to file given by p.
 // Return 0 for success, non-zero for error conditions.
 // File will be created / overwritten.
@@ -80,6 +88,13 @@ int path_spew(Path* p, Slice s);
 // File will be created / appended to.
 int path_append(Path* p, Slice s);
 
+// Write / append all segments of a BufferChain to file given by p, without
+// copying them into a contiguous Buffer first.
+// Return 0 for success, non-zero for error conditions.
+// File will be created / overwritten or appended to.
+int path_spew_chain(Path* p, const BufferChain* c);
+int path_append_chain(Path* p, const BufferChain* c);
+
 // If p = /a/b/c, parent => /a/b
 int path_parent(Path* p, Path* parent);
 
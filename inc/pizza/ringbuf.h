@@ -0,0 +1,67 @@
+#ifndef RINGBUF_H_
+#define RINGBUF_H_
+
+/*
+ * RingBuffer -- a fixed-size FIFO of bytes that never wraps around.
+ * The storage is an anonymous memory file mapped twice, back to back, so
+ * that byte j and byte j + size are the same byte.  This means both the
+ * readable data and the free space are ALWAYS contiguous in memory: the data
+ * can be handed out as a plain Slice, and read() / write() on a file
+ * descriptor can work on the ring directly, without any copying to deal with
+ * the wraparound.
+ * The size is rounded up to a multiple of the page size.
+ * A RingBuffer is NOT thread-safe.
+ */
+
+#include "slice.h"
+
+typedef struct RingBuffer {
+    char* ptr;      // start of first mapping; second one follows right after
+    SliceLen size;  // size of each mapping
+    SliceLen pos;   // offset of first readable byte, always < size
+    SliceLen len;   // number of readable bytes
+} RingBuffer;
+
+// RingBuffer constructor, for a ring with room for at least size bytes.
+// Return 0 for success, non-zero for error conditions.
+int ringbuf_build(RingBuffer* r, SliceLen size);
+
+// RingBuffer destructor.
+void ringbuf_destroy(RingBuffer* r);
+
+// Remove all data from the ring.
+void ringbuf_clear(RingBuffer* r);
+
+// Return the number of bytes that can be added to the ring.
+#define ringbuf_room(r) ((r)->size - (r)->len)
+
+// Return a Slice with all the readable data in the ring.
+Slice ringbuf_slice(const RingBuffer* r);
+
+// Return a pointer to the free space in the ring, where up to
+// ringbuf_room(r) bytes can be written; after writing n of them, call
+// ringbuf_commit(r, n) to make them readable.
+char* ringbuf_tail(const RingBuffer* r);
+
+// Make n bytes written at ringbuf_tail() readable.
+void ringbuf_commit(RingBuffer* r, SliceLen n);
+
+// Drop n bytes from the front of the ring (all of them if n is too large).
+void ringbuf_consume(RingBuffer* r, SliceLen n);
+
+// Copy as much of a Slice as fits into the ring.
+// Return the number of bytes copied.
+SliceLen ringbuf_append_slice(RingBuffer* r, Slice s);
+
+// Do one read() from a file descriptor into the free space in the ring, and
+// store in nread the number of bytes read, with 0 meaning end of file.
+// Return 0 for success, non-zero for error conditions (including a full
+// ring).
+int ringbuf_read_fd(RingBuffer* r, int fd, SliceLen* nread);
+
+// Do one write() of the readable data in the ring to a file descriptor,
+// consume the bytes that were written and store their number in nwritten.
+// Return 0 for success, non-zero for error conditions.
+int ringbuf_write_fd(RingBuffer* r, int fd, SliceLen* nwritten);
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef SCAN_H_
+#define SCAN_H_
+
+/*
+ * Scan -- fast searches for bytes in memory.
+ * These are the building blocks for the Slice search and tokenizing
+ * functions.  On x86 they look at 16 (SSE2) or 32 (AVX2) bytes at a time;
+ * the best version supported by the CPU is chosen at run time, and there is
+ * a plain C version for everything else.
+ * A ScanSet is a set of bytes; sets with few distinct bytes, or with bytes
+ * that fall into few groups of 16 (such as most ASCII punctuation), are
+ * searched with SIMD code, and any other set one byte at a time.
+ * There are also ASCII case-insensitive comparisons and searches, and case
+ * conversions; they never look at the locale, and only change 'A' to 'Z'
+ * and 'a' to 'z'.
+ * Define SCAN_SIMD as 0 to compile only the plain C code.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if !defined(SCAN_SIMD)
+#define SCAN_SIMD 1
+#endif
+
+// Implementations, from slowest to fastest.
+#define SCAN_LEVEL_SCALAR 0
+#define SCAN_LEVEL_SSE2   1
+#define SCAN_LEVEL_AVX2   2
+
+// Sets with at most this many distinct bytes can always use SIMD code.
+#define SCAN_SET_MAX_BYTES 16
+
+typedef struct ScanSet {
+    char map[256];                    // 1 for bytes in the set, 0 otherwise
+    char bytes[SCAN_SET_MAX_BYTES];   // distinct bytes, if there are few
+    uint8_t lo[16];                   // bucket bits, by low nibble
+    uint8_t hi[16];                   // bucket bits, by high nibble
+    uint16_t count;                   // number of distinct bytes in the set
+    uint8_t nibbles;                  // 1 if set can be searched by nibbles
+} ScanSet;
+
+// Return the implementation currently used.
+int scan_get_level(void);
+
+// Use a given implementation, or the best one supported by the CPU if it is
+// not supported; return the implementation that will actually be used.
+// Mostly useful for testing and benchmarking.
+int scan_set_level(int level);
+
+// Return a pointer to the first / last occurrence of byte t in len bytes
+// starting at ptr, or null if it is not there.
+const char* scan_byte(const char* ptr, size_t len, char t);
+const char* scan_byte_reverse(const char* ptr, size_t len, char t);
+
+// Build a ScanSet with the len bytes starting at ptr; repeats are fine.
+void scan_set_build(ScanSet* set, const char* ptr, size_t len);
+
+// Return a pointer to the first byte in len bytes starting at ptr that is /
+// is not in the set, or null if there is none.
+const char* scan_set_first_in(const char* ptr, size_t len, const ScanSet* set);
+const char* scan_set_first_not_in(const char* ptr, size_t len, const ScanSet* set);
+
+// Classify len bytes starting at ptr, 64 at a time: bit j of masks[k] is set
+// if byte 64 * k + j is in the set.  masks must have room for (len + 63) / 64
+// words; bits past len are cleared.
+void scan_set_masks(const char* ptr, size_t len, const ScanSet* set, uint64_t* masks);
+
+// Convert the len bytes starting at ptr to ASCII lower / upper case, in place.
+void scan_to_lower(char* ptr, size_t len);
+void scan_to_upper(char* ptr, size_t len);
+
+// Return how many of the first len bytes at l and r are the same, ignoring
+// ASCII case.
+size_t scan_prefix_nocase(const char* l, const char* r, size_t len);
+
+// Return a pointer to the first occurrence of the nlen bytes at needle in the
+// len bytes starting at ptr, ignoring ASCII case, or null if it is not there.
+const char* scan_find_nocase(const char* ptr, size_t len, const char* needle, size_t nlen);
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef SLAB_H_
+#define SLAB_H_
+
+/*
+ * Slab -- an allocator for small, fixed-size objects.
+ * Requests are rounded up to a power-of-two size class; each class carves its
+ * objects out of large pages and keeps a free list of released objects, so
+ * both allocating and releasing are O(1) and never touch malloc once the
+ * pages are there.
+ * Requests larger than SLAB_MAX_SIZE go straight to the system.
+ * A Slab is NOT thread-safe; use one per thread.
+ * Meant for code that allocates and releases many small objects of its own,
+ * such as nodes of lists and trees, or per-request state.  The fixed-size
+ * types in this library do not need it: Path, Wedge, MD5 and Crypto are
+ * built in memory owned by their caller, and ThrPoolTask lives in an array
+ * allocated once per ThrPool.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include "memory.h"
+
+#define SLAB_MIN_SHIFT    4                       // smallest class: 16 bytes
+#define SLAB_MAX_SHIFT   11                       // largest class: 2048 bytes
+#define SLAB_MIN_SIZE    (1UL << SLAB_MIN_SHIFT)
+#define SLAB_MAX_SIZE    (1UL << SLAB_MAX_SHIFT)
+#define SLAB_NUM_CLASSES (SLAB_MAX_SHIFT - SLAB_MIN_SHIFT + 1)
+
+// Size of the pages used to carve objects for all classes.
+#define SLAB_PAGE_SIZE   (64UL * 1024UL)
+
+// Allocate / release one object of a given type from a Slab.
+// Contents are NOT cleared.
+#define SLAB_ALLOC(slab, var, type) \
+    do { \
+        var = (type*) slab_alloc(slab, sizeof(type)); \
+    } while (0)
+
+#define SLAB_FREE(slab, var, type) \
+    do { \
+        slab_free(slab, var, sizeof(type)); \
+        var = 0; \
+    } while (0)
+
+typedef struct SlabPage SlabPage;
+
+typedef struct SlabClass {
+    void* free;        // list of released objects
+    char* next;        // next unused object in current page
+    char* top;         // end of current page
+    uint32_t live;     // number of objects currently handed out
+} SlabClass;
+
+typedef struct Slab {
+    SlabClass classes[SLAB_NUM_CLASSES];
+    SlabPage* pages;   // all pages, released when Slab is destroyed
+} Slab;
+
+// Slab constructor.
+void slab_build(Slab* slab);
+
+// Slab destructor -- releases all pages, even if objects are still live.
+void slab_destroy(Slab* slab);
+
+// Allocate an object of len bytes.
+void* slab_alloc(Slab* slab, size_t len);
+
+// Release an object of len bytes; len MUST be the same used to allocate it.
+void slab_free(Slab* slab, void* ptr, size_t len);
+
+// Return the size of the class that will be used for objects of len bytes,
+// or 0 if they are too large for the Slab.
+size_t slab_class_size(size_t len);
+
+// Fill in allocator so that, once installed, memory_realloc() takes its
+// memory from Slab slab.
+void slab_allocator(Slab* slab, MemoryAllocator* allocator);
+
+#endif
@@ -13,6 +13,7 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include "scan.h"
 
 /*
  * I would LOVE to use `uint8_t` as a `Byte`.  However, it is impractical
@@ -23,14 +24,34 @@
  * typedef uint8_t Byte;
  */
 
+/*
+ * Width of the lengths used by Slices and Buffers.
+ * By default these are 32 bits, which keeps both types small but limits them
+ * to 4 GiB of data.  Define SLICE_LEN_BITS=64 to handle larger data; Slice
+ * does not change size, but Buffer has a little less space for inline data.
+ */
+#if !defined(SLICE_LEN_BITS)
+#define SLICE_LEN_BITS 32
+#endif
+
+#if SLICE_LEN_BITS == 64
+typedef uint64_t SliceLen;
+#define SLICE_LEN_MAX UINT64_MAX
+#elif SLICE_LEN_BITS == 32
+typedef uint32_t SliceLen;
+#define SLICE_LEN_MAX UINT32_MAX
+#else
+#error "SLICE_LEN_BITS must be 32 or 64"
+#endif
+
 typedef struct Slice {
     const char* ptr; // pointer to beginning of data
-    uint32_t len;    // length of data
+    SliceLen len;    // length of data
 } Slice;
 
 // "context" when calling functions to tokenize
 typedef struct SliceLookup {
-    char map[256];
+    ScanSet set;
     Slice result;
 } SliceLookup;
 
@@ -41,13 +62,16 @@ typedef struct SliceLookup {
 // slice_compare() returns 0 for them.
 #define slice_equal(l, r) (((l).len == (r).len) && (slice_compare(l, r) == 0))
 
+// Same as slice_equal(), ignoring ASCII case.
+#define slice_equal_nocase(l, r) (((l).len == (r).len) && (slice_compare_nocase(l, r) == 0))
+
 // Slice constructor from a string (const char*).
 // If len < 0, use null terminator, otherwise copy len bytes.
 Slice slice_from_string(const char* str, int len);
 
 // Slice constructor from a pointer and a length.
 // Pointed data doesn't have to be null-terminated.
-Slice slice_from_memory(const char* ptr, uint32_t len);
+Slice slice_from_memory(const char* ptr, SliceLen len);
 
 
 /*
@@ -62,9 +86,20 @@ Slice slice_trim(Slice s);
 // Return 0 if conversion is not possible, 1 otherwise.
 int slice_int(Slice s, int* val);
 
+// Convert a whole slice to a signed / unsigned 64-bit integer, or to a
+// correctly rounded double -- see numparse.h.
+// Return 0 for success, EINVAL if slice is not a valid number, ERANGE if the
+// number does not fit (and then val is saturated).
+int slice_parse_i64(Slice s, int64_t* val);
+int slice_parse_u64(Slice s, uint64_t* val);
+int slice_parse_double(Slice s, double* val);
+
 // Compare two Slices, returning: l < r: -1; l > r: 1; l == r: 0
 int slice_compare(Slice l, Slice r);
 
+// Compare two Slices ignoring ASCII case, as if both were in lower case.
+int slice_compare_nocase(Slice l, Slice r);
+
 // Find byte in Slice.
 // Return an empty slice if not found.
 Slice slice_find_byte(Slice s, char t);
@@ -73,6 +108,10 @@ Slice slice_find_byte(Slice s, char t);
 // Return an empty slice if not found.
 Slice slice_find_slice(Slice s, Slice t);
 
+// Find Slice in Slice, ignoring ASCII case.
+// Return an empty slice if not found.
+Slice slice_find_slice_nocase(Slice s, Slice t);
+
 // Tokenize Slice by repeatedly searching for any character in a separator slice.
 // Return true if separator was found, false otherwise.
 // Return each token in lookup.result; only valid when true was returned.
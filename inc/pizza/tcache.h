@@ -0,0 +1,20 @@
+#ifndef TCACHE_H_
+#define TCACHE_H_
+
+/*
+ * TCache -- an allocator with per-thread caches.
+ * Each thread gets its own Slab, so small allocations never contend on a
+ * lock; larger ones go straight to the system.
+ * A block released by a thread other than the one that allocated it is
+ * handed back to its owner through a lock-free list, and the owner recycles
+ * it on its next allocation.
+ * Caches of threads that exit are kept around and adopted by new threads.
+ */
+
+#include "memory.h"
+
+// Get the allocator that uses per-thread caches, ready to be installed with
+// memory_set_allocator().
+const MemoryAllocator* tcache_allocator(void);
+
+#endif
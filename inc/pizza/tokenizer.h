@@ -0,0 +1,40 @@
+#ifndef TOKENIZER_H_
+#define TOKENIZER_H_
+
+/*
+ * Tokenizer -- split a Slice into ALL its tokens in a single pass.
+ * Tokens are separated by runs of bytes from a separator set, exactly as with
+ * slice_tokenize_by_slice(), but instead of returning one token per call, the
+ * input is classified 64 bytes at a time into bit masks, and the positions
+ * where tokens start and end are written into an array of offsets:
+ * token k goes from offsets[2 * k] to offsets[2 * k + 1].
+ * A Tokenizer only holds the separator set, so it can be built once and then
+ * used on any number of inputs, even from several threads.
+ */
+
+#include "arena.h"
+#include "scan.h"
+#include "slice.h"
+
+typedef struct Tokenizer {
+    ScanSet set;    // separators
+} Tokenizer;
+
+// Get token k from the offsets produced for Slice src.
+#define tokenizer_token(src, offsets, k) \
+    slice_from_memory((src).ptr + (offsets)[2 * (k)], (offsets)[2 * (k) + 1] - (offsets)[2 * (k)])
+
+// Tokenizer constructor, for a given set of separators.
+void tokenizer_build(Tokenizer* t, Slice sep);
+
+// Find all tokens in src, storing the offsets for at most cap tokens in
+// offsets, which must have room for 2 * cap values.
+// Return the number of tokens in src, which may be larger than cap.
+SliceLen tokenizer_split(const Tokenizer* t, Slice src, SliceLen* offsets, SliceLen cap);
+
+// Find all tokens in src, storing their offsets in an array allocated from
+// an Arena and returned in offsets.
+// Return the number of tokens in src.
+SliceLen tokenizer_split_in_arena(const Tokenizer* t, Slice src, Arena* arena, SliceLen** offsets);
+
+#endif
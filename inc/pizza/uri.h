@@ -7,7 +7,7 @@
 
 #include "buffer.h"
 
-int uri_decode(Slice encoded, Buffer *decoded);
-int uri_encode(Slice decoded, Buffer *encoded);
+SliceLen uri_decode(Slice encoded, Buffer *decoded);
+SliceLen uri_encode(Slice decoded, Buffer *encoded);
 
 #endif
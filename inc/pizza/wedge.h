@@ -15,7 +15,7 @@ typedef struct Wedge {
 
 void wedge_build_from_string(Wedge* w, const char* str);
 void wedge_build_from_char(Wedge* w, const char chr);
-void wedge_build_from_ptr_len(Wedge* w, const char* ptr, uint32_t len);
+void wedge_build_from_ptr_len(Wedge* w, const char* ptr, SliceLen len);
 void wedge_build_from_buffer(Wedge* w, Buffer* b);
 void wedge_build_from_slice(Wedge* w, Slice s);
 
@@ -0,0 +1,198 @@
+#include <stdint.h>
+#include "pizza/memory.h"
+#include "pizza/arena.h"
+
+// Round a size up to the arena alignment.
+#define ARENA_ALIGN_UP(n) (((n) + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1))
+
+struct ArenaChunk {
+    ArenaChunk* next;   // next chunk in the list
+    size_t cap;         // total bytes available in data
+    size_t pos;         // bytes already used in data
+    char* data;         // aligned start of the chunk's data
+};
+
+static ArenaChunk* chunk_create(size_t cap);
+static void* chunk_carve(ArenaChunk* c, size_t len);
+static void* arena_allocator_realloc(void* ctx, void* ptr, size_t len);
+
+void arena_build(Arena* a, size_t chunk_size) {
+    memset(a, 0, sizeof(Arena));
+    a->chunk_size = chunk_size == 0 ? ARENA_DEFAULT_CHUNK_SIZE : chunk_size;
+}
+
+void arena_destroy(Arena* a) {
+    ArenaChunk* c = a->head;
+    while (c) {
+        ArenaChunk* n = c->next;
+        memory_realloc_system(c, 0);
+        c = n;
+    }
+    memset(a, 0, sizeof(Arena));
+}
+
+void* arena_alloc(Arena* a, size_t len) {
+    if (len == 0) {
+        len = 1;
+    }
+
+    void* ptr = 0;
+    do {
+        if (a->current) {
+            ptr = chunk_carve(a->current, len);
+            if (ptr) {
+                break;
+            }
+
+            // current chunk is full -- a following chunk may have been left
+            // over after a rewind / reset
+            ArenaChunk* n = a->current->next;
+            if (n && n->cap >= len) {
+                n->pos = 0;
+                a->current = n;
+                ptr = chunk_carve(n, len);
+                break;
+            }
+        }
+
+        // need a new chunk, inserted right after current one, so that the
+        // list order always matches the allocation order
+        size_t cap = len > a->chunk_size ? len : a->chunk_size;
+        ArenaChunk* c = chunk_create(cap);
+        if (a->current) {
+            c->next = a->current->next;
+            a->current->next = c;
+        } else {
+            c->next = a->head;
+            a->head = c;
+        }
+        a->current = c;
+        ptr = chunk_carve(c, len);
+    } while (0);
+
+    a->last = ptr;
+    return ptr;
+}
+
+void* arena_realloc(Arena* a, void* ptr, size_t olen, size_t nlen) {
+    if (!ptr) {
+        return nlen ? arena_alloc(a, nlen) : 0;
+    }
+
+    ArenaChunk* c = a->current;
+    int is_last = ptr == a->last && c;
+    if (nlen == 0) {
+        if (is_last) {
+            // give back the space for the last allocation
+            c->pos = (char*) ptr - c->data;
+            a->last = 0;
+        }
+        return 0;
+    }
+
+    if (nlen <= olen) {
+        if (is_last) {
+            c->pos = ((char*) ptr - c->data) + ARENA_ALIGN_UP(nlen);
+        }
+        return ptr;
+    }
+
+    if (is_last) {
+        size_t start = (char*) ptr - c->data;
+        if (start + nlen <= c->cap) {
+            // last allocation and there is room -- grow in place
+            c->pos = start + ARENA_ALIGN_UP(nlen);
+            return ptr;
+        }
+    }
+
+    void* tmp = arena_alloc(a, nlen);
+    memcpy(tmp, ptr, olen);
+    return tmp;
+}
+
+ArenaMark arena_mark(const Arena* a) {
+    ArenaMark mark = {
+        .chunk = a->current,
+        .pos = a->current ? a->current->pos : 0,
+    };
+    return mark;
+}
+
+void arena_rewind(Arena* a, ArenaMark mark) {
+    if (!mark.chunk) {
+        arena_reset(a);
+        return;
+    }
+    mark.chunk->pos = mark.pos;
+    for (ArenaChunk* c = mark.chunk->next; c; c = c->next) {
+        c->pos = 0;
+    }
+    a->current = mark.chunk;
+    a->last = 0;
+}
+
+void arena_reset(Arena* a) {
+    for (ArenaChunk* c = a->head; c; c = c->next) {
+        c->pos = 0;
+    }
+    a->current = a->head;
+    a->last = 0;
+}
+
+size_t arena_capacity(const Arena* a) {
+    size_t total = 0;
+    for (ArenaChunk* c = a->head; c; c = c->next) {
+        total += c->cap;
+    }
+    return total;
+}
+
+void arena_allocator(Arena* a, MemoryAllocator* allocator) {
+    allocator->name = "arena";
+    allocator->realloc = arena_allocator_realloc;
+    allocator->ctx = a;
+}
+
+static void* arena_allocator_realloc(void* ctx, void* ptr, size_t len) {
+    // memory_realloc() does not tell us the old size, so we keep it in a
+    // header right before each block
+    Arena* a = (Arena*) ctx;
+    size_t olen = 0;
+    char* block = 0;
+    if (ptr) {
+        block = (char*) ptr - ARENA_ALIGNMENT;
+        memcpy(&olen, block, sizeof(size_t));
+        olen += ARENA_ALIGNMENT;
+    }
+    size_t nlen = len ? len + ARENA_ALIGNMENT : 0;
+    block = (char*) arena_realloc(a, block, olen, nlen);
+    if (!block) {
+        return 0;
+    }
+    memcpy(block, &len, sizeof(size_t));
+    return block + ARENA_ALIGNMENT;
+}
+
+static ArenaChunk* chunk_create(size_t cap) {
+    // allocate header and data in one go, with enough slack to align data
+    cap = ARENA_ALIGN_UP(cap);
+    size_t bytes = sizeof(ArenaChunk) + ARENA_ALIGNMENT + cap;
+    ArenaChunk* c = (ArenaChunk*) memory_realloc_system(0, bytes);
+    uintptr_t data = (uintptr_t) (c + 1);
+    c->data = (char*) ARENA_ALIGN_UP(data);
+    c->next = 0;
+    c->cap = cap;
+    c->pos = 0;
+    return c;
+}
+
+static void* chunk_carve(ArenaChunk* c, size_t len) {
+    size_t need = ARENA_ALIGN_UP(len);
+    if (c->pos + need > c->cap) {
+        return 0;
+    }
+    void* ptr = c->data + c->pos;
+    c->pos += need;
+    return ptr;
+}
@@ -28,33 +28,36 @@ static const char dec_64[] =
 #define B64DEC2(s, p) (uint8_t)((E64(s.ptr[p+1]) << 4) | (E64(s.ptr[p+2]) >> 2))
 #define B64DEC3(s, p) (uint8_t)((E64(s.ptr[p+2]) << 6) | (E64(s.ptr[p+3]) >> 0))
 
-int base64_decode(Slice encoded, Buffer *decoded) {
-    uint32_t left = 0;
+SliceLen base64_decode(Slice encoded, Buffer *decoded) {
+    SliceLen left = 0;
     while (left < encoded.len && E64(encoded.ptr[left]) < 64) {
         ++left;
     }
 
-    int orig = decoded->len;
-    uint32_t pos = 0;
+    // every 4 input bytes produce at most 3 output bytes
+    char* out = buffer_reserve_tail(decoded, (left / 4 + 1) * 3);
+    SliceLen len = 0;
+    SliceLen pos = 0;
     while (left > 4) {
-        buffer_append_byte(decoded, B64DEC1(encoded, pos));
-        buffer_append_byte(decoded, B64DEC2(encoded, pos));
-        buffer_append_byte(decoded, B64DEC3(encoded, pos));
+        out[len++] = B64DEC1(encoded, pos);
+        out[len++] = B64DEC2(encoded, pos);
+        out[len++] = B64DEC3(encoded, pos);
         pos += 4;
         left -= 4;
     }
 
     if (left > 1) {
-        buffer_append_byte(decoded, B64DEC1(encoded, pos));
+        out[len++] = B64DEC1(encoded, pos);
     }
     if (left > 2) {
-        buffer_append_byte(decoded, B64DEC2(encoded, pos));
+        out[len++] = B64DEC2(encoded, pos);
     }
     if (left > 3) {
-        buffer_append_byte(decoded, B64DEC3(encoded, pos));
+        out[len++] = B64DEC3(encoded, pos);
     }
 
-    return decoded->len - orig;
+    buffer_commit(decoded, len);
+    return len;
 }
 
 #define B64PAD '='
@@ -65,14 +68,17 @@ int base64_decode(Slice encoded, Buffer *decoded) {
 #define B64ENC3b(s, p) ((s.ptr[p+2] & 0xC0) >> 6)
 #define B64ENC4x(s, p) ((s.ptr[p+2] & 0x3F))
 
-int base64_encode(Slice decoded, Buffer *encoded) {
-    int orig = encoded->len;
-    uint32_t pos = 0;
-    while (pos < (decoded.len - 2)) {
-        buffer_append_byte(encoded, D64(B64ENC1x(decoded, pos)));
-        buffer_append_byte(encoded, D64(B64ENC2a(decoded, pos) | B64ENC2b(decoded, pos)));
-        buffer_append_byte(encoded, D64(B64ENC3a(decoded, pos) | B64ENC3b(decoded, pos)));
-        buffer_append_byte(encoded, D64(B64ENC4x(decoded, pos)));
+SliceLen base64_encode(Slice decoded, Buffer *encoded) {
+    // every 3 input bytes (or fewer, at the end) produce 4 output bytes
+    SliceLen total = (decoded.len + 2) / 3 * 4;
+    char* out = buffer_reserve_tail(encoded, total);
+    SliceLen len = 0;
+    SliceLen pos = 0;
+    while (pos + 2 < decoded.len) {
+        out[len++] = D64(B64ENC1x(decoded, pos));
+        out[len++] = D64(B64ENC2a(decoded, pos) | B64ENC2b(decoded, pos));
+        out[len++] = D64(B64ENC3a(decoded, pos) | B64ENC3b(decoded, pos));
+        out[len++] = D64(B64ENC4x(decoded, pos));
         pos += 3;
     }
 
@@ -80,18 +86,19 @@ int base64_encode(Slice decoded, Buffer *encoded) {
         case 0:
             break;
         case 1:
-            buffer_append_byte(encoded, D64(B64ENC1x(decoded, pos)));
-            buffer_append_byte(encoded, D64(B64ENC2a(decoded, pos)));
-            buffer_append_byte(encoded, B64PAD);
-            buffer_append_byte(encoded, B64PAD);
+            out[len++] = D64(B64ENC1x(decoded, pos));
+            out[len++] = D64(B64ENC2a(decoded, pos));
+            out[len++] = B64PAD;
+            out[len++] = B64PAD;
             break;
         case 2:
-            buffer_append_byte(encoded, D64(B64ENC1x(decoded, pos)));
-            buffer_append_byte(encoded, D64(B64ENC2a(decoded, pos) | B64ENC2b(decoded, pos)));
-            buffer_append_byte(encoded, D64(B64ENC3a(decoded, pos)));
-            buffer_append_byte(encoded, B64PAD);
+            out[len++] = D64(B64ENC1x(decoded, pos));
+            out[len++] = D64(B64ENC2a(decoded, pos) | B64ENC2b(decoded, pos));
+            out[len++] = D64(B64ENC3a(decoded, pos));
+            out[len++] = B64PAD;
             break;
     }
 
-    return encoded->len - orig;
+    buffer_commit(encoded, len);
+    return len;
 }
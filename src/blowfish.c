@@ -1,5 +1,6 @@
 #include <assert.h>
 #include <endian.h>
+#include "pizza/memory.h"
 #include "pizza/blowfish.h"
 
 /*
@@ -495,6 +496,10 @@ void blowfish_init(Blowfish* bf, const char* key, uint32_t len) {
     bf_gen_subkeys(bf, key, len);
 }
 
+void blowfish_destroy(Blowfish* bf) {
+    memory_secure_wipe(bf, sizeof(Blowfish));
+}
+
 void blowfish_encrypt_LE(Blowfish* bf, uint8_t* ptr, uint32_t len) {
     BF_CHECK(ptr, len, NUM_BYTES_PER_ITER);
     LE_BEF(ptr, len);
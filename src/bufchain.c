@@ -0,0 +1,150 @@
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include "pizza/log.h"
+#include "pizza/memory.h"
+#include "pizza/bufchain.h"
+
+#define BUFCHAIN_GROWTH_FACTOR           2  // how segment array grows when needed
+#define BUFCHAIN_COPY_BLOCK_SIZE      4096  // block size for copied bytes
+#define BUFCHAIN_WRITE_BATCH            64  // max segments per writev() call
+
+static void bufchain_add(BufferChain* c, const char* ptr, SliceLen len);
+
+void bufchain_build(BufferChain* c) {
+    memset(c, 0, sizeof(BufferChain));
+    c->seg = c->buf;
+    c->cap = BUFCHAIN_INLINE_SEGMENTS;
+    arena_build(&c->copies, 0);
+}
+
+void bufchain_destroy(BufferChain* c) {
+    if (c->seg != c->buf) {
+        memory_realloc_tag(c->seg, c->cap * sizeof(struct iovec), 0, MEMORY_TAG_BUFFER);
+    }
+    arena_destroy(&c->copies);
+    c->tail = 0;
+    c->room = 0;
+    c->seg = c->buf;
+    c->cap = BUFCHAIN_INLINE_SEGMENTS;
+    c->cnt = 0;
+    c->len = 0;
+}
+
+void bufchain_clear(BufferChain* c) {
+    c->cnt = 0;
+    c->len = 0;
+    arena_reset(&c->copies);
+    c->tail = 0;
+    c->room = 0;
+}
+
+void bufchain_append_slice(BufferChain* c, Slice s) {
+    bufchain_add(c, s.ptr, s.len);
+}
+
+void bufchain_append_buffer(BufferChain* c, const Buffer* b) {
+    Slice s = buffer_slice(b);
+    bufchain_add(c, s.ptr, s.len);
+}
+
+void bufchain_append_copy(BufferChain* c, Slice s) {
+    if (s.len == 0) {
+        return;
+    }
+    if (s.len > c->room) {
+        size_t size = s.len > BUFCHAIN_COPY_BLOCK_SIZE ? s.len : BUFCHAIN_COPY_BLOCK_SIZE;
+        c->tail = (char*) arena_alloc(&c->copies, size);
+        c->room = size;
+    }
+    // copies are packed one after the other, so consecutive copies get
+    // merged into a single segment
+    memcpy(c->tail, s.ptr, s.len);
+    bufchain_add(c, c->tail, s.len);
+    c->tail += s.len;
+    c->room -= s.len;
+}
+
+const struct iovec* bufchain_iovec(const BufferChain* c, int* cnt) {
+    *cnt = c->cnt;
+    return c->seg;
+}
+
+void bufchain_flatten(const BufferChain* c, Buffer* b) {
+    buffer_ensure_extra(b, c->len);
+    for (uint32_t j = 0; j < c->cnt; ++j) {
+        memcpy(b->ptr + b->len, c->seg[j].iov_base, c->seg[j].iov_len);
+        b->len += c->seg[j].iov_len;
+    }
+}
+
+int bufchain_write_fd(const BufferChain* c, int fd) {
+    int ret = 0;
+    uint32_t pos = 0;   // first segment not fully written yet
+    size_t off = 0;     // bytes already written from segment pos
+    while (pos < c->cnt) {
+        // writev() has a limit on the number of segments, so write them in
+        // batches; the first one may have been partially written already
+        struct iovec batch[BUFCHAIN_WRITE_BATCH];
+        int n = 0;
+        for (uint32_t j = pos; j < c->cnt && n < BUFCHAIN_WRITE_BATCH; ++j, ++n) {
+            batch[n] = c->seg[j];
+        }
+        batch[0].iov_base = (char*) batch[0].iov_base + off;
+        batch[0].iov_len -= off;
+
+        ssize_t nwritten = writev(fd, batch, n);
+        if (nwritten < 0 && errno == EINTR) {
+            continue;
+        }
+        if (nwritten <= 0) {
+            ret = nwritten < 0 ? errno : EIO;
+            break;
+        }
+        LOG_DEBUG("WRITEV %d segments => %ld", n, (long) nwritten);
+
+        // skip over all fully written segments
+        size_t left = nwritten;
+        while (pos < c->cnt && left >= c->seg[pos].iov_len - off) {
+            left -= c->seg[pos].iov_len - off;
+            off = 0;
+            ++pos;
+        }
+        off += left;
+    }
+    return ret;
+}
+
+static void bufchain_add(BufferChain* c, const char* ptr, SliceLen len) {
+    if (len == 0) {
+        return;
+    }
+    c->len += len;
+
+    if (c->cnt > 0) {
+        struct iovec* last = &c->seg[c->cnt - 1];
+        if ((const char*) last->iov_base + last->iov_len == ptr) {
+            // contiguous with last segment -- extend it
+            last->iov_len += len;
+            return;
+        }
+    }
+
+    if (c->cnt >= c->cap) {
+        uint32_t cap = c->cap * BUFCHAIN_GROWTH_FACTOR;
+        struct iovec* tmp = 0;
+        if (c->seg == c->buf) {
+            // switch from inline segments to heap-allocated ones
+            tmp = (struct iovec*) memory_realloc_tag(0, 0, cap * sizeof(struct iovec), MEMORY_TAG_BUFFER);
+            memcpy(tmp, c->buf, c->cnt * sizeof(struct iovec));
+        } else {
+            tmp = (struct iovec*) memory_realloc_tag(c->seg, c->cap * sizeof(struct iovec), cap * sizeof(struct iovec), MEMORY_TAG_BUFFER);
+        }
+        c->seg = tmp;
+        c->cap = cap;
+    }
+
+    struct iovec* seg = &c->seg[c->cnt++];
+    seg->iov_base = (void*) ptr;
+    seg->iov_len = len;
+}
@@ -1,4 +1,13 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
 #include "pizza/stb_sprintf.h"
+#include "pizza/dtoa.h"
+#include "pizza/bufpool.h"
+#include "pizza/log.h"
 #include "pizza/memory.h"
 #include "pizza/buffer.h"
 
@@ -9,39 +18,64 @@
 
 #define BUFFER_DEFAULT_CAPACITY BUFFER_DESIRED_SIZE  // default size for Buffer
 #define BUFFER_GROWTH_FACTOR                      2  // how Buffer grows when needed
+#define BUFFER_READ_MIN_ROOM                   4096  // grow if less room than this for read()
+#define BUFFER_READ_CHUNK            (64UL * 1024UL)  // how much to grow for read()
+#define BUFFER_COPY_CHUNK          (1024UL * 1024UL)  // max bytes per sendfile() / splice()
 
-static void buffer_adjust(Buffer* b, uint32_t cap);
-static void buffer_append_ptr_len(Buffer* b, const char* ptr, uint32_t len);
+// All two-digit numbers, for formatting integers two digits at a time.
+static const char digit_pairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static void buffer_adjust(Buffer* b, SliceLen cap);
+static void buffer_append_ptr_len(Buffer* b, const char* ptr, SliceLen len);
+static int buffer_pool_adjust(Buffer* b, SliceLen cap, char** tmp);
+static int write_all(int fd, const char* ptr, SliceLen len);
+static int copy_in_kernel(int src, int dst, int use_splice, uint64_t* copied);
+static unsigned count_digits(unsigned long long l);
 
 void buffer_build(Buffer* b) {
     memset(b, 0, sizeof(Buffer));
     b->ptr = b->buf;
     b->cap = BUFFER_DATA_SIZE;
+    b->tag = MEMORY_TAG_BUFFER;
+}
+
+void buffer_build_in_arena(Buffer* b, Arena* arena) {
+    buffer_build(b);
+    b->arena = arena;
 }
 
 void buffer_destroy(Buffer* b) {
     if (BUFFER_FLAG_CHK(b, BUFFER_FLAG_PTR_IN_HEAP)) {
+        buffer_adjust(b, 0);
         BUFFER_FLAG_CLR(b, BUFFER_FLAG_PTR_IN_HEAP);
-        MEMORY_FREE_ARRAY(b->ptr, char, b->cap);
     }
 }
 
-void buffer_ensure_total(Buffer* b, uint32_t total) {
-    uint32_t changes = 0;
-    uint32_t current = b->cap;
-    while (total > current) {
-        ++changes;
-        uint32_t next = current == 0
-                      ? BUFFER_DEFAULT_CAPACITY
-                      : current * BUFFER_GROWTH_FACTOR;
-        current = next;
-    }
-    if (changes) {
+void buffer_ensure_total(Buffer* b, SliceLen total) {
+    if (total > b->cap) {
+        // grow to a power of two, so that blocks can be recycled by BufPool;
+        // once doubling would overflow, go straight to the largest capacity
+        SliceLen current = BUFFER_DEFAULT_CAPACITY;
+        while (total > current) {
+            current = current > SLICE_LEN_MAX / BUFFER_GROWTH_FACTOR
+                    ? SLICE_LEN_MAX
+                    : current * BUFFER_GROWTH_FACTOR;
+        }
         if (BUFFER_FLAG_CHK(b, BUFFER_FLAG_PTR_IN_HEAP)) {
             buffer_adjust(b, current);
         } else {
             // Buffer is using stack-allocated buf and need more, switch to ptr
-            uint32_t old = b->cap;
+            SliceLen old = b->cap;
             b->ptr = 0;
             b->cap = 0;
             buffer_adjust(b, current);
@@ -51,12 +85,58 @@ void buffer_ensure_total(Buffer* b, uint32_t total) {
     }
 }
 
+void buffer_grow(Buffer* b, SliceLen extra) {
+    if (b->pos) {
+        // consumed space at the front may be enough
+        buffer_compact(b);
+        if (extra <= b->cap - b->len) {
+            return;
+        }
+    }
+    if (extra > SLICE_LEN_MAX - b->len) {
+        LOG_WARNING("Cannot grow buffer of %llu bytes by %llu more bytes",
+                    (unsigned long long) b->len, (unsigned long long) extra);
+        abort();
+    }
+    buffer_ensure_total(b, b->len + extra);
+}
+
+char* buffer_reserve_tail(Buffer* b, SliceLen n) {
+    buffer_ensure_extra(b, n);
+    return b->ptr + b->len;
+}
+
 Slice buffer_slice(const Buffer* b) {
-    Slice s = slice_from_memory(b->ptr, b->len);
+    Slice s = slice_from_memory(b->ptr + b->pos, b->len - b->pos);
     return s;
 }
 
+void buffer_consume(Buffer* b, SliceLen n) {
+    SliceLen left = b->len - b->pos;
+    if (n >= left) {
+        // everything consumed -- start over without moving anything
+        buffer_clear(b);
+        return;
+    }
+    b->pos += n;
+    // moving the rest costs no more than what was consumed since the last
+    // time, so total work stays linear
+    if (b->pos >= BUFFER_COMPACT_THRESHOLD && b->pos >= left - n) {
+        buffer_compact(b);
+    }
+}
+
+void buffer_compact(Buffer* b) {
+    if (!b->pos) {
+        return;
+    }
+    b->len -= b->pos;
+    memmove(b->ptr, b->ptr + b->pos, b->len);
+    b->pos = 0;
+}
+
 void buffer_pack(Buffer* b) {
+    buffer_compact(b);
     if (!BUFFER_FLAG_CHK(b, BUFFER_FLAG_PTR_IN_HEAP)) {
         // Buffer is using stack-allocated buf, don't touch
         return;
@@ -83,6 +163,14 @@ void buffer_set_to_slice(Buffer* b, Slice s, bool zero) {
     }
 }
 
+void buffer_to_lower(Buffer* b) {
+    scan_to_lower(b->ptr + b->pos, b->len - b->pos);
+}
+
+void buffer_to_upper(Buffer* b) {
+    scan_to_upper(b->ptr + b->pos, b->len - b->pos);
+}
+
 void buffer_append_byte(Buffer* b, char t) {
     buffer_ensure_extra(b, 1);
     b->ptr[b->len++] = t;
@@ -100,25 +188,52 @@ void buffer_append_slice(Buffer* b, Slice s) {
 }
 
 void buffer_append_buffer(Buffer* b, const Buffer* buf) {
-    buffer_append_ptr_len(b, buf->ptr, buf->len);
+    buffer_append_slice(b, buffer_slice(buf));
 }
 
 void buffer_format_signed(Buffer* b, long long l) {
-    char cstr[99];
-    uint32_t clen = stbsp_sprintf(cstr, "%lld", l);
-    buffer_append_ptr_len(b, cstr, clen);
+    if (l < 0) {
+        // negate as unsigned, so that LLONG_MIN works
+        char* out = buffer_reserve_tail(b, 1);
+        *out = '-';
+        buffer_commit(b, 1);
+        buffer_format_unsigned(b, 0ULL - (unsigned long long) l);
+    } else {
+        buffer_format_unsigned(b, (unsigned long long) l);
+    }
 }
 
 void buffer_format_unsigned(Buffer* b, unsigned long long l) {
-    char cstr[99];
-    uint32_t clen = stbsp_sprintf(cstr, "%llu", l);
-    buffer_append_ptr_len(b, cstr, clen);
+    unsigned len = count_digits(l);
+    char* out = buffer_reserve_tail(b, len);
+
+    // write two digits at a time, from the end
+    char* p = out + len;
+    while (l >= 100) {
+        unsigned pos = (unsigned) (l % 100) * 2;
+        l /= 100;
+        *--p = digit_pairs[pos + 1];
+        *--p = digit_pairs[pos];
+    }
+    if (l >= 10) {
+        unsigned pos = (unsigned) l * 2;
+        *--p = digit_pairs[pos + 1];
+        *--p = digit_pairs[pos];
+    } else {
+        *--p = (char) ('0' + l);
+    }
+    buffer_commit(b, len);
 }
 
 void buffer_format_double(Buffer* b, double d) {
-    char cstr[99];
-    uint32_t clen = stbsp_sprintf(cstr, "%f", d);
-    buffer_append_ptr_len(b, cstr, clen);
+    // very large values can need hundreds of digits with %f
+    buffer_format_print(b, "%f", d);
+}
+
+void buffer_format_double_shortest(Buffer* b, double d) {
+    char* out = buffer_reserve_tail(b, DTOA_MAX_LEN);
+    int len = dtoa_shortest(d, out);
+    buffer_commit(b, len);
 }
 
 static char* vprint_cb(const char* buf, void* user, int len) {
@@ -139,14 +254,138 @@ void buffer_format_print(Buffer* b, const char* fmt, ...) {
     va_end(ap);
 }
 
-static void buffer_adjust(Buffer* b, uint32_t cap) {
+int buffer_read_fd(Buffer* b, int fd) {
+    int ret = 0;
+    SliceLen min_room = BUFFER_READ_MIN_ROOM;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        off_t cur = lseek(fd, 0, SEEK_CUR);
+        if (cur >= 0 && cur < st.st_size) {
+            // make room for the rest of the file in one go, plus one byte so
+            // that the read() that hits end of file does not grow the Buffer
+            uint64_t left = (uint64_t) (st.st_size - cur) + 1;
+            if (left > SLICE_LEN_MAX - b->len) {
+                return EFBIG;
+            }
+            buffer_ensure_extra(b, left);
+            min_room = 1;
+        }
+    }
+    while (1) {
+        if (b->cap - b->len < min_room) {
+            if (b->len > SLICE_LEN_MAX - BUFFER_READ_CHUNK) {
+                ret = EFBIG;
+                break;
+            }
+            buffer_grow(b, BUFFER_READ_CHUNK);
+            min_room = BUFFER_READ_MIN_ROOM;
+        }
+        ssize_t nread = read(fd, b->ptr + b->len, b->cap - b->len);
+        if (nread < 0 && errno == EINTR) {
+            continue;
+        }
+        if (nread < 0) {
+            ret = errno;
+            break;
+        }
+        if (nread == 0) {
+            break;
+        }
+        LOG_DEBUG("READ %ld", (long) nread);
+        buffer_commit(b, nread);
+    }
+    return ret;
+}
+
+int buffer_write_fd(const Buffer* b, int fd) {
+    Slice s = buffer_slice(b);
+    return write_all(fd, s.ptr, s.len);
+}
+
+int buffer_copy_fd(int src, int dst, uint64_t* copied) {
+    uint64_t total = 0;
+    int ret = -1;
+    struct stat ss;
+    struct stat ds;
+    int src_ok = fstat(src, &ss) == 0;
+    int src_reg = src_ok && S_ISREG(ss.st_mode);
+    int src_pipe = src_ok && S_ISFIFO(ss.st_mode);
+    int dst_pipe = fstat(dst, &ds) == 0 && S_ISFIFO(ds.st_mode);
+    if (src_reg) {
+        ret = copy_in_kernel(src, dst, 0, &total);
+    } else if (src_pipe || dst_pipe) {
+        ret = copy_in_kernel(src, dst, 1, &total);
+    }
+    if (ret < 0) {
+        // the kernel could not do it -- copy through a Buffer
+        ret = 0;
+        Buffer tmp; buffer_build(&tmp);
+        while (1) {
+            char* ptr = buffer_reserve_tail(&tmp, BUFFER_READ_CHUNK);
+            ssize_t nread = read(src, ptr, BUFFER_READ_CHUNK);
+            if (nread < 0 && errno == EINTR) {
+                continue;
+            }
+            if (nread <= 0) {
+                ret = nread < 0 ? errno : 0;
+                break;
+            }
+            ret = write_all(dst, ptr, nread);
+            if (ret) {
+                break;
+            }
+            total += nread;
+        }
+        buffer_destroy(&tmp);
+    }
+    if (copied) {
+        *copied = total;
+    }
+    return ret;
+}
+
+static void buffer_adjust(Buffer* b, SliceLen cap) {
     char* tmp = 0;
-    MEMORY_ADJUST(tmp, b->ptr, b->cap, cap);
+    int mapped = BUFFER_FLAG_CHK(b, BUFFER_FLAG_PTR_IN_MMAP) != 0;
+    int wanted = !b->arena && cap >= BUFFER_MMAP_THRESHOLD;
+    unsigned flags = BUFFER_FLAG_CHK(b, BUFFER_FLAG_HUGE_PAGES) ? MEMORY_MAP_HUGE_PAGES : 0;
+    if (b->arena) {
+        tmp = (char*) arena_realloc(b->arena, b->ptr, b->cap, cap);
+    } else if (mapped && wanted) {
+        // mapping can grow / shrink without copying
+        tmp = memory_remap(b->ptr, b->cap, cap, flags, b->tag);
+    } else if (!mapped && !wanted) {
+        if (!buffer_pool_adjust(b, cap, &tmp)) {
+            MEMORY_ADJUST_TAG(tmp, b->ptr, b->cap, cap, b->tag);
+        }
+    } else {
+        // moving between heap and a mapping -- copy current data over
+        if (wanted) {
+            tmp = memory_remap(0, 0, cap, flags, b->tag);
+        } else if (cap) {
+            tmp = memory_realloc_tag(0, 0, cap, b->tag);
+        }
+        if (b->ptr) {
+            if (tmp) {
+                memcpy(tmp, b->ptr, b->len < cap ? b->len : cap);
+            }
+            if (mapped) {
+                memory_remap(b->ptr, b->cap, 0, flags, b->tag);
+            } else {
+                MEMORY_FREE_ARRAY_TAG(b->ptr, char, b->cap, b->tag);
+            }
+        }
+        if (wanted) {
+            BUFFER_FLAG_SET(b, BUFFER_FLAG_PTR_IN_MMAP);
+        } else {
+            BUFFER_FLAG_CLR(b, BUFFER_FLAG_PTR_IN_MMAP);
+        }
+    }
     b->ptr = tmp;
     b->cap = cap;
 }
 
-static void buffer_append_ptr_len(Buffer* b, const char* ptr, uint32_t len) {
+static void buffer_append_ptr_len(Buffer* b, const char* ptr, SliceLen len) {
     if (len <= 0) {
         return;
     }
@@ -154,3 +393,95 @@ static void buffer_append_ptr_len(Buffer* b, const char* ptr, uint32_t len) {
     memcpy(b->ptr + b->len, ptr, len);
     b->len += len;
 }
+
+// Try to resize Buffer heap data using blocks recycled by BufPool.
+// Return 0 if the pool could not help, so data must be resized as usual.
+static int buffer_pool_adjust(Buffer* b, SliceLen cap, char** tmp) {
+    if (b->tag != MEMORY_TAG_BUFFER) {
+        // blocks accounted under other tags are not shared
+        return 0;
+    }
+
+    if (cap == 0) {
+        // releasing data -- maybe the pool keeps the block
+        if (!bufpool_put(b->ptr, b->cap)) {
+            return 0;
+        }
+        *tmp = 0;
+        return 1;
+    }
+
+    char* blk = (char*) bufpool_get(cap);
+    if (!blk) {
+        return 0;
+    }
+    if (b->ptr) {
+        memcpy(blk, b->ptr, b->len < cap ? b->len : cap);
+        if (!bufpool_put(b->ptr, b->cap)) {
+            MEMORY_FREE_ARRAY_TAG(b->ptr, char, b->cap, b->tag);
+        }
+    }
+    *tmp = blk;
+    return 1;
+}
+
+static int write_all(int fd, const char* ptr, SliceLen len) {
+    while (len > 0) {
+        ssize_t nwritten = write(fd, ptr, len);
+        if (nwritten < 0 && errno == EINTR) {
+            continue;
+        }
+        if (nwritten <= 0) {
+            return nwritten < 0 ? errno : EIO;
+        }
+        LOG_DEBUG("WRITE %ld", (long) nwritten);
+        ptr += nwritten;
+        len -= nwritten;
+    }
+    return 0;
+}
+
+// Copy from src to dst with sendfile() or splice(), until end of file.
+// Return -1 if the kernel does not support this for these descriptors and
+// nothing was copied, so that the caller can fall back to read() / write().
+static int copy_in_kernel(int src, int dst, int use_splice, uint64_t* copied) {
+    while (1) {
+        ssize_t n = use_splice
+                  ? splice(src, 0, dst, 0, BUFFER_COPY_CHUNK, SPLICE_F_MOVE)
+                  : sendfile(dst, src, 0, BUFFER_COPY_CHUNK);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            if (*copied == 0 && (errno == EINVAL || errno == ENOSYS)) {
+                return -1;
+            }
+            return errno;
+        }
+        if (n == 0) {
+            return 0;
+        }
+        LOG_DEBUG("%s %ld", use_splice ? "SPLICE" : "SENDFILE", (long) n);
+        *copied += n;
+    }
+}
+
+static unsigned count_digits(unsigned long long l) {
+    unsigned n = 1;
+    while (1) {
+        if (l < 10) {
+            return n;
+        }
+        if (l < 100) {
+            return n + 1;
+        }
+        if (l < 1000) {
+            return n + 2;
+        }
+        if (l < 10000) {
+            return n + 3;
+        }
+        l /= 10000;
+        n += 4;
+    }
+}
@@ -0,0 +1,154 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+#include "pizza/memory.h"
+#include "pizza/bufpool.h"
+
+// Default limit for a class of 2^shift bytes.
+#define BUFPOOL_DEFAULT_LIMIT(shift) \
+    ((1UL << (shift)) >= BUFPOOL_DEFAULT_CLASS_BYTES ? 1 : (uint32_t) (BUFPOOL_DEFAULT_CLASS_BYTES >> (shift)))
+
+// A block sitting in the pool, linked into the free list for its class.
+typedef struct PoolBlock {
+    struct PoolBlock* next;
+} PoolBlock;
+
+typedef struct ThreadPool {
+    PoolBlock* free[BUFPOOL_NUM_CLASSES];
+    BufPoolStats stats;
+    int registered;
+} ThreadPool;
+
+static int class_index(size_t size);
+static int pool_usable(void);
+static void block_release(void* ptr, size_t size);
+static void pool_register(void);
+static void pool_release(void* arg);
+
+static _Atomic uint32_t limits[BUFPOOL_NUM_CLASSES] = {
+    BUFPOOL_DEFAULT_LIMIT( 6), BUFPOOL_DEFAULT_LIMIT( 7), BUFPOOL_DEFAULT_LIMIT( 8),
+    BUFPOOL_DEFAULT_LIMIT( 9), BUFPOOL_DEFAULT_LIMIT(10), BUFPOOL_DEFAULT_LIMIT(11),
+    BUFPOOL_DEFAULT_LIMIT(12), BUFPOOL_DEFAULT_LIMIT(13), BUFPOOL_DEFAULT_LIMIT(14),
+    BUFPOOL_DEFAULT_LIMIT(15), BUFPOOL_DEFAULT_LIMIT(16), BUFPOOL_DEFAULT_LIMIT(17),
+    BUFPOOL_DEFAULT_LIMIT(18), BUFPOOL_DEFAULT_LIMIT(19), BUFPOOL_DEFAULT_LIMIT(20),
+};
+
+static _Thread_local ThreadPool pool;
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t key;
+
+void bufpool_set_limit(size_t size, uint32_t limit) {
+    int idx = class_index(size);
+    if (idx < 0) {
+        return;
+    }
+    atomic_store_explicit(&limits[idx], limit, memory_order_relaxed);
+}
+
+uint32_t bufpool_get_limit(size_t size) {
+    int idx = class_index(size);
+    if (idx < 0) {
+        return 0;
+    }
+    return atomic_load_explicit(&limits[idx], memory_order_relaxed);
+}
+
+void* bufpool_get(size_t size) {
+    int idx = class_index(size);
+    if (idx < 0 || !pool_usable()) {
+        return 0;
+    }
+
+    PoolBlock* blk = pool.free[idx];
+    if (!blk) {
+        ++pool.stats.misses;
+        return 0;
+    }
+    pool.free[idx] = blk->next;
+    --pool.stats.cached[idx];
+    ++pool.stats.hits;
+    return blk;
+}
+
+int bufpool_put(void* ptr, size_t size) {
+    int idx = class_index(size);
+    if (!ptr || idx < 0 || !pool_usable()) {
+        return 0;
+    }
+
+    // a lowered limit is only enforced as new blocks come in
+    if (pool.stats.cached[idx] >= atomic_load_explicit(&limits[idx], memory_order_relaxed)) {
+        ++pool.stats.drops;
+        return 0;
+    }
+    if (!pool.registered) {
+        pool_register();
+    }
+    PoolBlock* blk = (PoolBlock*) ptr;
+    blk->next = pool.free[idx];
+    pool.free[idx] = blk;
+    ++pool.stats.cached[idx];
+    ++pool.stats.puts;
+    return 1;
+}
+
+void bufpool_flush(void) {
+    for (int idx = 0; idx < BUFPOOL_NUM_CLASSES; ++idx) {
+        size_t size = BUFPOOL_MIN_SIZE << idx;
+        PoolBlock* blk = pool.free[idx];
+        while (blk) {
+            PoolBlock* next = blk->next;
+            block_release(blk, size);
+            blk = next;
+        }
+        pool.free[idx] = 0;
+        pool.stats.cached[idx] = 0;
+    }
+}
+
+void bufpool_stats(BufPoolStats* stats) {
+    *stats = pool.stats;
+}
+
+static int class_index(size_t size) {
+    if (size < BUFPOOL_MIN_SIZE || size > BUFPOOL_MAX_SIZE) {
+        return -1;
+    }
+    if (size & (size - 1)) {
+        return -1; // not a power of two
+    }
+    return __builtin_ctzl(size) - BUFPOOL_MIN_SHIFT;
+}
+
+static int pool_usable(void) {
+    // blocks from any other allocator could outlive it while in the pool
+    return memory_get_allocator() == &memory_allocator_system;
+}
+
+static void block_release(void* ptr, size_t size) {
+    if (pool_usable()) {
+        memory_realloc_tag(ptr, size, 0, MEMORY_TAG_BUFFER);
+        return;
+    }
+
+    // pooled blocks always come from the system; this happens when a thread
+    // exits while another allocator is installed, and accounting is lost
+    memory_realloc_system(ptr, 0);
+}
+
+static void key_create(void) {
+    pthread_key_create(&key, pool_release);
+}
+
+static void pool_register(void) {
+    // make sure blocks are released when this thread exits
+    pthread_once(&key_once, key_create);
+    pthread_setspecific(key, &pool);
+    pool.registered = 1;
+}
+
+static void pool_release(void* arg) {
+    (void) arg;
+    bufpool_flush();
+    pool.registered = 0;
+}
@@ -0,0 +1,89 @@
+#include <stdatomic.h>
+#include <string.h>
+#include "pizza/memory.h"
+#include "pizza/bytes.h"
+
+struct Bytes {
+    _Atomic uint32_t refs;     // number of references
+    Buffer data;               // frozen data, never modified again
+};
+
+static Bytes* bytes_create(void);
+
+Bytes* bytes_freeze(Buffer* b) {
+    Bytes* bytes = bytes_create();
+
+    // move the Buffer over; small data lives in buf, so point at the copy
+    memcpy(&bytes->data, b, sizeof(Buffer));
+    if (b->ptr == b->buf) {
+        bytes->data.ptr = bytes->data.buf;
+    }
+
+    // Arena data is never given back: the last reference can go away in any
+    // thread, and an Arena must only be used by its owner
+    if (bytes->data.arena) {
+        bytes->data.arena = 0;
+        BUFFER_FLAG_CLR(&bytes->data, BUFFER_FLAG_PTR_IN_HEAP);
+    }
+
+    // leave b empty, as if just built
+    Arena* arena = b->arena;
+    uint8_t tag = b->tag;
+    uint8_t flg = b->flg & BUFFER_FLAG_HUGE_PAGES;
+    buffer_build(b);
+    b->arena = arena;
+    b->tag = tag;
+    b->flg = flg;
+    return bytes;
+}
+
+Bytes* bytes_from_slice(Slice s) {
+    Bytes* bytes = bytes_create();
+    buffer_build(&bytes->data);
+    buffer_append_slice(&bytes->data, s);
+    return bytes;
+}
+
+Bytes* bytes_retain(Bytes* bytes) {
+    // a new reference can only come from an existing one, no ordering needed
+    atomic_fetch_add_explicit(&bytes->refs, 1, memory_order_relaxed);
+    return bytes;
+}
+
+void bytes_release(Bytes* bytes) {
+    if (!bytes) {
+        return;
+    }
+    // make all uses of the data by this thread happen before it is released
+    if (atomic_fetch_sub_explicit(&bytes->refs, 1, memory_order_acq_rel) != 1) {
+        return;
+    }
+    buffer_destroy(&bytes->data);
+    MEMORY_FREE_ARRAY_TAG(bytes, Bytes, 1, MEMORY_TAG_BUFFER);
+}
+
+uint32_t bytes_refs(const Bytes* bytes) {
+    return atomic_load_explicit(&((Bytes*) bytes)->refs, memory_order_relaxed);
+}
+
+Slice bytes_slice(const Bytes* bytes) {
+    return buffer_slice(&bytes->data);
+}
+
+Slice bytes_view(const Bytes* bytes, SliceLen pos, SliceLen len) {
+    Slice s = buffer_slice(&bytes->data);
+    if (pos > s.len) {
+        pos = s.len;
+    }
+    if (len > s.len - pos) {
+        len = s.len - pos;
+    }
+    return slice_from_memory(s.ptr + pos, len);
+}
+
+static Bytes* bytes_create(void) {
+    Bytes* bytes = 0;
+    MEMORY_ALLOC_ARRAY_TAG(bytes, Bytes, 1, MEMORY_TAG_BUFFER);
+    atomic_init(&bytes->refs, 1);
+    return bytes;
+}
@@ -1,4 +1,5 @@
 #include <string.h>
+#include "pizza/memory.h"
 #include "pizza/blowfish.h"
 #include "pizza/md5.h"
 #include "pizza/crypto.h"
@@ -44,6 +45,11 @@ void crypto_init(Crypto* crypto, Slice passphrase, Slice iv) {
     blowfish_init(&crypto->bf, crypto->key, CRYPTO_KEY_SIZE);
 }
 
+void crypto_destroy(Crypto* crypto) {
+    blowfish_destroy(&crypto->bf);
+    memory_secure_wipe(crypto, sizeof(Crypto));
+}
+
 uint32_t crypto_decrypt_cbc(Crypto* crypto, uint8_t* ptr, uint32_t len) {
     // orig contains the block before decryption;
     // for the first iteration, it contains the IV
@@ -91,6 +97,7 @@ static uint32_t generate_key(Slice passphrase, char* key) {
         md5_update(&md5, source);
         md5_finalize(&md5);
         memcpy(key + len, md5.digest, MD5_DIGEST_LEN);
+        memory_secure_wipe(&md5, sizeof(MD5));
         len += MD5_DIGEST_LEN;
         source = slice_from_memory(key, len);
     }
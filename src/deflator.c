@@ -1,3 +1,4 @@
+#include <limits.h>
 #include <zlib.h>
 #include "pizza/memory.h"
 #include "pizza/deflator.h"
@@ -5,14 +6,15 @@
 #define ZLIB_CHUNK 16384
 #define ZLIB_LEVEL Z_BEST_SPEED
 
+static void output_reserve(z_stream* strm, Buffer* b, uint32_t chunk_size);
+
 void deflator_build(Deflator* deflator, int chunk_size) {
     memset(deflator, 0, sizeof(Deflator));
     deflator->chunk_size = chunk_size <= 0 ?  ZLIB_CHUNK : chunk_size;
-    MEMORY_ALLOC_ARRAY(deflator->chunk, unsigned char, deflator->chunk_size);
 }
 
 void deflator_destroy(Deflator* deflator) {
-    MEMORY_FREE_ARRAY(deflator->chunk, unsigned char, deflator->chunk_size);
+    memset(deflator, 0, sizeof(Deflator));
 }
 
 int deflator_uncompress(Deflator* deflator, Slice compressed, Buffer* uncompressed) {
@@ -33,10 +35,10 @@ int deflator_uncompress(Deflator* deflator, Slice compressed, Buffer* uncompress
         zinited = 1;
 
         // decompress until deflate stream ends or end of input
-        int pos = 0;
+        SliceLen pos = 0;
         do {
             int flush = 0;
-            uint32_t left = compressed.len - pos;
+            SliceLen left = compressed.len - pos;
             if (left < deflator->chunk_size) {
                 strm.avail_in = left;
                 flush = Z_FINISH;
@@ -49,8 +51,8 @@ int deflator_uncompress(Deflator* deflator, Slice compressed, Buffer* uncompress
 
             // run inflate() on input until output buffer not full
             do {
-                strm.avail_out = deflator->chunk_size;
-                strm.next_out = deflator->chunk;
+                output_reserve(&strm, uncompressed, deflator->chunk_size);
+                uInt avail = strm.avail_out;
                 ret = inflate(&strm, flush);    // no bad return value
                 assert(ret != Z_STREAM_ERROR);  // state not clobbered
                 switch (ret) {
@@ -61,8 +63,7 @@ int deflator_uncompress(Deflator* deflator, Slice compressed, Buffer* uncompress
                         break;
                 }
                 if (!bad) {
-                    unsigned have = deflator->chunk_size - strm.avail_out;
-                    buffer_append_slice(uncompressed, slice_from_memory((const char*) deflator->chunk, have));
+                    buffer_commit(uncompressed, avail - strm.avail_out);
                 }
             } while (!bad && strm.avail_out == 0);
         } while (!bad && ret != Z_STREAM_END); // done when inflate() says it's done
@@ -98,9 +99,12 @@ int deflator_compress(Deflator* deflator, Slice uncompressed, Buffer* compressed
         }
         zinited = 1;
 
-        int pos = 0;
+        // make room for all of the output in one go
+        buffer_ensure_extra(compressed, deflateBound(&strm, uncompressed.len));
+
+        SliceLen pos = 0;
         do {
-            uint32_t left = uncompressed.len - pos;
+            SliceLen left = uncompressed.len - pos;
             if (left < deflator->chunk_size) {
                 strm.avail_in = left;
                 flush = Z_FINISH;
@@ -114,12 +118,11 @@ int deflator_compress(Deflator* deflator, Slice uncompressed, Buffer* compressed
             // run deflate() on input until output buffer not full,
             // finish compression if all of uncompressed has been read in
             do {
-                strm.avail_out = deflator->chunk_size;
-                strm.next_out = deflator->chunk;
+                output_reserve(&strm, compressed, deflator->chunk_size);
+                uInt avail = strm.avail_out;
                 ret = deflate(&strm, flush);    // no bad return value
                 assert(ret != Z_STREAM_ERROR);  // state not clobbered
-                unsigned have = deflator->chunk_size - strm.avail_out;
-                buffer_append_slice(compressed, slice_from_memory((const char*) deflator->chunk, have));
+                buffer_commit(compressed, avail - strm.avail_out);
             } while (strm.avail_out == 0);
             assert(strm.avail_in == 0); // all input will be used
 
@@ -134,3 +137,11 @@ int deflator_compress(Deflator* deflator, Slice uncompressed, Buffer* compressed
     }
     return ret == Z_STREAM_END ? Z_OK : Z_DATA_ERROR;
 }
+
+// Make zlib write its output straight into the free space at the end of a
+// Buffer, ensuring there is at least chunk_size bytes of it.
+static void output_reserve(z_stream* strm, Buffer* b, uint32_t chunk_size) {
+    strm->next_out = (Bytef*) buffer_reserve_tail(b, chunk_size);
+    SliceLen room = b->cap - b->len;
+    strm->avail_out = room > UINT_MAX ? UINT_MAX : room;
+}
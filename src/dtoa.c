@@ -0,0 +1,374 @@
+#include <stdint.h>
+#include <string.h>
+#include "pizza/dtoa.h"
+
+/*
+ * Grisu2, closely following the description in Loitsch's paper and the
+ * well-known implementations derived from it.
+ */
+
+#define DP_SIGNIFICAND_SIZE 52
+#define DP_EXPONENT_BIAS    (0x3FF + DP_SIGNIFICAND_SIZE)
+#define DP_MIN_EXPONENT     (-DP_EXPONENT_BIAS)
+#define DP_EXPONENT_MASK    0x7FF0000000000000ULL
+#define DP_SIGNIFICAND_MASK 0x000FFFFFFFFFFFFFULL
+#define DP_HIDDEN_BIT       0x0010000000000000ULL
+#define DP_SIGN_MASK        0x8000000000000000ULL
+
+// A "do-it-yourself" floating point number: f * 2^e
+typedef struct DiyFp {
+    uint64_t f;
+    int e;
+} DiyFp;
+
+// Cached powers of ten: 10^k for k = -348, -340, ..., 340, normalized.
+static const DiyFp cached_powers[] = {
+    { 0xfa8fd5a0081c0288ULL, -1220 },
+    { 0xbaaee17fa23ebf76ULL, -1193 },
+    { 0x8b16fb203055ac76ULL, -1166 },
+    { 0xcf42894a5dce35eaULL, -1140 },
+    { 0x9a6bb0aa55653b2dULL, -1113 },
+    { 0xe61acf033d1a45dfULL, -1087 },
+    { 0xab70fe17c79ac6caULL, -1060 },
+    { 0xff77b1fcbebcdc4fULL, -1034 },
+    { 0xbe5691ef416bd60cULL, -1007 },
+    { 0x8dd01fad907ffc3cULL,  -980 },
+    { 0xd3515c2831559a83ULL,  -954 },
+    { 0x9d71ac8fada6c9b5ULL,  -927 },
+    { 0xea9c227723ee8bcbULL,  -901 },
+    { 0xaecc49914078536dULL,  -874 },
+    { 0x823c12795db6ce57ULL,  -847 },
+    { 0xc21094364dfb5637ULL,  -821 },
+    { 0x9096ea6f3848984fULL,  -794 },
+    { 0xd77485cb25823ac7ULL,  -768 },
+    { 0xa086cfcd97bf97f4ULL,  -741 },
+    { 0xef340a98172aace5ULL,  -715 },
+    { 0xb23867fb2a35b28eULL,  -688 },
+    { 0x84c8d4dfd2c63f3bULL,  -661 },
+    { 0xc5dd44271ad3cdbaULL,  -635 },
+    { 0x936b9fcebb25c996ULL,  -608 },
+    { 0xdbac6c247d62a584ULL,  -582 },
+    { 0xa3ab66580d5fdaf6ULL,  -555 },
+    { 0xf3e2f893dec3f126ULL,  -529 },
+    { 0xb5b5ada8aaff80b8ULL,  -502 },
+    { 0x87625f056c7c4a8bULL,  -475 },
+    { 0xc9bcff6034c13053ULL,  -449 },
+    { 0x964e858c91ba2655ULL,  -422 },
+    { 0xdff9772470297ebdULL,  -396 },
+    { 0xa6dfbd9fb8e5b88fULL,  -369 },
+    { 0xf8a95fcf88747d94ULL,  -343 },
+    { 0xb94470938fa89bcfULL,  -316 },
+    { 0x8a08f0f8bf0f156bULL,  -289 },
+    { 0xcdb02555653131b6ULL,  -263 },
+    { 0x993fe2c6d07b7facULL,  -236 },
+    { 0xe45c10c42a2b3b06ULL,  -210 },
+    { 0xaa242499697392d3ULL,  -183 },
+    { 0xfd87b5f28300ca0eULL,  -157 },
+    { 0xbce5086492111aebULL,  -130 },
+    { 0x8cbccc096f5088ccULL,  -103 },
+    { 0xd1b71758e219652cULL,   -77 },
+    { 0x9c40000000000000ULL,   -50 },
+    { 0xe8d4a51000000000ULL,   -24 },
+    { 0xad78ebc5ac620000ULL,     3 },
+    { 0x813f3978f8940984ULL,    30 },
+    { 0xc097ce7bc90715b3ULL,    56 },
+    { 0x8f7e32ce7bea5c70ULL,    83 },
+    { 0xd5d238a4abe98068ULL,   109 },
+    { 0x9f4f2726179a2245ULL,   136 },
+    { 0xed63a231d4c4fb27ULL,   162 },
+    { 0xb0de65388cc8ada8ULL,   189 },
+    { 0x83c7088e1aab65dbULL,   216 },
+    { 0xc45d1df942711d9aULL,   242 },
+    { 0x924d692ca61be758ULL,   269 },
+    { 0xda01ee641a708deaULL,   295 },
+    { 0xa26da3999aef774aULL,   322 },
+    { 0xf209787bb47d6b85ULL,   348 },
+    { 0xb454e4a179dd1877ULL,   375 },
+    { 0x865b86925b9bc5c2ULL,   402 },
+    { 0xc83553c5c8965d3dULL,   428 },
+    { 0x952ab45cfa97a0b3ULL,   455 },
+    { 0xde469fbd99a05fe3ULL,   481 },
+    { 0xa59bc234db398c25ULL,   508 },
+    { 0xf6c69a72a3989f5cULL,   534 },
+    { 0xb7dcbf5354e9beceULL,   561 },
+    { 0x88fcf317f22241e2ULL,   588 },
+    { 0xcc20ce9bd35c78a5ULL,   614 },
+    { 0x98165af37b2153dfULL,   641 },
+    { 0xe2a0b5dc971f303aULL,   667 },
+    { 0xa8d9d1535ce3b396ULL,   694 },
+    { 0xfb9b7cd9a4a7443cULL,   720 },
+    { 0xbb764c4ca7a44410ULL,   747 },
+    { 0x8bab8eefb6409c1aULL,   774 },
+    { 0xd01fef10a657842cULL,   800 },
+    { 0x9b10a4e5e9913129ULL,   827 },
+    { 0xe7109bfba19c0c9dULL,   853 },
+    { 0xac2820d9623bf429ULL,   880 },
+    { 0x80444b5e7aa7cf85ULL,   907 },
+    { 0xbf21e44003acdd2dULL,   933 },
+    { 0x8e679c2f5e44ff8fULL,   960 },
+    { 0xd433179d9c8cb841ULL,   986 },
+    { 0x9e19db92b4e31ba9ULL,  1013 },
+    { 0xeb96bf6ebadf77d9ULL,  1039 },
+    { 0xaf87023b9bf0ee6bULL,  1066 }
+};
+
+static const uint64_t pow10[] = {
+    1ULL,
+    10ULL,
+    100ULL,
+    1000ULL,
+    10000ULL,
+    100000ULL,
+    1000000ULL,
+    10000000ULL,
+    100000000ULL,
+    1000000000ULL,
+    10000000000ULL,
+    100000000000ULL,
+    1000000000000ULL,
+    10000000000000ULL,
+    100000000000000ULL,
+    1000000000000000ULL,
+    10000000000000000ULL,
+    100000000000000000ULL,
+    1000000000000000000ULL,
+    10000000000000000000ULL,
+};
+
+static DiyFp diyfp_from_double(uint64_t bits) {
+    int biased = (int) ((bits & DP_EXPONENT_MASK) >> DP_SIGNIFICAND_SIZE);
+    uint64_t significand = bits & DP_SIGNIFICAND_MASK;
+    DiyFp v;
+    if (biased) {
+        v.f = significand + DP_HIDDEN_BIT;
+        v.e = biased - DP_EXPONENT_BIAS;
+    } else {
+        // denormal
+        v.f = significand;
+        v.e = DP_MIN_EXPONENT + 1;
+    }
+    return v;
+}
+
+static DiyFp diyfp_normalize(DiyFp v) {
+    int s = __builtin_clzll(v.f);
+    v.f <<= s;
+    v.e -= s;
+    return v;
+}
+
+// Multiply two DiyFps, keeping the (rounded) upper 64 bits of the product.
+static DiyFp diyfp_multiply(DiyFp x, DiyFp y) {
+    const uint64_t M32 = 0xFFFFFFFFULL;
+    uint64_t a = x.f >> 32;
+    uint64_t b = x.f & M32;
+    uint64_t c = y.f >> 32;
+    uint64_t d = y.f & M32;
+    uint64_t ac = a * c;
+    uint64_t bc = b * c;
+    uint64_t ad = a * d;
+    uint64_t bd = b * d;
+    uint64_t tmp = (bd >> 32) + (ad & M32) + (bc & M32);
+    tmp += 1ULL << 31; // round
+    DiyFp r = { ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), x.e + y.e + 64 };
+    return r;
+}
+
+// Compute the boundaries m- and m+ of v, with the same exponent.
+static void normalized_boundaries(DiyFp v, DiyFp* minus, DiyFp* plus) {
+    DiyFp pl = { (v.f << 1) + 1, v.e - 1 };
+    pl = diyfp_normalize(pl);
+    DiyFp mi;
+    if (v.f == DP_HIDDEN_BIT) {
+        // lower boundary is closer when significand is a power of two
+        mi.f = (v.f << 2) - 1;
+        mi.e = v.e - 2;
+    } else {
+        mi.f = (v.f << 1) - 1;
+        mi.e = v.e - 1;
+    }
+    mi.f <<= mi.e - pl.e;
+    mi.e = pl.e;
+    *minus = mi;
+    *plus = pl;
+}
+
+// Get a cached power of ten c such that the exponent of c * 2^e lands in the
+// range required by digit generation; return its decimal exponent in k.
+static DiyFp cached_power(int e, int* k) {
+    double dk = (-61 - e) * 0.30102999566398114 + 347; // 1 / log2(10)
+    int ik = (int) dk;
+    if (dk - ik > 0.0) {
+        ++ik;
+    }
+    unsigned index = (unsigned) ((ik >> 3) + 1);
+    *k = -(-348 + (int) (index << 3));
+    return cached_powers[index];
+}
+
+static int count_digits(uint32_t n) {
+    int d = 1;
+    while (n >= 10) {
+        n /= 10;
+        ++d;
+    }
+    return d;
+}
+
+// Move the last digit down while that brings the result closer to w.
+static void grisu_round(char* buf, int len, uint64_t delta, uint64_t rest, uint64_t ten_kappa, uint64_t wp_w) {
+    while (rest < wp_w && delta - rest >= ten_kappa &&
+           (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w)) {
+        buf[len - 1]--;
+        rest += ten_kappa;
+    }
+}
+
+// Generate the shortest digits for a number in the range (mp - delta, mp].
+static int digit_gen(DiyFp w, DiyFp mp, uint64_t delta, char* buf, int* k) {
+    DiyFp one = { 1ULL << -mp.e, mp.e };
+    uint64_t wp_w = mp.f - w.f;
+    uint32_t p1 = (uint32_t) (mp.f >> -one.e);
+    uint64_t p2 = mp.f & (one.f - 1);
+    int kappa = count_digits(p1);
+    int len = 0;
+
+    // integral part
+    while (kappa > 0) {
+        uint32_t div = (uint32_t) pow10[kappa - 1];
+        uint32_t d = p1 / div;
+        p1 %= div;
+        if (d || len) {
+            buf[len++] = (char) ('0' + d);
+        }
+        --kappa;
+        uint64_t tmp = ((uint64_t) p1 << -one.e) + p2;
+        if (tmp <= delta) {
+            *k += kappa;
+            grisu_round(buf, len, delta, tmp, pow10[kappa] << -one.e, wp_w);
+            return len;
+        }
+    }
+
+    // fractional part
+    while (1) {
+        p2 *= 10;
+        delta *= 10;
+        char d = (char) (p2 >> -one.e);
+        if (d || len) {
+            buf[len++] = (char) ('0' + d);
+        }
+        p2 &= one.f - 1;
+        --kappa;
+        if (p2 < delta) {
+            *k += kappa;
+            int index = -kappa;
+            grisu_round(buf, len, delta, p2, one.f, wp_w * (index < 20 ? pow10[index] : 0));
+            return len;
+        }
+    }
+}
+
+// Generate the digits for a positive, finite, non-zero double.
+// Value is digits * 10^k; return number of digits.
+static int grisu2(uint64_t bits, char* buf, int* k) {
+    DiyFp v = diyfp_from_double(bits);
+    DiyFp w_m, w_p;
+    normalized_boundaries(v, &w_m, &w_p);
+
+    DiyFp c_mk = cached_power(w_p.e, k);
+    DiyFp w  = diyfp_multiply(diyfp_normalize(v), c_mk);
+    DiyFp wp = diyfp_multiply(w_p, c_mk);
+    DiyFp wm = diyfp_multiply(w_m, c_mk);
+    ++wm.f;
+    --wp.f;
+    return digit_gen(w, wp, wp.f - wm.f, buf, k);
+}
+
+static int write_exponent(int e, char* out) {
+    int len = 0;
+    out[len++] = 'e';
+    if (e < 0) {
+        out[len++] = '-';
+        e = -e;
+    } else {
+        out[len++] = '+';
+    }
+    if (e >= 100) {
+        out[len++] = (char) ('0' + e / 100);
+        e %= 100;
+        out[len++] = (char) ('0' + e / 10);
+    } else if (e >= 10) {
+        out[len++] = (char) ('0' + e / 10);
+    }
+    out[len++] = (char) ('0' + e % 10);
+    return len;
+}
+
+// Lay out len digits with decimal exponent k, in fixed or scientific notation.
+static int prettify(char* buf, int len, int k) {
+    int kk = len + k; // 10^(kk-1) <= v < 10^kk
+
+    if (k >= 0 && kk <= 21) {
+        // 1234e7 -> 12340000000
+        memset(buf + len, '0', k);
+        return kk;
+    }
+
+    if (kk > 0 && kk <= 21) {
+        // 1234e-2 -> 12.34
+        memmove(buf + kk + 1, buf + kk, len - kk);
+        buf[kk] = '.';
+        return len + 1;
+    }
+
+    if (kk > -6 && kk <= 0) {
+        // 1234e-6 -> 0.001234
+        int offset = 2 - kk;
+        memmove(buf + offset, buf, len);
+        buf[0] = '0';
+        buf[1] = '.';
+        memset(buf + 2, '0', offset - 2);
+        return len + offset;
+    }
+
+    if (len == 1) {
+        // 1e30
+        return 1 + write_exponent(kk - 1, buf + 1);
+    }
+
+    // 1234e30 -> 1.234e+33
+    memmove(buf + 2, buf + 1, len - 1);
+    buf[1] = '.';
+    return len + 1 + write_exponent(kk - 1, buf + len + 1);
+}
+
+int dtoa_shortest(double d, char* out) {
+    uint64_t bits = 0;
+    memcpy(&bits, &d, sizeof(bits));
+
+    int len = 0;
+    if (bits & DP_SIGN_MASK) {
+        out[len++] = '-';
+        bits &= ~DP_SIGN_MASK;
+    }
+
+    if ((bits & DP_EXPONENT_MASK) == DP_EXPONENT_MASK) {
+        if (bits & DP_SIGNIFICAND_MASK) {
+            // don't care about sign of nan
+            memcpy(out, "nan", 3);
+            return 3;
+        }
+        memcpy(out + len, "inf", 3);
+        return len + 3;
+    }
+
+    if (bits == 0) {
+        out[len++] = '0';
+        return len;
+    }
+
+    int k = 0;
+    int digits = grisu2(bits, out + len, &k);
+    return len + prettify(out + len, digits, k);
+}
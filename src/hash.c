@@ -1,6 +1,59 @@
 #include <string.h>
+#include "pizza/scan.h"
 #include "pizza/hash.h"
 
+#if SCAN_SIMD && defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define HASH_X86 1
+#include <immintrin.h>
+#else
+#define HASH_X86 0
+#endif
+
+#define XXH_PRIME32_1 0x9E3779B1U
+#define XXH_PRIME32_2 0x85EBCA77U
+#define XXH_PRIME32_3 0xC2B2AE3DU
+#define XXH_PRIME64_1 0x9E3779B185EBCA87ULL
+#define XXH_PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define XXH_PRIME64_3 0x165667B19E3779F9ULL
+#define XXH_PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define XXH_PRIME64_5 0x27D4EB2F165667C5ULL
+#define XXH_PRIME_MX1 0x165667919E3779F9ULL
+#define XXH_PRIME_MX2 0x9FB21C651E98DF25ULL
+
+#define XXH_STRIPE_LEN       64     // bytes consumed by each accumulation
+#define XXH_SECRET_STEP       8     // secret advance for each stripe
+#define XXH_BLOCK_STRIPES    16     // stripes in a block, between scrambles
+#define XXH_MIDSIZE_MAX     240     // longest input not using accumulators
+#define XXH_MIDSIZE_START     3     // secret offsets used by 129-240 bytes
+#define XXH_MIDSIZE_LAST    119
+#define XXH_LAST_STRIPE     121     // secret offset for the last stripe
+#define XXH_MERGE_START      11     // secret offset for merging accumulators
+#define XXH_SCRAMBLE_START  128     // secret offset for scrambling
+
+static const uint8_t xxh3_secret[HASH_XXH3_SECRET_LEN] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+    0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+    0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+    0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+    0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+    0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+    0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+    0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+    0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+static void xxh3_accumulate_scalar(uint64_t* acc, const uint8_t* in, const uint8_t* secret, size_t stripes);
+static void xxh3_scramble_scalar(uint64_t* acc, const uint8_t* secret);
+#if HASH_X86
+static void xxh3_accumulate_sse2(uint64_t* acc, const uint8_t* in, const uint8_t* secret, size_t stripes);
+static void xxh3_scramble_sse2(uint64_t* acc, const uint8_t* secret);
+static void xxh3_accumulate_avx2(uint64_t* acc, const uint8_t* in, const uint8_t* secret, size_t stripes);
+static void xxh3_scramble_avx2(uint64_t* acc, const uint8_t* secret);
+#endif
+
 uint32_t hash_djb2(const char* str, uint32_t len) {
     uint32_t h = 5381;
     for (uint32_t j = 0; j < len; ++j) {
@@ -86,3 +139,542 @@ uint32_t hash_pcg(uint32_t input)
     uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
     return (word >> 22u) ^ word;
 }
+
+// Reading integers, always little-endian.
+
+static inline uint32_t read32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap32(v);
+#endif
+    return v;
+}
+
+static inline uint64_t read64(const uint8_t* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+static inline void write64(uint8_t* p, uint64_t v) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    memcpy(p, &v, sizeof(v));
+}
+
+static inline uint32_t swap32(uint32_t v) {
+    return ((v << 24) & 0xff000000U) | ((v << 8) & 0x00ff0000U) |
+           ((v >> 8) & 0x0000ff00U) | ((v >> 24) & 0x000000ffU);
+}
+
+static inline uint64_t swap64(uint64_t v) {
+    return ((uint64_t) swap32((uint32_t) v) << 32) | swap32((uint32_t) (v >> 32));
+}
+
+static inline uint32_t rotl32(uint32_t v, int r) {
+    return (v << r) | (v >> (32 - r));
+}
+
+static inline uint64_t rotl64(uint64_t v, int r) {
+    return (v << r) | (v >> (64 - r));
+}
+
+static inline Hash128 mul128(uint64_t a, uint64_t b) {
+    Hash128 r;
+#if defined(__SIZEOF_INT128__)
+    __extension__ unsigned __int128 p = (unsigned __int128) a * b;
+    r.lo = (uint64_t) p;
+    r.hi = (uint64_t) (p >> 64);
+#else
+    uint64_t lo_lo = (a & 0xffffffffULL) * (b & 0xffffffffULL);
+    uint64_t hi_lo = (a >> 32) * (b & 0xffffffffULL);
+    uint64_t lo_hi = (a & 0xffffffffULL) * (b >> 32);
+    uint64_t hi_hi = (a >> 32) * (b >> 32);
+    uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xffffffffULL) + lo_hi;
+    r.lo = (cross << 32) | (lo_lo & 0xffffffffULL);
+    r.hi = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+#endif
+    return r;
+}
+
+static inline uint64_t mul_fold(uint64_t a, uint64_t b) {
+    Hash128 p = mul128(a, b);
+    return p.lo ^ p.hi;
+}
+
+static inline uint64_t xxh64_avalanche(uint64_t h) {
+    h ^= h >> 33;
+    h *= XXH_PRIME64_2;
+    h ^= h >> 29;
+    h *= XXH_PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+static inline uint64_t xxh3_avalanche(uint64_t h) {
+    h ^= h >> 37;
+    h *= XXH_PRIME_MX1;
+    h ^= h >> 32;
+    return h;
+}
+
+static inline uint64_t xxh3_rrmxmx(uint64_t h, uint64_t len) {
+    h ^= rotl64(h, 49) ^ rotl64(h, 24);
+    h *= XXH_PRIME_MX2;
+    h ^= (h >> 35) + len;
+    h *= XXH_PRIME_MX2;
+    h ^= h >> 28;
+    return h;
+}
+
+static inline uint64_t xxh3_mix16(const uint8_t* in, const uint8_t* secret, uint64_t seed) {
+    return mul_fold(read64(in) ^ (read64(secret) + seed),
+                    read64(in + 8) ^ (read64(secret + 8) - seed));
+}
+
+static inline void xxh3_mix32(Hash128* acc, const uint8_t* in1, const uint8_t* in2, const uint8_t* secret, uint64_t seed) {
+    acc->lo += xxh3_mix16(in1, secret, seed);
+    acc->lo ^= read64(in2) + read64(in2 + 8);
+    acc->hi += xxh3_mix16(in2, secret + 16, seed);
+    acc->hi ^= read64(in1) + read64(in1 + 8);
+}
+
+static void xxh3_init_acc(uint64_t* acc) {
+    acc[0] = XXH_PRIME32_3;
+    acc[1] = XXH_PRIME64_1;
+    acc[2] = XXH_PRIME64_2;
+    acc[3] = XXH_PRIME64_3;
+    acc[4] = XXH_PRIME64_4;
+    acc[5] = XXH_PRIME32_2;
+    acc[6] = XXH_PRIME64_5;
+    acc[7] = XXH_PRIME32_1;
+}
+
+static void xxh3_init_secret(uint8_t* secret, uint64_t seed) {
+    for (int j = 0; j < HASH_XXH3_SECRET_LEN; j += 16) {
+        write64(secret + j, read64(xxh3_secret + j) + seed);
+        write64(secret + j + 8, read64(xxh3_secret + j + 8) - seed);
+    }
+}
+
+static inline void xxh3_accumulate(int level, uint64_t* acc, const uint8_t* in, const uint8_t* secret, size_t stripes) {
+    switch (level) {
+#if HASH_X86
+        case SCAN_LEVEL_AVX2:
+            xxh3_accumulate_avx2(acc, in, secret, stripes);
+            break;
+        case SCAN_LEVEL_SSE2:
+            xxh3_accumulate_sse2(acc, in, secret, stripes);
+            break;
+#endif
+        default:
+            xxh3_accumulate_scalar(acc, in, secret, stripes);
+            break;
+    }
+}
+
+static inline void xxh3_scramble(int level, uint64_t* acc, const uint8_t* secret) {
+    switch (level) {
+#if HASH_X86
+        case SCAN_LEVEL_AVX2:
+            xxh3_scramble_avx2(acc, secret);
+            break;
+        case SCAN_LEVEL_SSE2:
+            xxh3_scramble_sse2(acc, secret);
+            break;
+#endif
+        default:
+            xxh3_scramble_scalar(acc, secret);
+            break;
+    }
+}
+
+// Accumulate a number of stripes, scrambling at the end of each block.
+// Callers only pass stripes that are followed by more data: the last stripe
+// of the input is always accumulated separately.
+static void xxh3_stripes(uint64_t* acc, uint32_t* done, const uint8_t* in, size_t count, const uint8_t* secret) {
+    int level = scan_get_level();
+    while (count > 0) {
+        size_t n = XXH_BLOCK_STRIPES - *done;
+        if (n > count) {
+            n = count;
+        }
+        xxh3_accumulate(level, acc, in, secret + *done * XXH_SECRET_STEP, n);
+        in += n * XXH_STRIPE_LEN;
+        count -= n;
+        *done += n;
+        if (*done == XXH_BLOCK_STRIPES) {
+            xxh3_scramble(level, acc, secret + XXH_SCRAMBLE_START);
+            *done = 0;
+        }
+    }
+}
+
+static void xxh3_last_stripe(uint64_t* acc, const uint8_t* in, const uint8_t* secret) {
+    xxh3_accumulate(scan_get_level(), acc, in, secret + XXH_LAST_STRIPE, 1);
+}
+
+static uint64_t xxh3_merge(const uint64_t* acc, const uint8_t* secret, uint64_t start) {
+    uint64_t h = start;
+    for (int j = 0; j < 4; ++j) {
+        h += mul_fold(acc[2 * j] ^ read64(secret + 16 * j), acc[2 * j + 1] ^ read64(secret + 16 * j + 8));
+    }
+    return xxh3_avalanche(h);
+}
+
+static void xxh3_long(uint64_t* acc, const uint8_t* in, size_t len, const uint8_t* secret) {
+    uint32_t done = 0;
+    xxh3_init_acc(acc);
+    xxh3_stripes(acc, &done, in, (len - 1) / XXH_STRIPE_LEN, secret);
+    xxh3_last_stripe(acc, in + len - XXH_STRIPE_LEN, secret);
+}
+
+static uint64_t xxh3_64_short(const uint8_t* in, size_t len, uint64_t seed) {
+    const uint8_t* secret = xxh3_secret;
+    if (len > 128) {
+        uint64_t acc = len * XXH_PRIME64_1;
+        for (int j = 0; j < 8; ++j) {
+            acc += xxh3_mix16(in + 16 * j, secret + 16 * j, seed);
+        }
+        uint64_t end = xxh3_mix16(in + len - 16, secret + XXH_MIDSIZE_LAST, seed);
+        acc = xxh3_avalanche(acc);
+        for (size_t j = 8; j < len / 16; ++j) {
+            end += xxh3_mix16(in + 16 * j, secret + 16 * (j - 8) + XXH_MIDSIZE_START, seed);
+        }
+        return xxh3_avalanche(acc + end);
+    }
+    if (len > 16) {
+        uint64_t acc = len * XXH_PRIME64_1;
+        if (len > 32) {
+            if (len > 64) {
+                if (len > 96) {
+                    acc += xxh3_mix16(in + 48, secret + 96, seed);
+                    acc += xxh3_mix16(in + len - 64, secret + 112, seed);
+                }
+                acc += xxh3_mix16(in + 32, secret + 64, seed);
+                acc += xxh3_mix16(in + len - 48, secret + 80, seed);
+            }
+            acc += xxh3_mix16(in + 16, secret + 32, seed);
+            acc += xxh3_mix16(in + len - 32, secret + 48, seed);
+        }
+        acc += xxh3_mix16(in, secret, seed);
+        acc += xxh3_mix16(in + len - 16, secret + 16, seed);
+        return xxh3_avalanche(acc);
+    }
+    if (len > 8) {
+        uint64_t lo = read64(in) ^ ((read64(secret + 24) ^ read64(secret + 32)) + seed);
+        uint64_t hi = read64(in + len - 8) ^ ((read64(secret + 40) ^ read64(secret + 48)) - seed);
+        return xxh3_avalanche(len + swap64(lo) + hi + mul_fold(lo, hi));
+    }
+    if (len >= 4) {
+        seed ^= (uint64_t) swap32((uint32_t) seed) << 32;
+        uint64_t bitflip = (read64(secret + 8) ^ read64(secret + 16)) - seed;
+        uint64_t input = read32(in + len - 4) + ((uint64_t) read32(in) << 32);
+        return xxh3_rrmxmx(input ^ bitflip, len);
+    }
+    if (len > 0) {
+        uint32_t combined = ((uint32_t) in[0] << 16) | ((uint32_t) in[len >> 1] << 24) |
+                            ((uint32_t) in[len - 1]) | ((uint32_t) len << 8);
+        uint64_t bitflip = (read32(secret) ^ read32(secret + 4)) + seed;
+        return xxh64_avalanche(combined ^ bitflip);
+    }
+    return xxh64_avalanche(seed ^ read64(secret + 56) ^ read64(secret + 64));
+}
+
+static Hash128 xxh3_128_short(const uint8_t* in, size_t len, uint64_t seed) {
+    const uint8_t* secret = xxh3_secret;
+    Hash128 h;
+    if (len > 16) {
+        Hash128 acc = { .lo = len * XXH_PRIME64_1, .hi = 0 };
+        if (len > 128) {
+            for (int j = 0; j < 4; ++j) {
+                xxh3_mix32(&acc, in + 32 * j, in + 32 * j + 16, secret + 32 * j, seed);
+            }
+            acc.lo = xxh3_avalanche(acc.lo);
+            acc.hi = xxh3_avalanche(acc.hi);
+            for (size_t j = 4; j < len / 32; ++j) {
+                xxh3_mix32(&acc, in + 32 * j, in + 32 * j + 16, secret + XXH_MIDSIZE_START + 32 * (j - 4), seed);
+            }
+            xxh3_mix32(&acc, in + len - 16, in + len - 32, secret + XXH_MIDSIZE_LAST - 16, 0 - seed);
+        } else {
+            if (len > 32) {
+                if (len > 64) {
+                    if (len > 96) {
+                        xxh3_mix32(&acc, in + 48, in + len - 64, secret + 96, seed);
+                    }
+                    xxh3_mix32(&acc, in + 32, in + len - 48, secret + 64, seed);
+                }
+                xxh3_mix32(&acc, in + 16, in + len - 32, secret + 32, seed);
+            }
+            xxh3_mix32(&acc, in, in + len - 16, secret, seed);
+        }
+        h.lo = xxh3_avalanche(acc.lo + acc.hi);
+        h.hi = 0 - xxh3_avalanche(acc.lo * XXH_PRIME64_1 + acc.hi * XXH_PRIME64_4 + (len - seed) * XXH_PRIME64_2);
+        return h;
+    }
+    if (len > 8) {
+        uint64_t bitflip_lo = (read64(secret + 32) ^ read64(secret + 40)) - seed;
+        uint64_t bitflip_hi = (read64(secret + 48) ^ read64(secret + 56)) + seed;
+        uint64_t lo = read64(in);
+        uint64_t hi = read64(in + len - 8);
+        Hash128 m = mul128(lo ^ hi ^ bitflip_lo, XXH_PRIME64_1);
+        m.lo += (uint64_t) (len - 1) << 54;
+        hi ^= bitflip_hi;
+        m.hi += hi + (uint64_t) (uint32_t) hi * (XXH_PRIME32_2 - 1);
+        m.lo ^= swap64(m.hi);
+        h = mul128(m.lo, XXH_PRIME64_2);
+        h.hi += m.hi * XXH_PRIME64_2;
+        h.lo = xxh3_avalanche(h.lo);
+        h.hi = xxh3_avalanche(h.hi);
+        return h;
+    }
+    if (len >= 4) {
+        seed ^= (uint64_t) swap32((uint32_t) seed) << 32;
+        uint64_t input = read32(in) + ((uint64_t) read32(in + len - 4) << 32);
+        uint64_t bitflip = (read64(secret + 16) ^ read64(secret + 24)) + seed;
+        h = mul128(input ^ bitflip, XXH_PRIME64_1 + (len << 2));
+        h.hi += h.lo << 1;
+        h.lo ^= h.hi >> 3;
+        h.lo ^= h.lo >> 35;
+        h.lo *= XXH_PRIME_MX2;
+        h.lo ^= h.lo >> 28;
+        h.hi = xxh3_avalanche(h.hi);
+        return h;
+    }
+    if (len > 0) {
+        uint32_t combined_lo = ((uint32_t) in[0] << 16) | ((uint32_t) in[len >> 1] << 24) |
+                               ((uint32_t) in[len - 1]) | ((uint32_t) len << 8);
+        uint32_t combined_hi = rotl32(swap32(combined_lo), 13);
+        uint64_t bitflip_lo = (read32(secret) ^ read32(secret + 4)) + seed;
+        uint64_t bitflip_hi = (read32(secret + 8) ^ read32(secret + 12)) - seed;
+        h.lo = xxh64_avalanche(combined_lo ^ bitflip_lo);
+        h.hi = xxh64_avalanche(combined_hi ^ bitflip_hi);
+        return h;
+    }
+    h.lo = xxh64_avalanche(seed ^ read64(secret + 64) ^ read64(secret + 72));
+    h.hi = xxh64_avalanche(seed ^ read64(secret + 80) ^ read64(secret + 88));
+    return h;
+}
+
+static Hash128 xxh3_128_merge(const uint64_t* acc, const uint8_t* secret, size_t len) {
+    Hash128 h;
+    h.lo = xxh3_merge(acc, secret + XXH_MERGE_START, len * XXH_PRIME64_1);
+    h.hi = xxh3_merge(acc, secret + HASH_XXH3_SECRET_LEN - XXH_STRIPE_LEN - XXH_MERGE_START, ~(len * XXH_PRIME64_2));
+    return h;
+}
+
+// Kept apart from the short inputs, so that those do not pay for the
+// custom secret on the stack.
+static uint64_t xxh3_64_long(const uint8_t* in, size_t len, uint64_t seed) {
+    uint8_t custom[HASH_XXH3_SECRET_LEN];
+    const uint8_t* secret = xxh3_secret;
+    if (seed) {
+        xxh3_init_secret(custom, seed);
+        secret = custom;
+    }
+    uint64_t acc[8];
+    xxh3_long(acc, in, len, secret);
+    return xxh3_merge(acc, secret + XXH_MERGE_START, len * XXH_PRIME64_1);
+}
+
+static Hash128 xxh3_128_long(const uint8_t* in, size_t len, uint64_t seed) {
+    uint8_t custom[HASH_XXH3_SECRET_LEN];
+    const uint8_t* secret = xxh3_secret;
+    if (seed) {
+        xxh3_init_secret(custom, seed);
+        secret = custom;
+    }
+    uint64_t acc[8];
+    xxh3_long(acc, in, len, secret);
+    return xxh3_128_merge(acc, secret, len);
+}
+
+uint64_t hash_xxh3_64(const char* str, size_t len, uint64_t seed) {
+    const uint8_t* in = (const uint8_t*) str;
+    if (len <= XXH_MIDSIZE_MAX) {
+        return xxh3_64_short(in, len, seed);
+    }
+    return xxh3_64_long(in, len, seed);
+}
+
+Hash128 hash_xxh3_128(const char* str, size_t len, uint64_t seed) {
+    const uint8_t* in = (const uint8_t*) str;
+    if (len <= XXH_MIDSIZE_MAX) {
+        return xxh3_128_short(in, len, seed);
+    }
+    return xxh3_128_long(in, len, seed);
+}
+
+void hash_xxh3_reset(HashXXH3* h, uint64_t seed) {
+    xxh3_init_acc(h->acc);
+    xxh3_init_secret(h->secret, seed);
+    h->seed = seed;
+    h->total = 0;
+    h->buffered = 0;
+    h->stripes = 0;
+}
+
+void hash_xxh3_update(HashXXH3* h, const char* str, size_t len) {
+    const uint8_t* in = (const uint8_t*) str;
+    const uint8_t* end = in + len;
+    h->total += len;
+    if (len <= HASH_XXH3_BUFFER_LEN - h->buffered) {
+        if (len) {
+            memcpy(h->buffer + h->buffered, in, len);
+        }
+        h->buffered += len;
+        return;
+    }
+
+    // there is more data than fits in the buffer, so everything in the buffer
+    // is followed by more data and can be consumed
+    if (h->buffered) {
+        size_t fill = HASH_XXH3_BUFFER_LEN - h->buffered;
+        memcpy(h->buffer + h->buffered, in, fill);
+        in += fill;
+        xxh3_stripes(h->acc, &h->stripes, h->buffer, HASH_XXH3_BUFFER_LEN / XXH_STRIPE_LEN, h->secret);
+        h->buffered = 0;
+    }
+
+    // consume straight from the input, always leaving some bytes behind
+    if ((size_t) (end - in) > HASH_XXH3_BUFFER_LEN) {
+        size_t stripes = (size_t) (end - in - 1) / XXH_STRIPE_LEN;
+        xxh3_stripes(h->acc, &h->stripes, in, stripes, h->secret);
+        in += stripes * XXH_STRIPE_LEN;
+        // keep the last stripe consumed, in case the final stripe needs it
+        memcpy(h->buffer + HASH_XXH3_BUFFER_LEN - XXH_STRIPE_LEN, in - XXH_STRIPE_LEN, XXH_STRIPE_LEN);
+    }
+
+    h->buffered = (uint32_t) (end - in);
+    memcpy(h->buffer, in, h->buffered);
+}
+
+// Finish the accumulators for a long input, leaving the state untouched.
+static void xxh3_stream_acc(const HashXXH3* h, uint64_t* acc) {
+    memcpy(acc, h->acc, sizeof(h->acc));
+    if (h->buffered >= XXH_STRIPE_LEN) {
+        uint32_t done = h->stripes;
+        xxh3_stripes(acc, &done, h->buffer, (h->buffered - 1) / XXH_STRIPE_LEN, h->secret);
+        xxh3_last_stripe(acc, h->buffer + h->buffered - XXH_STRIPE_LEN, h->secret);
+    } else {
+        // the last stripe starts with bytes from before the buffered ones
+        uint8_t last[XXH_STRIPE_LEN];
+        size_t before = XXH_STRIPE_LEN - h->buffered;
+        memcpy(last, h->buffer + HASH_XXH3_BUFFER_LEN - before, before);
+        memcpy(last + before, h->buffer, h->buffered);
+        xxh3_last_stripe(acc, last, h->secret);
+    }
+}
+
+uint64_t hash_xxh3_final64(const HashXXH3* h) {
+    if (h->total <= XXH_MIDSIZE_MAX) {
+        return xxh3_64_short(h->buffer, h->total, h->seed);
+    }
+    uint64_t acc[8];
+    xxh3_stream_acc(h, acc);
+    return xxh3_merge(acc, h->secret + XXH_MERGE_START, h->total * XXH_PRIME64_1);
+}
+
+Hash128 hash_xxh3_final128(const HashXXH3* h) {
+    if (h->total <= XXH_MIDSIZE_MAX) {
+        return xxh3_128_short(h->buffer, h->total, h->seed);
+    }
+    uint64_t acc[8];
+    xxh3_stream_acc(h, acc);
+    return xxh3_128_merge(acc, h->secret, h->total);
+}
+
+static void xxh3_accumulate_scalar(uint64_t* acc, const uint8_t* in, const uint8_t* secret, size_t stripes) {
+    for (size_t s = 0; s < stripes; ++s, in += XXH_STRIPE_LEN, secret += XXH_SECRET_STEP) {
+        for (int j = 0; j < 8; ++j) {
+            uint64_t data = read64(in + 8 * j);
+            uint64_t key = data ^ read64(secret + 8 * j);
+            acc[j ^ 1] += data;
+            acc[j] += (key & 0xffffffffULL) * (key >> 32);
+        }
+    }
+}
+
+static void xxh3_scramble_scalar(uint64_t* acc, const uint8_t* secret) {
+    for (int j = 0; j < 8; ++j) {
+        uint64_t a = acc[j];
+        a ^= a >> 47;
+        a ^= read64(secret + 8 * j);
+        a *= XXH_PRIME32_1;
+        acc[j] = a;
+    }
+}
+
+#if HASH_X86
+
+// Each 64-bit lane gets (lo32 * hi32) of data ^ key, plus the data from the
+// neighbouring lane -- the same as the scalar code, for 2 or 4 lanes at once.
+
+static void xxh3_accumulate_sse2(uint64_t* acc, const uint8_t* in, const uint8_t* secret, size_t stripes) {
+    __m128i a[4];
+    for (int j = 0; j < 4; ++j) {
+        a[j] = _mm_loadu_si128((const __m128i*) (acc + 2 * j));
+    }
+    for (size_t s = 0; s < stripes; ++s, in += XXH_STRIPE_LEN, secret += XXH_SECRET_STEP) {
+        for (int j = 0; j < 4; ++j) {
+            __m128i data = _mm_loadu_si128((const __m128i*) (in + 16 * j));
+            __m128i key = _mm_xor_si128(data, _mm_loadu_si128((const __m128i*) (secret + 16 * j)));
+            __m128i prod = _mm_mul_epu32(key, _mm_shuffle_epi32(key, _MM_SHUFFLE(0, 3, 0, 1)));
+            __m128i swap = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+            a[j] = _mm_add_epi64(a[j], _mm_add_epi64(prod, swap));
+        }
+    }
+    for (int j = 0; j < 4; ++j) {
+        _mm_storeu_si128((__m128i*) (acc + 2 * j), a[j]);
+    }
+}
+
+static void xxh3_scramble_sse2(uint64_t* acc, const uint8_t* secret) {
+    const __m128i prime = _mm_set1_epi32((int) XXH_PRIME32_1);
+    for (int j = 0; j < 4; ++j) {
+        __m128i a = _mm_loadu_si128((const __m128i*) (acc + 2 * j));
+        a = _mm_xor_si128(a, _mm_srli_epi64(a, 47));
+        a = _mm_xor_si128(a, _mm_loadu_si128((const __m128i*) (secret + 16 * j)));
+        __m128i lo = _mm_mul_epu32(a, prime);
+        __m128i hi = _mm_mul_epu32(_mm_shuffle_epi32(a, _MM_SHUFFLE(0, 3, 0, 1)), prime);
+        _mm_storeu_si128((__m128i*) (acc + 2 * j), _mm_add_epi64(lo, _mm_slli_epi64(hi, 32)));
+    }
+}
+
+__attribute__((target("avx2")))
+static void xxh3_accumulate_avx2(uint64_t* acc, const uint8_t* in, const uint8_t* secret, size_t stripes) {
+    __m256i a0 = _mm256_loadu_si256((const __m256i*) acc);
+    __m256i a1 = _mm256_loadu_si256((const __m256i*) (acc + 4));
+    for (size_t s = 0; s < stripes; ++s, in += XXH_STRIPE_LEN, secret += XXH_SECRET_STEP) {
+        __m256i d0 = _mm256_loadu_si256((const __m256i*) in);
+        __m256i d1 = _mm256_loadu_si256((const __m256i*) (in + 32));
+        __m256i k0 = _mm256_xor_si256(d0, _mm256_loadu_si256((const __m256i*) secret));
+        __m256i k1 = _mm256_xor_si256(d1, _mm256_loadu_si256((const __m256i*) (secret + 32)));
+        __m256i p0 = _mm256_mul_epu32(k0, _mm256_shuffle_epi32(k0, _MM_SHUFFLE(0, 3, 0, 1)));
+        __m256i p1 = _mm256_mul_epu32(k1, _mm256_shuffle_epi32(k1, _MM_SHUFFLE(0, 3, 0, 1)));
+        a0 = _mm256_add_epi64(a0, _mm256_add_epi64(p0, _mm256_shuffle_epi32(d0, _MM_SHUFFLE(1, 0, 3, 2))));
+        a1 = _mm256_add_epi64(a1, _mm256_add_epi64(p1, _mm256_shuffle_epi32(d1, _MM_SHUFFLE(1, 0, 3, 2))));
+    }
+    _mm256_storeu_si256((__m256i*) acc, a0);
+    _mm256_storeu_si256((__m256i*) (acc + 4), a1);
+}
+
+__attribute__((target("avx2")))
+static void xxh3_scramble_avx2(uint64_t* acc, const uint8_t* secret) {
+    const __m256i prime = _mm256_set1_epi32((int) XXH_PRIME32_1);
+    for (int j = 0; j < 2; ++j) {
+        __m256i a = _mm256_loadu_si256((const __m256i*) (acc + 4 * j));
+        a = _mm256_xor_si256(a, _mm256_srli_epi64(a, 47));
+        a = _mm256_xor_si256(a, _mm256_loadu_si256((const __m256i*) (secret + 32 * j)));
+        __m256i lo = _mm256_mul_epu32(a, prime);
+        __m256i hi = _mm256_mul_epu32(_mm256_shuffle_epi32(a, _MM_SHUFFLE(0, 3, 0, 1)), prime);
+        _mm256_storeu_si256((__m256i*) (acc + 4 * j), _mm256_add_epi64(lo, _mm256_slli_epi64(hi, 32)));
+    }
+}
+
+#endif
@@ -0,0 +1,393 @@
+#include <string.h>
+#include "pizza/hash.h"
+#include "pizza/memory.h"
+#include "pizza/scan.h"
+#include "pizza/hashmap.h"
+
+#if SCAN_SIMD && defined(__SSE2__)
+#define HASHMAP_SSE2 1
+#include <emmintrin.h>
+#else
+#define HASHMAP_SSE2 0
+#endif
+
+#define HASHMAP_HASH_SEED 0x5bd1e995U
+
+// Control bytes: full buckets have their top bit clear.
+#define CTRL_EMPTY   ((int8_t) 0x80)
+#define CTRL_DELETED ((int8_t) 0xfe)
+
+// Hashes are 64 bits: the low 7 go into the control byte, and the rest
+// choose where to start probing.
+#define HASH_H1(h) ((h) >> 7)
+#define HASH_H2(h) ((int8_t) ((h) & 0x7f))
+
+// Not a bucket.
+#define BUCKET_NONE ((size_t) -1)
+
+// One bit for each bucket in a group.
+typedef uint32_t GroupMask;
+
+static uint64_t hash_slot(const HashMap* m, const char* slot);
+static size_t find(const HashMap* m, uint64_t hash, Slice ks, uint64_t ki);
+static void* insert(HashMap* m, uint64_t hash, Slice ks, uint64_t ki, int* added);
+static int erase(HashMap* m, size_t j);
+static size_t find_free(const HashMap* m, uint64_t hash);
+static void set_ctrl(HashMap* m, size_t j, int8_t ctrl);
+static void resize(HashMap* m, size_t buckets);
+static size_t buckets_for(size_t count);
+static size_t table_size(size_t buckets, uint32_t slot_size);
+
+void hashmap_build(HashMap* m, unsigned kind, size_t value_size) {
+    memset(m, 0, sizeof(HashMap));
+    m->kind = kind;
+    m->value_size = value_size;
+    size_t key_size = kind == HASHMAP_KEY_INT ? sizeof(uint64_t) : sizeof(Slice);
+    m->slot_size = (key_size + value_size + 7) & ~7UL;
+}
+
+void hashmap_build_in_arena(HashMap* m, unsigned kind, size_t value_size, Arena* arena) {
+    hashmap_build(m, kind, value_size);
+    m->arena = arena;
+}
+
+void hashmap_destroy(HashMap* m) {
+    resize(m, 0);
+    memset(m, 0, sizeof(HashMap));
+}
+
+void hashmap_clear(HashMap* m) {
+    if (!m->buckets) {
+        return;
+    }
+    memset(m->ctrl, CTRL_EMPTY, m->buckets + HASHMAP_GROUP);
+    m->size = 0;
+    m->growth_left = m->buckets - m->buckets / 8;
+}
+
+void hashmap_reserve(HashMap* m, size_t count) {
+    if (count <= m->size + m->growth_left) {
+        return;
+    }
+    size_t buckets = buckets_for(count);
+    resize(m, buckets > m->buckets ? buckets : m->buckets);
+}
+
+void hashmap_rehash(HashMap* m, size_t count) {
+    if (count < m->size) {
+        count = m->size;
+    }
+    resize(m, count ? buckets_for(count) : 0);
+}
+
+static inline uint64_t hash_key_slice(Slice key) {
+    return hash_xxh3_64(key.ptr, key.len, HASHMAP_HASH_SEED);
+}
+
+// Integers are mixed with the finalizer from MurmurHash3, so that keys that
+// only differ in a few bits spread well.
+static inline uint64_t hash_key_int(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return key;
+}
+
+void* hashmap_find_slice(const HashMap* m, Slice key) {
+    size_t j = find(m, hash_key_slice(key), key, 0);
+    return j == BUCKET_NONE ? 0 : hashmap_value(m, j);
+}
+
+void* hashmap_find_int(const HashMap* m, uint64_t key) {
+    Slice none = { .ptr = 0, .len = 0 };
+    size_t j = find(m, hash_key_int(key), none, key);
+    return j == BUCKET_NONE ? 0 : hashmap_value(m, j);
+}
+
+void* hashmap_insert_slice(HashMap* m, Slice key, int* added) {
+    return insert(m, hash_key_slice(key), key, 0, added);
+}
+
+void* hashmap_insert_int(HashMap* m, uint64_t key, int* added) {
+    Slice none = { .ptr = 0, .len = 0 };
+    return insert(m, hash_key_int(key), none, key, added);
+}
+
+int hashmap_erase_slice(HashMap* m, Slice key) {
+    return erase(m, find(m, hash_key_slice(key), key, 0));
+}
+
+int hashmap_erase_int(HashMap* m, uint64_t key) {
+    Slice none = { .ptr = 0, .len = 0 };
+    return erase(m, find(m, hash_key_int(key), none, key));
+}
+
+static inline char* slot_at(const HashMap* m, size_t j) {
+    return m->slots + j * m->slot_size;
+}
+
+Slice hashmap_key_slice(const HashMap* m, size_t j) {
+    return *(const Slice*) slot_at(m, j);
+}
+
+uint64_t hashmap_key_int(const HashMap* m, size_t j) {
+    return *(const uint64_t*) slot_at(m, j);
+}
+
+void* hashmap_value(const HashMap* m, size_t j) {
+    size_t key_size = m->kind == HASHMAP_KEY_INT ? sizeof(uint64_t) : sizeof(Slice);
+    return slot_at(m, j) + key_size;
+}
+
+/*
+ * Group operations: each one looks at the control bytes for HASHMAP_GROUP
+ * buckets, starting at g, and returns a mask with one bit per bucket.
+ * The control bytes for the first group are repeated after the last bucket,
+ * so that a group can start at any bucket.
+ */
+
+#if HASHMAP_SSE2
+
+static inline GroupMask group_match(const int8_t* g, int8_t h2) {
+    __m128i v = _mm_loadu_si128((const __m128i*) g);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(h2)));
+}
+
+static inline GroupMask group_empty(const int8_t* g) {
+    __m128i v = _mm_loadu_si128((const __m128i*) g);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(CTRL_EMPTY)));
+}
+
+// Empty and deleted buckets are exactly those with the top bit set.
+static inline GroupMask group_free(const int8_t* g) {
+    return _mm_movemask_epi8(_mm_loadu_si128((const __m128i*) g));
+}
+
+#else
+
+static inline GroupMask group_match(const int8_t* g, int8_t h2) {
+    GroupMask mask = 0;
+    for (int j = 0; j < HASHMAP_GROUP; ++j) {
+        mask |= (GroupMask) (g[j] == h2) << j;
+    }
+    return mask;
+}
+
+static inline GroupMask group_empty(const int8_t* g) {
+    return group_match(g, CTRL_EMPTY);
+}
+
+static inline GroupMask group_free(const int8_t* g) {
+    GroupMask mask = 0;
+    for (int j = 0; j < HASHMAP_GROUP; ++j) {
+        mask |= (GroupMask) (g[j] < 0) << j;
+    }
+    return mask;
+}
+
+#endif
+
+static inline GroupMask group_full(const int8_t* g) {
+    return ~group_free(g) & ((1U << HASHMAP_GROUP) - 1);
+}
+
+size_t hashmap_scan(const HashMap* m, size_t j) {
+    while (j < m->buckets) {
+        GroupMask full = group_full(m->ctrl + j);
+        size_t left = m->buckets - j;
+        if (left < HASHMAP_GROUP) {
+            // past the last bucket there are only copies of the first ones
+            full &= (1U << left) - 1;
+        }
+        if (full) {
+            return j + __builtin_ctz(full);
+        }
+        j += HASHMAP_GROUP;
+    }
+    return m->buckets;
+}
+
+static uint64_t hash_slot(const HashMap* m, const char* slot) {
+    if (m->kind == HASHMAP_KEY_INT) {
+        return hash_key_int(*(const uint64_t*) slot);
+    }
+    return hash_key_slice(*(const Slice*) slot);
+}
+
+static inline int key_equal(const HashMap* m, size_t j, Slice ks, uint64_t ki) {
+    const char* slot = slot_at(m, j);
+    if (m->kind == HASHMAP_KEY_INT) {
+        return *(const uint64_t*) slot == ki;
+    }
+    const Slice* key = (const Slice*) slot;
+    return key->len == ks.len && (!ks.len || memcmp(key->ptr, ks.ptr, ks.len) == 0);
+}
+
+// Groups are probed at growing distances: 1, 2, 3... groups after the
+// previous one; with a power of 2 buckets, this eventually visits all of
+// them, and there is always an empty bucket to stop at.
+static size_t find(const HashMap* m, uint64_t hash, Slice ks, uint64_t ki) {
+    if (!m->buckets) {
+        return BUCKET_NONE;
+    }
+    size_t mask = m->buckets - 1;
+    size_t pos = HASH_H1(hash) & mask;
+    int8_t h2 = HASH_H2(hash);
+    for (size_t stride = HASHMAP_GROUP; 1; stride += HASHMAP_GROUP) {
+        const int8_t* g = m->ctrl + pos;
+        GroupMask match = group_match(g, h2);
+        while (match) {
+            size_t j = (pos + __builtin_ctz(match)) & mask;
+            if (key_equal(m, j, ks, ki)) {
+                return j;
+            }
+            match &= match - 1;
+        }
+        if (group_empty(g)) {
+            return BUCKET_NONE;
+        }
+        pos = (pos + stride) & mask;
+    }
+}
+
+static size_t find_free(const HashMap* m, uint64_t hash) {
+    size_t mask = m->buckets - 1;
+    size_t pos = HASH_H1(hash) & mask;
+    for (size_t stride = HASHMAP_GROUP; 1; stride += HASHMAP_GROUP) {
+        GroupMask avail = group_free(m->ctrl + pos);
+        if (avail) {
+            return (pos + __builtin_ctz(avail)) & mask;
+        }
+        pos = (pos + stride) & mask;
+    }
+}
+
+static void* insert(HashMap* m, uint64_t hash, Slice ks, uint64_t ki, int* added) {
+    size_t j = find(m, hash, ks, ki);
+    if (j != BUCKET_NONE) {
+        if (added) {
+            *added = 0;
+        }
+        return hashmap_value(m, j);
+    }
+
+    if (!m->growth_left) {
+        // when many buckets are deleted, rehashing at the same size is enough
+        size_t buckets = m->buckets;
+        if (!buckets) {
+            buckets = HASHMAP_GROUP;
+        } else if (m->size + 1 > (buckets - buckets / 8) / 2) {
+            buckets *= 2;
+        }
+        resize(m, buckets);
+    }
+
+    j = find_free(m, hash);
+    if (m->ctrl[j] == CTRL_EMPTY) {
+        --m->growth_left;
+    }
+    set_ctrl(m, j, HASH_H2(hash));
+    ++m->size;
+
+    char* slot = slot_at(m, j);
+    if (m->kind == HASHMAP_KEY_INT) {
+        *(uint64_t*) slot = ki;
+    } else {
+        *(Slice*) slot = ks;
+    }
+    void* value = hashmap_value(m, j);
+    memset(value, 0, m->value_size);
+    if (added) {
+        *added = 1;
+    }
+    return value;
+}
+
+// A bucket can go back to empty unless it is part of a run of full buckets
+// as long as a group: then some probe may have gone past it, and finding an
+// empty bucket there would stop it too early.
+static int erase(HashMap* m, size_t j) {
+    if (j == BUCKET_NONE) {
+        return 0;
+    }
+    size_t before = (j - HASHMAP_GROUP) & (m->buckets - 1);
+    GroupMask empty_before = group_empty(m->ctrl + before);
+    GroupMask empty_after = group_empty(m->ctrl + j);
+    int full_before = empty_before ? __builtin_clz(empty_before) - (32 - HASHMAP_GROUP) : HASHMAP_GROUP;
+    int full_after = empty_after ? __builtin_ctz(empty_after) : HASHMAP_GROUP;
+    if (full_before + full_after >= HASHMAP_GROUP) {
+        set_ctrl(m, j, CTRL_DELETED);
+    } else {
+        set_ctrl(m, j, CTRL_EMPTY);
+        ++m->growth_left;
+    }
+    --m->size;
+    return 1;
+}
+
+static void set_ctrl(HashMap* m, size_t j, int8_t ctrl) {
+    m->ctrl[j] = ctrl;
+    m->ctrl[((j - HASHMAP_GROUP) & (m->buckets - 1)) + HASHMAP_GROUP] = ctrl;
+}
+
+// Move all keys into a table with a given number of buckets, which may be 0
+// to release the table.
+static void resize(HashMap* m, size_t buckets) {
+    int8_t* ctrl = m->ctrl;
+    char* slots = m->slots;
+    size_t old = m->buckets;
+
+    m->ctrl = 0;
+    m->slots = 0;
+    m->buckets = buckets;
+    m->growth_left = buckets - buckets / 8 - m->size;
+    if (buckets) {
+        size_t size = table_size(buckets, m->slot_size);
+        if (m->arena) {
+            m->ctrl = (int8_t*) arena_alloc(m->arena, size);
+        } else {
+            m->ctrl = (int8_t*) memory_realloc_tag(0, 0, size, MEMORY_TAG_OTHER);
+        }
+        m->slots = (char*) m->ctrl + table_size(buckets, 0);
+        memset(m->ctrl, CTRL_EMPTY, buckets + HASHMAP_GROUP);
+        for (size_t j = 0; j < old; ++j) {
+            if (ctrl[j] < 0) {
+                continue;
+            }
+            const char* slot = slots + j * m->slot_size;
+            uint64_t hash = hash_slot(m, slot);
+            size_t k = find_free(m, hash);
+            set_ctrl(m, k, HASH_H2(hash));
+            memcpy(slot_at(m, k), slot, m->slot_size);
+        }
+    } else {
+        m->size = 0;
+        m->growth_left = 0;
+    }
+
+    if (old) {
+        size_t size = table_size(old, m->slot_size);
+        if (m->arena) {
+            arena_realloc(m->arena, ctrl, size, 0);
+        } else {
+            memory_realloc_tag(ctrl, size, 0, MEMORY_TAG_OTHER);
+        }
+    }
+}
+
+// Tables are at most 7/8 full.
+static size_t buckets_for(size_t count) {
+    size_t buckets = HASHMAP_GROUP;
+    while (buckets - buckets / 8 < count) {
+        buckets *= 2;
+    }
+    return buckets;
+}
+
+// Control bytes come first, followed by the slots, 16-byte aligned.
+static size_t table_size(size_t buckets, uint32_t slot_size) {
+    size_t ctrl = (buckets + HASHMAP_GROUP + 15) & ~15UL;
+    return ctrl + buckets * slot_size;
+}
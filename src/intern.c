@@ -0,0 +1,160 @@
+#include <string.h>
+#include "pizza/hash.h"
+#include "pizza/memory.h"
+#include "pizza/intern.h"
+
+#define INTERN_INITIAL_SLOTS 64  // must be a power of 2
+
+struct InternEntry {
+    const char* ptr;
+    SliceLen len;
+    uint32_t hash;
+};
+
+static Atom find(Interner* in, Slice s, uint32_t hash);
+static InternEntry* entry(const Interner* in, Atom atom);
+static uint64_t* probe(const Interner* in, Slice s, uint32_t hash);
+static void grow(Interner* in);
+
+void intern_build(Interner* in) {
+    memset(in, 0, sizeof(Interner));
+    pthread_rwlock_init(&in->lock, 0);
+    arena_build(&in->arena, 0);
+    in->mask = INTERN_INITIAL_SLOTS - 1;
+    in->slots = (uint64_t*) memory_realloc_tag(0, 0, INTERN_INITIAL_SLOTS * sizeof(uint64_t), MEMORY_TAG_OTHER);
+    memset(in->slots, 0, INTERN_INITIAL_SLOTS * sizeof(uint64_t));
+}
+
+void intern_destroy(Interner* in) {
+    memory_realloc_tag(in->slots, (in->mask + 1) * sizeof(uint64_t), 0, MEMORY_TAG_OTHER);
+    arena_destroy(&in->arena);
+    pthread_rwlock_destroy(&in->lock);
+    memset(in, 0, sizeof(Interner));
+}
+
+Atom intern_add(Interner* in, Slice s) {
+    uint32_t hash = hash_murmur3(s.ptr, s.len, INTERN_HASH_SEED);
+    Atom atom = find(in, s, hash);
+    if (atom != ATOM_NONE) {
+        return atom;
+    }
+
+    pthread_rwlock_wrlock(&in->lock);
+    do {
+        // another thread may have added it in the meantime
+        uint64_t* slot = probe(in, s, hash);
+        if (*slot) {
+            atom = *slot & 0xffffffffU;
+            break;
+        }
+        if (in->count >= INTERN_SEGMENT_BASE * ((1U << INTERN_SEGMENTS) - 1)) {
+            break;
+        }
+
+        atom = in->count + 1;
+        uint32_t k = 31 - __builtin_clz((atom - 1) / INTERN_SEGMENT_BASE + 1);
+        if (!in->segments[k]) {
+            size_t size = (size_t) INTERN_SEGMENT_BASE << k;
+            in->segments[k] = (InternEntry*) arena_alloc(&in->arena, size * sizeof(InternEntry));
+        }
+        char* copy = (char*) arena_alloc(&in->arena, s.len + 1);
+        if (s.len) {
+            memcpy(copy, s.ptr, s.len);
+        }
+        copy[s.len] = '\0';
+        InternEntry* e = entry(in, atom);
+        e->ptr = copy;
+        e->len = s.len;
+        e->hash = hash;
+        ++in->count;
+
+        // keep at most half of the slots in use, so that probes are short
+        if (2 * (uint64_t) in->count > in->mask + 1) {
+            grow(in);
+            slot = probe(in, s, hash);
+        }
+        *slot = (uint64_t) hash << 32 | atom;
+    } while (0);
+    pthread_rwlock_unlock(&in->lock);
+    return atom;
+}
+
+Atom intern_find(Interner* in, Slice s) {
+    return find(in, s, hash_murmur3(s.ptr, s.len, INTERN_HASH_SEED));
+}
+
+Slice intern_slice(const Interner* in, Atom atom) {
+    if (atom == ATOM_NONE) {
+        return slice_from_memory(0, 0);
+    }
+    const InternEntry* e = entry(in, atom);
+    return slice_from_memory(e->ptr, e->len);
+}
+
+uint32_t intern_hash(const Interner* in, Atom atom) {
+    if (atom == ATOM_NONE) {
+        return 0;
+    }
+    return entry(in, atom)->hash;
+}
+
+uint32_t intern_count(Interner* in) {
+    pthread_rwlock_rdlock(&in->lock);
+    uint32_t count = in->count;
+    pthread_rwlock_unlock(&in->lock);
+    return count;
+}
+
+static Atom find(Interner* in, Slice s, uint32_t hash) {
+    pthread_rwlock_rdlock(&in->lock);
+    uint64_t slot = *probe(in, s, hash);
+    pthread_rwlock_unlock(&in->lock);
+    return slot & 0xffffffffU;
+}
+
+// Segment k holds INTERN_SEGMENT_BASE << k atoms, so the segment for an atom
+// depends on the position of the top bit in its index.
+static InternEntry* entry(const Interner* in, Atom atom) {
+    uint32_t index = atom - 1;
+    uint32_t k = 31 - __builtin_clz(index / INTERN_SEGMENT_BASE + 1);
+    uint32_t first = INTERN_SEGMENT_BASE * ((1U << k) - 1);
+    return in->segments[k] + (index - first);
+}
+
+// Return the slot with the atom for s, or the empty slot where it would go.
+static uint64_t* probe(const Interner* in, Slice s, uint32_t hash) {
+    for (uint32_t j = hash & in->mask; 1; j = (j + 1) & in->mask) {
+        uint64_t slot = in->slots[j];
+        if (!slot) {
+            return in->slots + j;
+        }
+        if ((uint32_t) (slot >> 32) != hash) {
+            continue;
+        }
+        const InternEntry* e = entry(in, slot & 0xffffffffU);
+        if (e->len == s.len && (!s.len || memcmp(e->ptr, s.ptr, s.len) == 0)) {
+            return in->slots + j;
+        }
+    }
+}
+
+static void grow(Interner* in) {
+    uint32_t size = in->mask + 1;
+    uint64_t* slots = (uint64_t*) memory_realloc_tag(0, 0, 2 * size * sizeof(uint64_t), MEMORY_TAG_OTHER);
+    memset(slots, 0, 2 * size * sizeof(uint64_t));
+    uint32_t mask = 2 * size - 1;
+    for (uint32_t j = 0; j < size; ++j) {
+        uint64_t slot = in->slots[j];
+        if (!slot) {
+            continue;
+        }
+        uint32_t k = (slot >> 32) & mask;
+        while (slots[k]) {
+            k = (k + 1) & mask;
+        }
+        slots[k] = slot;
+    }
+    memory_realloc_tag(in->slots, size * sizeof(uint64_t), 0, MEMORY_TAG_OTHER);
+    in->slots = slots;
+    in->mask = mask;
+}
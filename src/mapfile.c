@@ -0,0 +1,105 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "pizza/log.h"
+#include "pizza/mapfile.h"
+
+int mapfile_build(MappedFile* m, Path* p) {
+    memset(m, 0, sizeof(MappedFile));
+    int ret = 0;
+    int fd = -1;
+    do {
+        int flags = O_RDONLY;
+        fd = open(p->name.ptr, flags);
+        int err = fd < 0 ? errno : 0;
+        LOG_DEBUG("OPEN R [%s] %b => %d (%d)", p->name.ptr, flags, fd, err);
+        if (err) {
+            ret = err;
+            break;
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) < 0) {
+            ret = errno;
+            break;
+        }
+        if (!S_ISREG(st.st_mode)) {
+            ret = EINVAL;
+            break;
+        }
+        if ((uint64_t) st.st_size > SLICE_LEN_MAX) {
+            ret = EFBIG;
+            break;
+        }
+        if (st.st_size == 0) {
+            // cannot map zero bytes; an empty file is just an empty Slice
+            break;
+        }
+
+        void* ptr = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (ptr == MAP_FAILED) {
+            ret = errno;
+            break;
+        }
+        LOG_DEBUG("MMAP [%s] %lu bytes => %p", p->name.ptr, (unsigned long) st.st_size, ptr);
+        m->ptr = (char*) ptr;
+        m->len = st.st_size;
+    } while (0);
+    if (fd >= 0) {
+        // the mapping stays valid after closing the file
+        int r = close(fd);
+        int err = r < 0 ? errno : 0;
+        LOG_DEBUG("CLOSE [%s] %d => %d (%d)", p->name.ptr, fd, r, err);
+        if (!ret && err) {
+            ret = err;
+        }
+    }
+    if (ret) {
+        mapfile_destroy(m);
+    }
+    return ret;
+}
+
+void mapfile_destroy(MappedFile* m) {
+    if (m->ptr) {
+        munmap(m->ptr, m->len);
+    }
+    memset(m, 0, sizeof(MappedFile));
+}
+
+Slice mapfile_slice(const MappedFile* m) {
+    return slice_from_memory(m->ptr, m->len);
+}
+
+int mapfile_advise(MappedFile* m, unsigned flags) {
+    if (!m->ptr) {
+        return 0;
+    }
+    static const struct {
+        unsigned flag;
+        int advice;
+    } hints[] = {
+        { MAPFILE_ADVISE_SEQUENTIAL, MADV_SEQUENTIAL },
+        { MAPFILE_ADVISE_RANDOM    , MADV_RANDOM     },
+        { MAPFILE_ADVISE_WILLNEED  , MADV_WILLNEED   },
+    };
+    for (unsigned j = 0; j < sizeof(hints) / sizeof(hints[0]); ++j) {
+        if (!(flags & hints[j].flag)) {
+            continue;
+        }
+        if (madvise(m->ptr, m->len, hints[j].advice) < 0) {
+            return errno;
+        }
+    }
+#if defined(MADV_HUGEPAGE)
+    if (flags & MAPFILE_ADVISE_HUGEPAGE) {
+        if (madvise(m->ptr, m->len, MADV_HUGEPAGE) < 0) {
+            LOG_DEBUG("Could not use huge pages for %p (%d)", m->ptr, errno);
+        }
+    }
+#endif
+    return 0;
+}
@@ -0,0 +1,537 @@
+#include <string.h>
+#include "pizza/scan.h"
+#include "pizza/matcher.h"
+
+#if SCAN_SIMD && defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define MATCHER_X86 1
+#include <immintrin.h>
+#else
+#define MATCHER_X86 0
+#endif
+
+#define MATCHER_TEDDY_BUCKETS  8  // one bit per bucket in the nibble tables
+#define MATCHER_TEDDY_BYTES    3  // at most this many leading bytes are checked
+
+// Flag for transitions into states where some pattern ends.
+#define MATCHER_AUTO_HIT 0x80000000U
+
+// State for the Two-Way algorithm; needle is split at a critical position
+// into a left and a right half, which are compared in opposite directions.
+struct MatcherTwoWay {
+    const unsigned char* needle;
+    size_t len;
+    size_t split;       // last position of the left half; -1 if empty
+    size_t period;      // shift after a mismatch in the left half
+    size_t memory;      // prefix known to match after shifting by period
+    size_t shift[256];  // 1 + last position of each byte in needle, or 0
+    uint32_t pattern;
+};
+
+// Nibble tables for the SIMD filter: bit b is set in lo[k][n] / hi[k][n] if
+// some pattern in bucket b has a byte with low / high nibble n at position k.
+struct MatcherTeddy {
+    uint8_t lo[MATCHER_TEDDY_BYTES][16];
+    uint8_t hi[MATCHER_TEDDY_BYTES][16];
+    uint32_t first[MATCHER_TEDDY_BUCKETS + 1];  // patterns in bucket b go from
+    uint32_t ids[MATCHER_TEDDY_MAX_PATTERNS];   // ids[first[b]] to ids[first[b+1]]
+    int width;                                  // leading bytes checked
+};
+
+// Aho-Corasick automaton, as a full transition table; bytes that are not in
+// any pattern all behave the same, so they share a single column.
+// Transitions hold the row for the next state, so that no multiplication is
+// needed while searching, and MATCHER_AUTO_HIT if patterns end there.
+struct MatcherAuto {
+    uint16_t cls[256];  // column for each byte
+    uint32_t classes;   // number of columns
+    uint32_t* next;     // next row, at next[state * classes + cls[byte]]
+    uint32_t* out;      // 1 + a pattern ending at each state, or 0
+    uint32_t* link;     // next state with patterns along the failure links
+    uint32_t* same;     // 1 + another pattern ending at the same state, or 0
+};
+
+// A search in progress.
+typedef struct Search {
+    const SliceMatcher* m;
+    Slice text;
+    MatcherVisitor* visit;
+    void* arg;
+    SliceLen found;
+} Search;
+
+// Where matcher_find_all() puts the matches.
+typedef struct Sink {
+    SliceMatch* matches;
+    SliceLen cap;
+    SliceLen cnt;
+} Sink;
+
+static void twoway_build(MatcherTwoWay* tw, const char* ptr, size_t len, uint32_t pattern);
+static size_t twoway_max_suffix(const unsigned char* n, size_t len, int reverse, size_t* period);
+static void twoway_search(const MatcherTwoWay* tw, Search* s);
+static MatcherAuto* auto_build(SliceMatcher* m);
+static void auto_search(const MatcherAuto* a, Search* s);
+static int sink_visit(uint32_t pattern, SliceLen pos, void* arg);
+static int first_visit(uint32_t pattern, SliceLen pos, void* arg);
+#if MATCHER_X86
+static MatcherTeddy* teddy_build(SliceMatcher* m);
+static void teddy_scalar(const MatcherTeddy* t, Search* s, SliceLen pos);
+static void teddy_avx2(const MatcherTeddy* t, Search* s);
+#endif
+
+void matcher_build(SliceMatcher* m, const Slice* patterns, uint32_t count) {
+    memset(m, 0, sizeof(SliceMatcher));
+    arena_build(&m->arena, 0);
+    m->count = count;
+    if (!count) {
+        return;
+    }
+
+    m->patterns = (Slice*) arena_alloc(&m->arena, count * sizeof(Slice));
+    uint32_t used = 0;
+    uint32_t last = 0;
+    for (uint32_t j = 0; j < count; ++j) {
+        SliceLen len = patterns[j].len;
+        char* copy = 0;
+        if (len) {
+            copy = (char*) arena_alloc(&m->arena, len);
+            memcpy(copy, patterns[j].ptr, len);
+            ++used;
+            last = j;
+        }
+        m->patterns[j] = slice_from_memory(copy, len);
+    }
+
+    if (used == 1) {
+        m->twoway = (MatcherTwoWay*) arena_alloc(&m->arena, sizeof(MatcherTwoWay));
+        twoway_build(m->twoway, m->patterns[last].ptr, m->patterns[last].len, last);
+    } else if (used > 1) {
+        // the filter needs AVX2, which may be turned off with scan_set_level()
+        // at any time, so there is always an automaton to fall back on
+        m->automaton = auto_build(m);
+#if MATCHER_X86
+        if (used <= MATCHER_TEDDY_MAX_PATTERNS) {
+            m->teddy = teddy_build(m);
+        }
+#endif
+    }
+}
+
+void matcher_destroy(SliceMatcher* m) {
+    arena_destroy(&m->arena);
+    memset(m, 0, sizeof(SliceMatcher));
+}
+
+SliceLen matcher_search(const SliceMatcher* m, Slice text, MatcherVisitor visit, void* arg) {
+    Search s = { .m = m, .text = text, .visit = visit, .arg = arg, .found = 0 };
+    if (m->twoway) {
+        twoway_search(m->twoway, &s);
+#if MATCHER_X86
+    } else if (m->teddy && scan_get_level() == SCAN_LEVEL_AVX2) {
+        teddy_avx2(m->teddy, &s);
+#endif
+    } else if (m->automaton) {
+        auto_search(m->automaton, &s);
+    }
+    return s.found;
+}
+
+SliceLen matcher_find_all(const SliceMatcher* m, Slice text, SliceMatch* matches, SliceLen cap) {
+    Sink sink = { .matches = matches, .cap = cap, .cnt = 0 };
+    return matcher_search(m, text, sink_visit, &sink);
+}
+
+Slice matcher_find_slice(Slice s, Slice t) {
+    if (s.len < t.len) {
+        return slice_from_memory(0, 0);
+    }
+    if (!t.len) {
+        return slice_from_memory(s.ptr, 0);
+    }
+
+    MatcherTwoWay tw;
+    twoway_build(&tw, t.ptr, t.len, 0);
+    SliceLen pos = 0;
+    Search search = { .m = 0, .text = s, .visit = first_visit, .arg = &pos, .found = 0 };
+    twoway_search(&tw, &search);
+    if (!search.found) {
+        return slice_from_memory(0, 0);
+    }
+    return slice_from_memory(s.ptr + pos, t.len);
+}
+
+// Report a match; return non-zero if the search must stop.
+static inline int report(Search* s, uint32_t pattern, SliceLen pos) {
+    ++s->found;
+    return s->visit(pattern, pos, s->arg);
+}
+
+static void twoway_build(MatcherTwoWay* tw, const char* ptr, size_t len, uint32_t pattern) {
+    const unsigned char* n = (const unsigned char*) ptr;
+    tw->needle = n;
+    tw->len = len;
+    tw->pattern = pattern;
+    memset(tw->shift, 0, sizeof(tw->shift));
+    for (size_t j = 0; j < len; ++j) {
+        tw->shift[n[j]] = j + 1;
+    }
+
+    // the critical position comes from the longer of the maximal suffixes
+    // for both orderings of the bytes; the "+ 1" take care of -1
+    size_t p0 = 0;
+    size_t p1 = 0;
+    size_t s0 = twoway_max_suffix(n, len, 0, &p0);
+    size_t s1 = twoway_max_suffix(n, len, 1, &p1);
+    tw->split = s1 + 1 > s0 + 1 ? s1 : s0;
+    tw->period = s1 + 1 > s0 + 1 ? p1 : p0;
+
+    if (memcmp(n, n + tw->period, tw->split + 1) == 0) {
+        // periodic needle: after a shift by the period, its start is
+        // already known to match
+        tw->memory = len - tw->period;
+    } else {
+        // otherwise the period is larger than either half, and shifting by
+        // the longer half plus one is safe
+        size_t left = tw->split;
+        size_t right = len - tw->split - 1;
+        tw->period = (left > right ? left : right) + 1;
+        tw->memory = 0;
+    }
+}
+
+// Return the start of the maximal suffix of n minus one, and its period.
+static size_t twoway_max_suffix(const unsigned char* n, size_t len, int reverse, size_t* period) {
+    size_t ip = (size_t) -1;
+    size_t jp = 0;
+    size_t k = 1;
+    size_t p = 1;
+    while (jp + k < len) {
+        unsigned char a = n[ip + k];
+        unsigned char b = n[jp + k];
+        if (a == b) {
+            if (k == p) {
+                jp += p;
+                k = 1;
+            } else {
+                ++k;
+            }
+        } else if (reverse ? a < b : a > b) {
+            jp += k;
+            k = 1;
+            p = jp - ip;
+        } else {
+            ip = jp++;
+            k = p = 1;
+        }
+    }
+    *period = p;
+    return ip;
+}
+
+static void twoway_search(const MatcherTwoWay* tw, Search* s) {
+    const unsigned char* n = tw->needle;
+    const unsigned char* base = (const unsigned char*) s->text.ptr;
+    size_t top = s->text.len;
+    size_t len = tw->len;
+
+    if (len == 1) {
+        const char* p = s->text.ptr;
+        const char* e = p + s->text.len;
+        while ((p = scan_byte(p, e - p, n[0])) != 0) {
+            if (report(s, tw->pattern, p - s->text.ptr)) {
+                return;
+            }
+            ++p;
+        }
+        return;
+    }
+
+    size_t pos = 0;
+    size_t memory = 0;
+    while (pos <= top && top - pos >= len) {
+        const unsigned char* h = base + pos;
+
+        // look at the last byte first, and skip ahead if it is not in the
+        // needle or does not line up with its last occurrence there
+        size_t k = tw->shift[h[len - 1]];
+        if (!k) {
+            pos += len;
+            memory = 0;
+            continue;
+        }
+        k = len - k;
+        if (k) {
+            pos += k < memory ? memory : k;
+            memory = 0;
+            continue;
+        }
+
+        // compare the right half, left to right
+        k = tw->split + 1 > memory ? tw->split + 1 : memory;
+        while (k < len && n[k] == h[k]) {
+            ++k;
+        }
+        if (k < len) {
+            pos += k - tw->split;
+            memory = 0;
+            continue;
+        }
+
+        // compare the left half, right to left
+        k = tw->split + 1;
+        while (k > memory && n[k - 1] == h[k - 1]) {
+            --k;
+        }
+        if (k <= memory) {
+            if (report(s, tw->pattern, pos)) {
+                return;
+            }
+        }
+        pos += tw->period;
+        memory = tw->memory;
+    }
+}
+
+static MatcherAuto* auto_build(SliceMatcher* m) {
+    MatcherAuto* a = (MatcherAuto*) arena_alloc(&m->arena, sizeof(MatcherAuto));
+    memset(a->cls, 0, sizeof(a->cls));
+
+    // column 0 is for the bytes not in any pattern; there can be at most one
+    // state per pattern byte, plus the root
+    a->classes = 1;
+    size_t total = 1;
+    for (uint32_t j = 0; j < m->count; ++j) {
+        Slice p = m->patterns[j];
+        total += p.len;
+        for (SliceLen k = 0; k < p.len; ++k) {
+            unsigned char c = p.ptr[k];
+            if (!a->cls[c]) {
+                a->cls[c] = a->classes++;
+            }
+        }
+    }
+    a->next = (uint32_t*) arena_alloc(&m->arena, total * a->classes * sizeof(uint32_t));
+    a->out = (uint32_t*) arena_alloc(&m->arena, total * sizeof(uint32_t));
+    a->link = (uint32_t*) arena_alloc(&m->arena, total * sizeof(uint32_t));
+    a->same = (uint32_t*) arena_alloc(&m->arena, m->count * sizeof(uint32_t));
+    memset(a->next, 0, total * a->classes * sizeof(uint32_t));
+    memset(a->out, 0, total * sizeof(uint32_t));
+    memset(a->link, 0, total * sizeof(uint32_t));
+    memset(a->same, 0, m->count * sizeof(uint32_t));
+
+    // build the trie; state 0 is the root, and no transition ever goes back
+    // to it, so 0 means "no transition yet"
+    uint32_t states = 1;
+    for (uint32_t j = 0; j < m->count; ++j) {
+        Slice p = m->patterns[j];
+        if (!p.len) {
+            continue;
+        }
+        uint32_t st = 0;
+        for (SliceLen k = 0; k < p.len; ++k) {
+            uint32_t* cell = a->next + (size_t) st * a->classes + a->cls[(unsigned char) p.ptr[k]];
+            if (!*cell) {
+                *cell = states++;
+            }
+            st = *cell;
+        }
+        a->same[j] = a->out[st];
+        a->out[st] = j + 1;
+    }
+
+    // visit states in breadth-first order, computing their failure links and
+    // filling the missing transitions with those of the failure state, which
+    // is shallower and therefore already complete
+    ArenaMark mark = arena_mark(&m->arena);
+    uint32_t* fail = (uint32_t*) arena_alloc(&m->arena, states * sizeof(uint32_t));
+    uint32_t* queue = (uint32_t*) arena_alloc(&m->arena, states * sizeof(uint32_t));
+    uint32_t head = 0;
+    uint32_t tail = 0;
+    for (uint32_t c = 0; c < a->classes; ++c) {
+        uint32_t t = a->next[c];
+        if (t) {
+            fail[t] = 0;
+            queue[tail++] = t;
+        }
+    }
+    while (head < tail) {
+        uint32_t st = queue[head++];
+        uint32_t* row = a->next + (size_t) st * a->classes;
+        const uint32_t* fail_row = a->next + (size_t) fail[st] * a->classes;
+        for (uint32_t c = 0; c < a->classes; ++c) {
+            uint32_t t = row[c];
+            if (!t) {
+                row[c] = fail_row[c];
+                continue;
+            }
+            uint32_t f = fail_row[c];
+            fail[t] = f;
+            a->link[t] = a->out[f] ? f : a->link[f];
+            queue[tail++] = t;
+        }
+    }
+    arena_rewind(&m->arena, mark);
+
+    for (size_t j = 0; j < (size_t) states * a->classes; ++j) {
+        uint32_t t = a->next[j];
+        a->next[j] = t * a->classes | (a->out[t] | a->link[t] ? MATCHER_AUTO_HIT : 0);
+    }
+    return a;
+}
+
+static void auto_search(const MatcherAuto* a, Search* s) {
+    const unsigned char* ptr = (const unsigned char*) s->text.ptr;
+    const Slice* patterns = s->m->patterns;
+    uint32_t row = 0;
+    for (SliceLen j = 0; j < s->text.len; ++j) {
+        uint32_t t = a->next[row + a->cls[ptr[j]]];
+        row = t & ~MATCHER_AUTO_HIT;
+        if (!(t & MATCHER_AUTO_HIT)) {
+            continue;
+        }
+        // all patterns ending here: those for this state, and for all the
+        // states along the failure links
+        uint32_t st = row / a->classes;
+        for (uint32_t o = a->out[st] ? st : a->link[st]; o; o = a->link[o]) {
+            for (uint32_t id = a->out[o]; id; id = a->same[id - 1]) {
+                if (report(s, id - 1, j + 1 - patterns[id - 1].len)) {
+                    return;
+                }
+            }
+        }
+    }
+}
+
+static int sink_visit(uint32_t pattern, SliceLen pos, void* arg) {
+    Sink* sink = (Sink*) arg;
+    if (sink->cnt < sink->cap) {
+        sink->matches[sink->cnt].pos = pos;
+        sink->matches[sink->cnt].pattern = pattern;
+    }
+    ++sink->cnt;
+    return 0;
+}
+
+static int first_visit(uint32_t pattern, SliceLen pos, void* arg) {
+    (void) pattern;
+    *(SliceLen*) arg = pos;
+    return 1;
+}
+
+#if MATCHER_X86
+
+static MatcherTeddy* teddy_build(SliceMatcher* m) {
+    MatcherTeddy* t = (MatcherTeddy*) arena_alloc(&m->arena, sizeof(MatcherTeddy));
+    memset(t, 0, sizeof(MatcherTeddy));
+
+    // all patterns must be at least width bytes long
+    t->width = MATCHER_TEDDY_BYTES;
+    for (uint32_t j = 0; j < m->count; ++j) {
+        SliceLen len = m->patterns[j].len;
+        if (len && (SliceLen) t->width > len) {
+            t->width = len;
+        }
+    }
+
+    // patterns are spread over the buckets in turns
+    uint32_t n = 0;
+    for (uint32_t b = 0; b < MATCHER_TEDDY_BUCKETS; ++b) {
+        t->first[b] = n;
+        uint32_t seen = 0;
+        for (uint32_t j = 0; j < m->count; ++j) {
+            Slice p = m->patterns[j];
+            if (!p.len) {
+                continue;
+            }
+            if (seen++ % MATCHER_TEDDY_BUCKETS != b) {
+                continue;
+            }
+            t->ids[n++] = j;
+            for (int k = 0; k < t->width; ++k) {
+                unsigned char c = p.ptr[k];
+                t->lo[k][c & 0x0f] |= 1U << b;
+                t->hi[k][c >> 4] |= 1U << b;
+            }
+        }
+    }
+    t->first[MATCHER_TEDDY_BUCKETS] = n;
+    return t;
+}
+
+// Compare in full all the patterns in the buckets that may start at pos;
+// return non-zero if the search must stop.
+static inline int teddy_verify(const MatcherTeddy* t, Search* s, SliceLen pos, unsigned buckets) {
+    while (buckets) {
+        unsigned b = __builtin_ctz(buckets);
+        buckets &= buckets - 1;
+        for (uint32_t j = t->first[b]; j < t->first[b + 1]; ++j) {
+            uint32_t id = t->ids[j];
+            Slice p = s->m->patterns[id];
+            if (p.len > s->text.len - pos || memcmp(s->text.ptr + pos, p.ptr, p.len) != 0) {
+                continue;
+            }
+            if (report(s, id, pos)) {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+static void teddy_scalar(const MatcherTeddy* t, Search* s, SliceLen pos) {
+    const unsigned char* ptr = (const unsigned char*) s->text.ptr;
+    for (; pos + t->width <= s->text.len; ++pos) {
+        unsigned buckets = 0xff;
+        for (int k = 0; k < t->width; ++k) {
+            unsigned char c = ptr[pos + k];
+            buckets &= t->lo[k][c & 0x0f] & t->hi[k][c >> 4];
+        }
+        if (buckets && teddy_verify(t, s, pos, buckets)) {
+            return;
+        }
+    }
+}
+
+// Look at the leading bytes for 32 positions at a time: shuffling the nibble
+// tables with the nibbles of those bytes gives the buckets with a pattern
+// that may start at each position.
+__attribute__((target("avx2")))
+static void teddy_avx2(const MatcherTeddy* t, Search* s) {
+    const char* ptr = s->text.ptr;
+    SliceLen len = s->text.len;
+    const __m256i low_nibble = _mm256_set1_epi8(0x0f);
+    __m256i lo[MATCHER_TEDDY_BYTES];
+    __m256i hi[MATCHER_TEDDY_BYTES];
+    for (int k = 0; k < t->width; ++k) {
+        lo[k] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*) t->lo[k]));
+        hi[k] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*) t->hi[k]));
+    }
+
+    // the last of the 32 positions needs width bytes
+    SliceLen pos = 0;
+    for (; pos + 32 + t->width - 1 <= len; pos += 32) {
+        __m256i res = _mm256_set1_epi8(-1);
+        for (int k = 0; k < t->width; ++k) {
+            __m256i v = _mm256_loadu_si256((const __m256i*) (ptr + pos + k));
+            __m256i l = _mm256_shuffle_epi8(lo[k], _mm256_and_si256(v, low_nibble));
+            __m256i h = _mm256_shuffle_epi8(hi[k], _mm256_and_si256(_mm256_srli_epi16(v, 4), low_nibble));
+            res = _mm256_and_si256(res, _mm256_and_si256(l, h));
+        }
+        unsigned bits = ~(unsigned) _mm256_movemask_epi8(_mm256_cmpeq_epi8(res, _mm256_setzero_si256()));
+        if (!bits) {
+            continue;
+        }
+        uint8_t buckets[32];
+        _mm256_storeu_si256((__m256i*) buckets, res);
+        while (bits) {
+            unsigned j = __builtin_ctz(bits);
+            bits &= bits - 1;
+            if (teddy_verify(t, s, pos + j, buckets[j])) {
+                return;
+            }
+        }
+    }
+    teddy_scalar(t, s, pos);
+}
+
+#endif
@@ -39,15 +39,14 @@ void md5_reset(MD5 *md5) {
 void md5_update(MD5* md5, Slice s) {
     int mdi = BITS_M64(md5->bits[0]);
 
-    // update number of bits
-    if ((md5->bits[0] + (s.len << 3)) < md5->bits[0]) {
-        md5->bits[1]++;
-    }
-    md5->bits[0] += s.len << 3;
-    md5->bits[1] += s.len >> 29;
+    // update number of bits, as a 64-bit count split in two words
+    uint64_t bits = ((uint64_t) md5->bits[1] << 32) | md5->bits[0];
+    bits += (uint64_t) s.len << 3;
+    md5->bits[0] = (uint32_t) bits;
+    md5->bits[1] = (uint32_t) (bits >> 32);
 
     uint32_t inp[MD5_DIGEST_LEN];
-    for (uint32_t pos = 0; pos < s.len; ++pos) {
+    for (SliceLen pos = 0; pos < s.len; ++pos) {
         // add new character to buffer, increment mdi
         md5->input[mdi++] = s.ptr[pos];
 
@@ -90,11 +89,13 @@ void md5_finalize(MD5* md5) {
 }
 
 void md5_format(MD5* md5, Buffer* b) {
+    char* out = buffer_reserve_tail(b, 2 * MD5_DIGEST_LEN);
     for (uint32_t k = 0; k < MD5_DIGEST_LEN; ++k) {
         uint8_t byte = md5->digest[k];
-        buffer_append_byte(b, tohex(byte >> 4));
-        buffer_append_byte(b, tohex(byte & 0xf));
+        *out++ = tohex(byte >> 4);
+        *out++ = tohex(byte & 0xf);
     }
+    buffer_commit(b, 2 * MD5_DIGEST_LEN);
 }
 
 void md5_compute(MD5* md5, Slice s, Buffer* b) {
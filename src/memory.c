@@ -1,10 +1,15 @@
 #include <ctype.h>
 #include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
 #include "pizza/stb_sprintf.h"
 #include "pizza/console.h"
 #include "pizza/log.h"
 #include "pizza/memory.h"
+#include "pizza/bufpool.h"
 
 static void dump_line(int row, const char* byte, int white, const char* text) {
     console_printf("%06x | %s%*s | %-16s |\n", row, byte, white, "", text);
@@ -36,7 +41,193 @@ void dump_bytes(const void* ptr, size_t len) {
     }
 }
 
+// Bump a counter that is only ever written by its own thread; other threads
+// may read it (relaxed) when taking a snapshot.
+#define COUNTER_ADD(c, v) \
+    atomic_store_explicit(&(c), atomic_load_explicit(&(c), memory_order_relaxed) + (v), memory_order_relaxed)
+
+// Per-thread counters for a tag.
+typedef struct TagCounters {
+    _Atomic uint64_t allocs;
+    _Atomic uint64_t reallocs;
+    _Atomic uint64_t frees;
+    _Atomic uint64_t histogram[MEMORY_HISTOGRAM_BUCKETS];
+} TagCounters;
+
+// All per-thread counters, linked into a global list so snapshots can find
+// them.
+typedef struct ThreadCounters {
+    TagCounters tag[MEMORY_TAG_LAST];
+    struct ThreadCounters* next;
+} ThreadCounters;
+
+static const char* memory_tag_names[MEMORY_TAG_LAST] = {
+    "other",
+    "buffer",
+    "path",
+    "deflator",
+    "thrpool",
+    "crypto",
+};
+
+static void* system_realloc(void* ctx, void* ptr, size_t len);
+static size_t memory_pages(size_t len);
+static void stats_record(MemoryTag tag, size_t olen, size_t nlen);
+
+const MemoryAllocator memory_allocator_system = {
+    .name = "system",
+    .realloc = system_realloc,
+    .ctx = 0,
+};
+
+static const MemoryAllocator* allocator = &memory_allocator_system;
+
+const MemoryAllocator* memory_set_allocator(const MemoryAllocator* a) {
+    // pooled blocks must go back to the allocator that produced them
+    bufpool_flush();
+    const MemoryAllocator* old = allocator;
+    allocator = a ? a : &memory_allocator_system;
+    return old;
+}
+
+const MemoryAllocator* memory_get_allocator(void) {
+    return allocator;
+}
+
 void* memory_realloc(void* ptr, size_t len) {
+    void* tmp = allocator->realloc(allocator->ctx, ptr, len);
+    if (len <= 0 || tmp) {
+        return tmp;
+    }
+
+    // bad things happened
+    if (errno) {
+        LOG_WARNING("Could not realloc %p to %lu bytes", ptr, len);
+    } else {
+        LOG_WARNING("Could not allocate memory to realloc %p to %lu bytes", ptr, len);
+    }
+    abort();
+    return 0;
+}
+
+void* memory_realloc_tag(void* ptr, size_t olen, size_t nlen, MemoryTag tag) {
+    if (!ptr && !nlen) {
+        return 0;
+    }
+    void* tmp = memory_realloc(ptr, nlen);
+    stats_record(tag, ptr ? olen : 0, nlen);
+    return tmp;
+}
+
+void* memory_remap(void* ptr, size_t olen, size_t nlen, unsigned flags, MemoryTag tag) {
+    if (!ptr && !nlen) {
+        return 0;
+    }
+
+    size_t osize = ptr ? memory_pages(olen) : 0;
+    size_t nsize = memory_pages(nlen);
+    void* tmp = 0;
+    do {
+        if (!nlen) {
+            munmap(ptr, osize);
+            break;
+        }
+        if (!ptr) {
+            tmp = mmap(0, nsize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        } else if (osize == nsize) {
+            tmp = ptr;
+        } else {
+            tmp = mremap(ptr, osize, nsize, MREMAP_MAYMOVE);
+        }
+        if (tmp == MAP_FAILED) {
+            LOG_WARNING("Could not map %p from %lu to %lu bytes (%d)", ptr, osize, nsize, errno);
+            abort();
+        }
+#if defined(MADV_HUGEPAGE)
+        if (flags & MEMORY_MAP_HUGE_PAGES) {
+            madvise(tmp, nsize, MADV_HUGEPAGE);
+        }
+#else
+        (void) flags;
+#endif
+    } while (0);
+    stats_record(tag, ptr ? olen : 0, nlen);
+    return tmp;
+}
+
+void* memory_realloc_system(void* ptr, size_t len) {
+    void* tmp = system_realloc(0, ptr, len);
+    if (len <= 0 || tmp) {
+        return tmp;
+    }
+
+    LOG_WARNING("Could not realloc %p to %lu bytes from system", ptr, len);
+    abort();
+    return 0;
+}
+
+void* memory_secure_alloc(size_t len, unsigned flags) {
+    if (len <= 0) {
+        return 0;
+    }
+
+    void* ptr = 0;
+    if (flags & MEMORY_SECURE_LOCK) {
+        // use whole pages, so that locking / unlocking does not affect other
+        // data; fresh pages are already cleared
+        size_t size = memory_pages(len);
+        ptr = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr == MAP_FAILED) {
+            LOG_WARNING("Could not map %lu bytes for sensitive data", size);
+            abort();
+        }
+        if (mlock(ptr, size) < 0) {
+            LOG_DEBUG("Could not lock %lu bytes for sensitive data (%d)", size, errno);
+        }
+#if defined(MADV_DONTDUMP)
+        madvise(ptr, size, MADV_DONTDUMP);
+#endif
+    } else {
+        ptr = memory_realloc(0, len);
+        memset(ptr, 0, len);
+    }
+    stats_record(MEMORY_TAG_CRYPTO, 0, len);
+    return ptr;
+}
+
+void memory_secure_free(void* ptr, size_t len, unsigned flags) {
+    if (!ptr) {
+        return;
+    }
+
+    memory_secure_wipe(ptr, len);
+    if (flags & MEMORY_SECURE_LOCK) {
+        size_t size = memory_pages(len);
+        munlock(ptr, size);
+        munmap(ptr, size);
+    } else {
+        memory_realloc(ptr, 0);
+    }
+    stats_record(MEMORY_TAG_CRYPTO, len, 0);
+}
+
+void memory_secure_wipe(void* ptr, size_t len) {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 25))
+    explicit_bzero(ptr, len);
+#else
+    // calling memset through a volatile pointer keeps it from being removed
+    static void* (* volatile wipe)(void*, int, size_t) = memset;
+    wipe(ptr, 0, len);
+#endif
+}
+
+static size_t memory_pages(size_t len) {
+    size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    return (len + page - 1) / page * page;
+}
+
+static void* system_realloc(void* ctx, void* ptr, size_t len) {
+    (void) ctx;
     if (len <= 0) {
         // want to release the memory
         if (ptr) {
@@ -46,17 +237,173 @@ void* memory_realloc(void* ptr, size_t len) {
     }
 
     // want to create / resize the memory
-    void* tmp = (void*) realloc(ptr, len);
-    if (tmp) {
-        return tmp;
+    return realloc(ptr, len);
+}
+
+// Live bytes and peaks must be seen by all threads at once, so these are
+// global; everything else is counted per thread.
+static _Atomic int stats_enabled = 0;
+static _Atomic int64_t stats_live[MEMORY_TAG_LAST];
+static _Atomic int64_t stats_peak[MEMORY_TAG_LAST];
+
+// Counters for live threads; counters for threads that exited are added up
+// into stats_retired, and their memory goes into stats_unused for reuse.
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t stats_once = PTHREAD_ONCE_INIT;
+static pthread_key_t stats_key;
+static ThreadCounters* stats_threads = 0;
+static ThreadCounters* stats_unused = 0;
+static ThreadCounters stats_retired;
+static _Thread_local ThreadCounters* stats_local = 0;
+
+static void stats_retire(void* arg) {
+    ThreadCounters* tc = (ThreadCounters*) arg;
+    pthread_mutex_lock(&stats_lock);
+    for (ThreadCounters** p = &stats_threads; *p; p = &(*p)->next) {
+        if (*p == tc) {
+            *p = tc->next;
+            break;
+        }
+    }
+    for (int t = 0; t < MEMORY_TAG_LAST; ++t) {
+        TagCounters* r = &stats_retired.tag[t];
+        TagCounters* c = &tc->tag[t];
+        COUNTER_ADD(r->allocs, atomic_load(&c->allocs));
+        COUNTER_ADD(r->reallocs, atomic_load(&c->reallocs));
+        COUNTER_ADD(r->frees, atomic_load(&c->frees));
+        for (int b = 0; b < MEMORY_HISTOGRAM_BUCKETS; ++b) {
+            COUNTER_ADD(r->histogram[b], atomic_load(&c->histogram[b]));
+        }
     }
+    tc->next = stats_unused;
+    stats_unused = tc;
+    pthread_mutex_unlock(&stats_lock);
+    stats_local = 0;
+}
 
-    // bad things happened
-    if (errno) {
-        LOG_WARNING("Could not realloc %p to %lu bytes", ptr, len);
+static void stats_key_create(void) {
+    pthread_key_create(&stats_key, stats_retire);
+}
+
+static ThreadCounters* stats_get_local(void) {
+    if (stats_local) {
+        return stats_local;
+    }
+
+    pthread_once(&stats_once, stats_key_create);
+    pthread_mutex_lock(&stats_lock);
+    ThreadCounters* tc = stats_unused;
+    if (tc) {
+        stats_unused = tc->next;
     } else {
-        LOG_WARNING("Could not allocate memory to realloc %p to %lu bytes", ptr, len);
+        tc = (ThreadCounters*) memory_realloc_system(0, sizeof(ThreadCounters));
     }
-    abort();
-    return 0;
+    memset(tc, 0, sizeof(ThreadCounters));
+    tc->next = stats_threads;
+    stats_threads = tc;
+    pthread_mutex_unlock(&stats_lock);
+
+    stats_local = tc;
+    pthread_setspecific(stats_key, tc);
+    return tc;
+}
+
+static int stats_bucket(size_t len) {
+    int bucket = 0;
+    while (len > 1 && bucket < MEMORY_HISTOGRAM_BUCKETS - 1) {
+        len >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+
+static void stats_record(MemoryTag tag, size_t olen, size_t nlen) {
+    if (!atomic_load_explicit(&stats_enabled, memory_order_relaxed)) {
+        return;
+    }
+    if ((unsigned) tag >= MEMORY_TAG_LAST) {
+        tag = MEMORY_TAG_OTHER;
+    }
+
+    TagCounters* c = &stats_get_local()->tag[tag];
+    if (nlen == 0) {
+        COUNTER_ADD(c->frees, 1);
+    } else {
+        COUNTER_ADD(c->histogram[stats_bucket(nlen)], 1);
+        if (olen == 0) {
+            COUNTER_ADD(c->allocs, 1);
+        } else {
+            COUNTER_ADD(c->reallocs, 1);
+        }
+    }
+
+    int64_t delta = (int64_t) nlen - (int64_t) olen;
+    if (!delta) {
+        return;
+    }
+    int64_t live = atomic_fetch_add_explicit(&stats_live[tag], delta, memory_order_relaxed) + delta;
+    int64_t peak = atomic_load_explicit(&stats_peak[tag], memory_order_relaxed);
+    while (live > peak &&
+           !atomic_compare_exchange_weak_explicit(&stats_peak[tag], &peak, live,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed)) {
+    }
+}
+
+void memory_stats_enable(int enabled) {
+    atomic_store(&stats_enabled, enabled ? 1 : 0);
+}
+
+static void stats_add(MemoryTagStats* s, TagCounters* c) {
+    s->allocs += atomic_load_explicit(&c->allocs, memory_order_relaxed);
+    s->reallocs += atomic_load_explicit(&c->reallocs, memory_order_relaxed);
+    s->frees += atomic_load_explicit(&c->frees, memory_order_relaxed);
+    for (int b = 0; b < MEMORY_HISTOGRAM_BUCKETS; ++b) {
+        s->histogram[b] += atomic_load_explicit(&c->histogram[b], memory_order_relaxed);
+    }
+}
+
+void memory_stats_snapshot(MemoryStats* stats) {
+    memset(stats, 0, sizeof(MemoryStats));
+    pthread_mutex_lock(&stats_lock);
+    for (int t = 0; t < MEMORY_TAG_LAST; ++t) {
+        MemoryTagStats* s = &stats->tag[t];
+        s->live = atomic_load_explicit(&stats_live[t], memory_order_relaxed);
+        s->peak = atomic_load_explicit(&stats_peak[t], memory_order_relaxed);
+        stats_add(s, &stats_retired.tag[t]);
+        for (ThreadCounters* tc = stats_threads; tc; tc = tc->next) {
+            stats_add(s, &tc->tag[t]);
+        }
+    }
+    pthread_mutex_unlock(&stats_lock);
+}
+
+void memory_stats_dump(const MemoryStats* stats) {
+    console_printf("%-10s %12s %12s %10s %10s %10s\n",
+                   "tag", "live", "peak", "allocs", "reallocs", "frees");
+    for (int t = 0; t < MEMORY_TAG_LAST; ++t) {
+        const MemoryTagStats* s = &stats->tag[t];
+        console_printf("%-10s %12lld %12lld %10llu %10llu %10llu\n",
+                       memory_tag_names[t],
+                       (long long) s->live, (long long) s->peak,
+                       (unsigned long long) s->allocs,
+                       (unsigned long long) s->reallocs,
+                       (unsigned long long) s->frees);
+        for (int b = 0; b < MEMORY_HISTOGRAM_BUCKETS; ++b) {
+            if (!s->histogram[b]) {
+                continue;
+            }
+            console_printf("%10s %s%12lu: %llu\n", "",
+                           b == MEMORY_HISTOGRAM_BUCKETS - 1 ? ">=" : "< ",
+                           b == MEMORY_HISTOGRAM_BUCKETS - 1 ? 1UL << b : 2UL << b,
+                           (unsigned long long) s->histogram[b]);
+        }
+    }
+}
+
+const char* memory_tag_name(MemoryTag tag) {
+    if ((unsigned) tag >= MEMORY_TAG_LAST) {
+        return "";
+    }
+    return memory_tag_names[tag];
 }
@@ -6,10 +6,9 @@
 #include "pizza/log.h"
 #include "pizza/path.h"
 
-#define BUFFER_SIZE 4096
-
 void path_build(Path* p) {
     buffer_build(&p->name);
+    p->name.tag = MEMORY_TAG_PATH;
 }
 
 void path_from_string(Path* p, const char* str, int len) {
@@ -243,20 +242,7 @@ int path_slurp(Path* p, Buffer* b) {
             break;
         }
 
-        while (1) {
-            char tmp[BUFFER_SIZE];
-            ssize_t nread = read(fd, tmp, BUFFER_SIZE);
-            if (nread == 0) {
-                break;
-            }
-            if (nread > 0) {
-                LOG_DEBUG("READ %u", nread);
-                buffer_append_string(b, tmp, nread);
-                continue;
-            }
-            ret = errno;
-            break;
-        }
+        ret = buffer_read_fd(b, fd);
     } while (0);
     if (fd >= 0) {
         int r = close(fd);
@@ -269,7 +255,50 @@ int path_slurp(Path* p, Buffer* b) {
     return ret;
 }
 
-static int write_to_file(Path* p, Slice s, int action) {
+int path_copy(Path* p, Path* to) {
+    int ret = 0;
+    int src = -1;
+    int dst = -1;
+    do {
+        int flags = O_RDONLY;
+        src = open(p->name.ptr, flags);
+        int err = src < 0 ? errno : 0;
+        LOG_DEBUG("OPEN R [%s] %b => %d (%d)", p->name.ptr, flags, src, err);
+        if (err) {
+            ret = err;
+            break;
+        }
+
+        flags = O_CREAT | O_WRONLY | O_TRUNC;
+        mode_t mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH; // 0644
+        dst = open(to->name.ptr, flags, mode);
+        err = dst < 0 ? errno : 0;
+        LOG_DEBUG("OPEN C [%s] %b => %d (%d)", to->name.ptr, flags, dst, err);
+        if (err) {
+            ret = err;
+            break;
+        }
+
+        uint64_t copied = 0;
+        ret = buffer_copy_fd(src, dst, &copied);
+        LOG_DEBUG("COPY [%s] => [%s] %lu bytes (%d)", p->name.ptr, to->name.ptr, (unsigned long) copied, ret);
+    } while (0);
+    int fds[2] = { src, dst };
+    for (int j = 0; j < 2; ++j) {
+        if (fds[j] < 0) {
+            continue;
+        }
+        int r = close(fds[j]);
+        int err = r < 0 ? errno : 0;
+        LOG_DEBUG("CLOSE %d => %d (%d)", fds[j], r, err);
+        if (!ret && err) {
+            ret = err;
+        }
+    }
+    return ret;
+}
+
+static int write_to_file(Path* p, const BufferChain* c, int action) {
     int ret = 0;
     int fd = -1;
     do {
@@ -283,20 +312,7 @@ static int write_to_file(Path* p, Slice s, int action) {
             break;
         }
 
-        size_t twritten = 0;
-        while (1) {
-            if (twritten >= s.len) {
-                break;
-            }
-            ssize_t nwritten = write(fd, s.ptr + twritten, s.len - twritten);
-            if (nwritten) {
-                LOG_DEBUG("WRITE %u", nwritten);
-                twritten += nwritten;
-                continue;
-            }
-            ret = errno;
-            break;
-        }
+        ret = bufchain_write_fd(c, fd);
     } while (0);
     if (fd >= 0) {
         int r = close(fd);
@@ -309,12 +325,29 @@ static int write_to_file(Path* p, Slice s, int action) {
     return ret;
 }
 
+static int write_slice_to_file(Path* p, Slice s, int action) {
+    // a single segment fits inside the chain, so this does not allocate
+    BufferChain c; bufchain_build(&c);
+    bufchain_append_slice(&c, s);
+    int ret = write_to_file(p, &c, action);
+    bufchain_destroy(&c);
+    return ret;
+}
+
 int path_spew(Path* p, Slice s) {
-    return write_to_file(p, s, O_TRUNC);
+    return write_slice_to_file(p, s, O_TRUNC);
 }
 
 int path_append(Path* p, Slice s) {
-    return write_to_file(p, s, O_APPEND);
+    return write_slice_to_file(p, s, O_APPEND);
+}
+
+int path_spew_chain(Path* p, const BufferChain* c) {
+    return write_to_file(p, c, O_TRUNC);
+}
+
+int path_append_chain(Path* p, const BufferChain* c) {
+    return write_to_file(p, c, O_APPEND);
 }
 
 static int last_slash(Path* p) {
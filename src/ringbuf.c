@@ -0,0 +1,145 @@
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "pizza/log.h"
+#include "pizza/ringbuf.h"
+
+int ringbuf_build(RingBuffer* r, SliceLen size) {
+    memset(r, 0, sizeof(RingBuffer));
+    int ret = 0;
+    int fd = -1;
+    char* ptr = MAP_FAILED;
+    do {
+        // positions go up to twice the size, and that must fit in a SliceLen
+        SliceLen page = (SliceLen) sysconf(_SC_PAGESIZE);
+        if (size > SLICE_LEN_MAX / 2 - page) {
+            ret = EINVAL;
+            break;
+        }
+        size = size == 0 ? page : (size + page - 1) / page * page;
+
+        fd = memfd_create("ringbuf", MFD_CLOEXEC);
+        if (fd < 0) {
+            ret = errno;
+            break;
+        }
+        if (ftruncate(fd, size) < 0) {
+            ret = errno;
+            break;
+        }
+
+        // reserve address space for both copies, then map the file twice
+        // over it; the reservation guarantees the two copies are adjacent
+        ptr = (char*) mmap(0, 2 * (size_t) size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr == MAP_FAILED) {
+            ret = errno;
+            break;
+        }
+        for (int j = 0; j < 2; ++j) {
+            void* tmp = mmap(ptr + j * (size_t) size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+            if (tmp == MAP_FAILED) {
+                ret = errno;
+                break;
+            }
+        }
+        if (ret) {
+            break;
+        }
+        LOG_DEBUG("RINGBUF %p %u bytes", ptr, (unsigned) size);
+        r->ptr = ptr;
+        r->size = size;
+    } while (0);
+    if (ret && ptr != MAP_FAILED) {
+        munmap(ptr, 2 * (size_t) size);
+    }
+    if (fd >= 0) {
+        // the mappings keep the memory file alive
+        close(fd);
+    }
+    return ret;
+}
+
+void ringbuf_destroy(RingBuffer* r) {
+    if (r->ptr) {
+        munmap(r->ptr, 2 * (size_t) r->size);
+    }
+    memset(r, 0, sizeof(RingBuffer));
+}
+
+void ringbuf_clear(RingBuffer* r) {
+    r->pos = 0;
+    r->len = 0;
+}
+
+Slice ringbuf_slice(const RingBuffer* r) {
+    return slice_from_memory(r->ptr + r->pos, r->len);
+}
+
+char* ringbuf_tail(const RingBuffer* r) {
+    return r->ptr + r->pos + r->len;
+}
+
+void ringbuf_commit(RingBuffer* r, SliceLen n) {
+    r->len += n;
+}
+
+void ringbuf_consume(RingBuffer* r, SliceLen n) {
+    if (n >= r->len) {
+        // ring is now empty -- start again at the front
+        ringbuf_clear(r);
+        return;
+    }
+    r->pos += n;
+    r->len -= n;
+    if (r->pos >= r->size) {
+        r->pos -= r->size;
+    }
+}
+
+SliceLen ringbuf_append_slice(RingBuffer* r, Slice s) {
+    SliceLen n = s.len < ringbuf_room(r) ? s.len : ringbuf_room(r);
+    memcpy(ringbuf_tail(r), s.ptr, n);
+    ringbuf_commit(r, n);
+    return n;
+}
+
+int ringbuf_read_fd(RingBuffer* r, int fd, SliceLen* nread) {
+    *nread = 0;
+    if (ringbuf_room(r) == 0) {
+        return ENOBUFS;
+    }
+    while (1) {
+        ssize_t n = read(fd, ringbuf_tail(r), ringbuf_room(r));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            return errno;
+        }
+        LOG_DEBUG("READ %ld", (long) n);
+        ringbuf_commit(r, n);
+        *nread = n;
+        return 0;
+    }
+}
+
+int ringbuf_write_fd(RingBuffer* r, int fd, SliceLen* nwritten) {
+    *nwritten = 0;
+    if (r->len == 0) {
+        return 0;
+    }
+    while (1) {
+        ssize_t n = write(fd, r->ptr + r->pos, r->len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            return errno;
+        }
+        LOG_DEBUG("WRITE %ld", (long) n);
+        ringbuf_consume(r, n);
+        *nwritten = n;
+        return 0;
+    }
+}
@@ -0,0 +1,795 @@
+#include <stdatomic.h>
+#include <string.h>
+#include "pizza/scan.h"
+
+#if SCAN_SIMD && defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define SCAN_X86 1
+#include <immintrin.h>
+#else
+#define SCAN_X86 0
+#endif
+
+// Sets with at most this many distinct bytes are searched comparing against
+// each byte, even if they could be searched by nibbles.
+#define SCAN_SET_FEW_BYTES 4
+
+static _Atomic int scan_level = -1;
+
+static int detect_level(void);
+static int get_level(void);
+static const char* byte_scalar(const char* ptr, size_t len, char t);
+static const char* byte_reverse_scalar(const char* ptr, size_t len, char t);
+static const char* set_scalar(const char* ptr, size_t len, const ScanSet* set, int in);
+static void masks_scalar(const char* ptr, size_t len, const ScanSet* set, uint64_t* masks);
+static void fold_scalar(char* ptr, size_t len, int upper);
+static size_t prefix_nocase_scalar(const char* l, const char* r, size_t len);
+static const char* find_nocase_scalar(const char* ptr, size_t len, const char* needle, size_t nlen);
+#if SCAN_X86
+static void masks_sse2(const char* ptr, size_t len, const ScanSet* set, uint64_t* masks);
+static void masks_avx2(const char* ptr, size_t len, const ScanSet* set, uint64_t* masks);
+static void fold_sse2(char* ptr, size_t len, int upper);
+static size_t prefix_nocase_sse2(const char* l, const char* r, size_t len);
+static const char* find_nocase_sse2(const char* ptr, size_t len, const char* needle, size_t nlen);
+static void fold_avx2(char* ptr, size_t len, int upper);
+static size_t prefix_nocase_avx2(const char* l, const char* r, size_t len);
+static const char* find_nocase_avx2(const char* ptr, size_t len, const char* needle, size_t nlen);
+static const char* byte_sse2(const char* ptr, size_t len, char t);
+static const char* byte_reverse_sse2(const char* ptr, size_t len, char t);
+static const char* set_sse2(const char* ptr, size_t len, const ScanSet* set, int in);
+static const char* byte_avx2(const char* ptr, size_t len, char t);
+static const char* byte_reverse_avx2(const char* ptr, size_t len, char t);
+static const char* set_avx2(const char* ptr, size_t len, const ScanSet* set, int in);
+#endif
+
+int scan_get_level(void) {
+    return get_level();
+}
+
+int scan_set_level(int level) {
+    int best = detect_level();
+    if (level < SCAN_LEVEL_SCALAR || level > best) {
+        level = best;
+    }
+    atomic_store_explicit(&scan_level, level, memory_order_relaxed);
+    return level;
+}
+
+const char* scan_byte(const char* ptr, size_t len, char t) {
+    switch (get_level()) {
+#if SCAN_X86
+        case SCAN_LEVEL_AVX2:
+            return byte_avx2(ptr, len, t);
+        case SCAN_LEVEL_SSE2:
+            return byte_sse2(ptr, len, t);
+#endif
+        default:
+            return byte_scalar(ptr, len, t);
+    }
+}
+
+const char* scan_byte_reverse(const char* ptr, size_t len, char t) {
+    switch (get_level()) {
+#if SCAN_X86
+        case SCAN_LEVEL_AVX2:
+            return byte_reverse_avx2(ptr, len, t);
+        case SCAN_LEVEL_SSE2:
+            return byte_reverse_sse2(ptr, len, t);
+#endif
+        default:
+            return byte_reverse_scalar(ptr, len, t);
+    }
+}
+
+void scan_set_build(ScanSet* set, const char* ptr, size_t len) {
+    memset(set, 0, sizeof(ScanSet));
+    for (size_t j = 0; j < len; ++j) {
+        unsigned char c = ptr[j];
+        if (set->map[c]) {
+            continue;
+        }
+        set->map[c] = 1;
+        if (set->count < SCAN_SET_MAX_BYTES) {
+            set->bytes[set->count] = ptr[j];
+        }
+        ++set->count;
+    }
+
+    // give each distinct high nibble in the set its own bit; if there are no
+    // more than 8 of them, a byte is in the set exactly when
+    // lo[low nibble] & hi[high nibble] is not zero
+    int buckets = 0;
+    set->nibbles = 1;
+    for (int h = 0; h < 16 && set->nibbles; ++h) {
+        for (int l = 0; l < 16; ++l) {
+            if (!set->map[h * 16 + l]) {
+                continue;
+            }
+            if (!set->hi[h]) {
+                if (buckets >= 8) {
+                    set->nibbles = 0;
+                    break;
+                }
+                set->hi[h] = 1U << buckets++;
+            }
+            set->lo[l] |= set->hi[h];
+        }
+    }
+}
+
+const char* scan_set_first_in(const char* ptr, size_t len, const ScanSet* set) {
+    switch (get_level()) {
+#if SCAN_X86
+        case SCAN_LEVEL_AVX2:
+            return set_avx2(ptr, len, set, 1);
+        case SCAN_LEVEL_SSE2:
+            return set_sse2(ptr, len, set, 1);
+#endif
+        default:
+            return set_scalar(ptr, len, set, 1);
+    }
+}
+
+const char* scan_set_first_not_in(const char* ptr, size_t len, const ScanSet* set) {
+    switch (get_level()) {
+#if SCAN_X86
+        case SCAN_LEVEL_AVX2:
+            return set_avx2(ptr, len, set, 0);
+        case SCAN_LEVEL_SSE2:
+            return set_sse2(ptr, len, set, 0);
+#endif
+        default:
+            return set_scalar(ptr, len, set, 0);
+    }
+}
+
+void scan_set_masks(const char* ptr, size_t len, const ScanSet* set, uint64_t* masks) {
+    switch (get_level()) {
+#if SCAN_X86
+        case SCAN_LEVEL_AVX2:
+            masks_avx2(ptr, len, set, masks);
+            break;
+        case SCAN_LEVEL_SSE2:
+            masks_sse2(ptr, len, set, masks);
+            break;
+#endif
+        default:
+            masks_scalar(ptr, len, set, masks);
+            break;
+    }
+}
+
+void scan_to_lower(char* ptr, size_t len) {
+    switch (get_level()) {
+#if SCAN_X86
+        case SCAN_LEVEL_AVX2:
+            fold_avx2(ptr, len, 0);
+            break;
+        case SCAN_LEVEL_SSE2:
+            fold_sse2(ptr, len, 0);
+            break;
+#endif
+        default:
+            fold_scalar(ptr, len, 0);
+            break;
+    }
+}
+
+void scan_to_upper(char* ptr, size_t len) {
+    switch (get_level()) {
+#if SCAN_X86
+        case SCAN_LEVEL_AVX2:
+            fold_avx2(ptr, len, 1);
+            break;
+        case SCAN_LEVEL_SSE2:
+            fold_sse2(ptr, len, 1);
+            break;
+#endif
+        default:
+            fold_scalar(ptr, len, 1);
+            break;
+    }
+}
+
+size_t scan_prefix_nocase(const char* l, const char* r, size_t len) {
+    switch (get_level()) {
+#if SCAN_X86
+        case SCAN_LEVEL_AVX2:
+            return prefix_nocase_avx2(l, r, len);
+        case SCAN_LEVEL_SSE2:
+            return prefix_nocase_sse2(l, r, len);
+#endif
+        default:
+            return prefix_nocase_scalar(l, r, len);
+    }
+}
+
+const char* scan_find_nocase(const char* ptr, size_t len, const char* needle, size_t nlen) {
+    if (len < nlen) {
+        return 0;
+    }
+    if (!nlen) {
+        return ptr;
+    }
+    switch (get_level()) {
+#if SCAN_X86
+        case SCAN_LEVEL_AVX2:
+            return find_nocase_avx2(ptr, len, needle, nlen);
+        case SCAN_LEVEL_SSE2:
+            return find_nocase_sse2(ptr, len, needle, nlen);
+#endif
+        default:
+            return find_nocase_scalar(ptr, len, needle, nlen);
+    }
+}
+
+static int detect_level(void) {
+#if SCAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return SCAN_LEVEL_AVX2;
+    }
+    return SCAN_LEVEL_SSE2;
+#else
+    return SCAN_LEVEL_SCALAR;
+#endif
+}
+
+static int get_level(void) {
+    // several threads may detect the level at the same time; they will all
+    // get the same answer, so that is harmless
+    int level = atomic_load_explicit(&scan_level, memory_order_relaxed);
+    if (level < 0) {
+        level = detect_level();
+        atomic_store_explicit(&scan_level, level, memory_order_relaxed);
+    }
+    return level;
+}
+
+static const char* byte_scalar(const char* ptr, size_t len, char t) {
+    return len ? (const char*) memchr(ptr, t, len) : 0;
+}
+
+static const char* byte_reverse_scalar(const char* ptr, size_t len, char t) {
+#if defined(_GNU_SOURCE)
+    return len ? (const char*) memrchr(ptr, t, len) : 0;
+#else
+    for (size_t j = len; j-- > 0; ) {
+        if (ptr[j] == t) {
+            return ptr + j;
+        }
+    }
+    return 0;
+#endif
+}
+
+static const char* set_scalar(const char* ptr, size_t len, const ScanSet* set, int in) {
+    for (size_t j = 0; j < len; ++j) {
+        if (!set->map[(unsigned char) ptr[j]] == !in) {
+            return ptr + j;
+        }
+    }
+    return 0;
+}
+
+static void masks_scalar(const char* ptr, size_t len, const ScanSet* set, uint64_t* masks) {
+    size_t words = (len + 63) / 64;
+    memset(masks, 0, words * sizeof(uint64_t));
+    for (size_t j = 0; j < len; ++j) {
+        if (set->map[(unsigned char) ptr[j]]) {
+            masks[j / 64] |= 1ULL << (j % 64);
+        }
+    }
+}
+
+// Only ASCII letters change case, no matter what the locale says.
+static inline char ascii_lower(char c) {
+    return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+}
+
+static void fold_scalar(char* ptr, size_t len, int upper) {
+    char lo = upper ? 'a' : 'A';
+    char hi = upper ? 'z' : 'Z';
+    for (size_t j = 0; j < len; ++j) {
+        if (ptr[j] >= lo && ptr[j] <= hi) {
+            ptr[j] ^= 0x20;
+        }
+    }
+}
+
+static size_t prefix_nocase_scalar(const char* l, const char* r, size_t len) {
+    size_t j = 0;
+    while (j < len && ascii_lower(l[j]) == ascii_lower(r[j])) {
+        ++j;
+    }
+    return j;
+}
+
+static const char* find_nocase_scalar(const char* ptr, size_t len, const char* needle, size_t nlen) {
+    char first = ascii_lower(needle[0]);
+    for (size_t j = 0; j + nlen <= len; ++j) {
+        if (ascii_lower(ptr[j]) == first && prefix_nocase_scalar(ptr + j + 1, needle + 1, nlen - 1) == nlen - 1) {
+            return ptr + j;
+        }
+    }
+    return 0;
+}
+
+#if SCAN_X86
+
+/*
+ * All SIMD versions work the same way: compare a whole block of bytes, turn
+ * the result into a bit mask with one bit per byte, and find the first /
+ * last bit set.  When the data does not fill a whole number of blocks, the
+ * last block overlaps the previous one, and the bits for bytes that were
+ * already checked are masked out; data shorter than one block is handled
+ * one byte at a time.
+ */
+
+static const char* byte_sse2(const char* ptr, size_t len, char t) {
+    if (len < 16) {
+        return byte_scalar(ptr, len, t);
+    }
+    const __m128i n = _mm_set1_epi8(t);
+    size_t j = 0;
+    for (; j + 16 <= len; j += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*) (ptr + j));
+        unsigned m = _mm_movemask_epi8(_mm_cmpeq_epi8(v, n));
+        if (m) {
+            return ptr + j + __builtin_ctz(m);
+        }
+    }
+    if (j < len) {
+        size_t k = len - 16;
+        __m128i v = _mm_loadu_si128((const __m128i*) (ptr + k));
+        unsigned m = _mm_movemask_epi8(_mm_cmpeq_epi8(v, n));
+        m &= 0xffffU << (j - k);
+        if (m) {
+            return ptr + k + __builtin_ctz(m);
+        }
+    }
+    return 0;
+}
+
+static const char* byte_reverse_sse2(const char* ptr, size_t len, char t) {
+    if (len < 16) {
+        return byte_reverse_scalar(ptr, len, t);
+    }
+    const __m128i n = _mm_set1_epi8(t);
+    size_t j = len;
+    while (j >= 16) {
+        j -= 16;
+        __m128i v = _mm_loadu_si128((const __m128i*) (ptr + j));
+        unsigned m = _mm_movemask_epi8(_mm_cmpeq_epi8(v, n));
+        if (m) {
+            return ptr + j + 31 - __builtin_clz(m);
+        }
+    }
+    if (j > 0) {
+        __m128i v = _mm_loadu_si128((const __m128i*) ptr);
+        unsigned m = _mm_movemask_epi8(_mm_cmpeq_epi8(v, n));
+        m &= (1U << j) - 1;
+        if (m) {
+            return ptr + 31 - __builtin_clz(m);
+        }
+    }
+    return 0;
+}
+
+// Return a mask with the bytes in a 16-byte block that are in the set.
+static inline unsigned set_block_sse2(__m128i v, const __m128i* n, int count) {
+    __m128i acc = _mm_setzero_si128();
+    for (int k = 0; k < count; ++k) {
+        acc = _mm_or_si128(acc, _mm_cmpeq_epi8(v, n[k]));
+    }
+    return _mm_movemask_epi8(acc);
+}
+
+static const char* set_sse2(const char* ptr, size_t len, const ScanSet* set, int in) {
+    if (len < 16 || set->count > SCAN_SET_MAX_BYTES) {
+        return set_scalar(ptr, len, set, in);
+    }
+    __m128i n[SCAN_SET_MAX_BYTES];
+    for (int k = 0; k < set->count; ++k) {
+        n[k] = _mm_set1_epi8(set->bytes[k]);
+    }
+    // flip the bits when looking for bytes NOT in the set
+    unsigned flip = in ? 0 : 0xffffU;
+    size_t j = 0;
+    size_t top = len - 16;
+    size_t skip = 0;
+    while (1) {
+        __m128i v = _mm_loadu_si128((const __m128i*) (ptr + j));
+        unsigned m = (set_block_sse2(v, n, set->count) ^ flip) & (0xffffU << skip);
+        if (m) {
+            return ptr + j + __builtin_ctz(m);
+        }
+        if (j >= top) {
+            break;
+        }
+        j += 16;
+        if (j > top) {
+            skip = j - top;
+            j = top;
+        }
+    }
+    return 0;
+}
+
+static void masks_sse2(const char* ptr, size_t len, const ScanSet* set, uint64_t* masks) {
+    if (set->count > SCAN_SET_MAX_BYTES) {
+        masks_scalar(ptr, len, set, masks);
+        return;
+    }
+    __m128i n[SCAN_SET_MAX_BYTES];
+    for (int k = 0; k < set->count; ++k) {
+        n[k] = _mm_set1_epi8(set->bytes[k]);
+    }
+    size_t j = 0;
+    for (; j < len; j += 64) {
+        // the last block is copied, padded with zeros, and masked
+        const char* p = ptr + j;
+        char tmp[64];
+        size_t left = len - j;
+        if (left < 64) {
+            memset(tmp, 0, sizeof(tmp));
+            memcpy(tmp, p, left);
+            p = tmp;
+        }
+        uint64_t m = 0;
+        for (int k = 0; k < 4; ++k) {
+            __m128i v = _mm_loadu_si128((const __m128i*) (p + 16 * k));
+            m |= (uint64_t) set_block_sse2(v, n, set->count) << (16 * k);
+        }
+        if (left < 64) {
+            m &= (1ULL << left) - 1;
+        }
+        masks[j / 64] = m;
+    }
+}
+
+/*
+ * Case folding uses signed byte comparisons to find the ASCII letters of one
+ * case, and flips bit 0x20 only for them; bytes above 0x7f are negative, and
+ * therefore never look like letters.
+ * A case-insensitive search for a needle compares its first and last bytes
+ * against as many positions as fit in a block, and only checks the whole
+ * needle where both match.  Comparing against a letter is done after setting
+ * bit 0x20 in the data, which turns just its upper case into its lower case.
+ */
+
+// Turn the upper case ASCII letters in a 16-byte block into lower case.
+static inline __m128i lower_sse2(__m128i v) {
+    __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('A' - 1)),
+                                  _mm_cmplt_epi8(v, _mm_set1_epi8('Z' + 1)));
+    return _mm_or_si128(v, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+
+static void fold_sse2(char* ptr, size_t len, int upper) {
+    const __m128i lo = _mm_set1_epi8(upper ? 'a' - 1 : 'A' - 1);
+    const __m128i hi = _mm_set1_epi8(upper ? 'z' + 1 : 'Z' + 1);
+    const __m128i bit = _mm_set1_epi8(0x20);
+    size_t j = 0;
+    for (; j + 16 <= len; j += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*) (ptr + j));
+        __m128i in = _mm_and_si128(_mm_cmpgt_epi8(v, lo), _mm_cmplt_epi8(v, hi));
+        _mm_storeu_si128((__m128i*) (ptr + j), _mm_xor_si128(v, _mm_and_si128(in, bit)));
+    }
+    fold_scalar(ptr + j, len - j, upper);
+}
+
+static size_t prefix_nocase_sse2(const char* l, const char* r, size_t len) {
+    size_t j = 0;
+    for (; j + 16 <= len; j += 16) {
+        __m128i a = lower_sse2(_mm_loadu_si128((const __m128i*) (l + j)));
+        __m128i b = lower_sse2(_mm_loadu_si128((const __m128i*) (r + j)));
+        unsigned m = _mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) ^ 0xffffU;
+        if (m) {
+            return j + __builtin_ctz(m);
+        }
+    }
+    return j + prefix_nocase_scalar(l + j, r + j, len - j);
+}
+
+// Return the bit to set in the data before comparing it against byte c, and
+// the byte to compare against.
+static inline void nocase_target(char c, char* bit, char* target) {
+    char l = ascii_lower(c);
+    *bit = l >= 'a' && l <= 'z' ? 0x20 : 0;
+    *target = l;
+}
+
+static const char* find_nocase_sse2(const char* ptr, size_t len, const char* needle, size_t nlen) {
+    size_t last = nlen - 1;
+    if (len - last < 16) {
+        return find_nocase_scalar(ptr, len, needle, nlen);
+    }
+    char bit = 0;
+    char target = 0;
+    nocase_target(needle[0], &bit, &target);
+    const __m128i first_bit = _mm_set1_epi8(bit);
+    const __m128i first = _mm_set1_epi8(target);
+    nocase_target(needle[last], &bit, &target);
+    const __m128i last_bit = _mm_set1_epi8(bit);
+    const __m128i last_byte = _mm_set1_epi8(target);
+
+    // candidates are positions j where the needle fits
+    size_t j = 0;
+    size_t top = len - last - 16;
+    size_t skip = 0;
+    while (1) {
+        __m128i v0 = _mm_loadu_si128((const __m128i*) (ptr + j));
+        __m128i v1 = _mm_loadu_si128((const __m128i*) (ptr + j + last));
+        __m128i e0 = _mm_cmpeq_epi8(_mm_or_si128(v0, first_bit), first);
+        __m128i e1 = _mm_cmpeq_epi8(_mm_or_si128(v1, last_bit), last_byte);
+        unsigned m = _mm_movemask_epi8(_mm_and_si128(e0, e1)) & (0xffffU << skip);
+        while (m) {
+            size_t k = j + __builtin_ctz(m);
+            if (prefix_nocase_sse2(ptr + k, needle, nlen) == nlen) {
+                return ptr + k;
+            }
+            m &= m - 1;
+        }
+        if (j >= top) {
+            break;
+        }
+        j += 16;
+        if (j > top) {
+            skip = j - top;
+            j = top;
+        }
+    }
+    return 0;
+}
+
+__attribute__((target("avx2")))
+static const char* byte_avx2(const char* ptr, size_t len, char t) {
+    if (len < 32) {
+        return byte_sse2(ptr, len, t);
+    }
+    const __m256i n = _mm256_set1_epi8(t);
+    size_t j = 0;
+    // look at two blocks per iteration, checking them together
+    for (; j + 64 <= len; j += 64) {
+        __m256i e0 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*) (ptr + j)), n);
+        __m256i e1 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*) (ptr + j + 32)), n);
+        if (!_mm256_testz_si256(_mm256_or_si256(e0, e1), _mm256_or_si256(e0, e1))) {
+            unsigned m = _mm256_movemask_epi8(e0);
+            if (m) {
+                return ptr + j + __builtin_ctz(m);
+            }
+            m = _mm256_movemask_epi8(e1);
+            return ptr + j + 32 + __builtin_ctz(m);
+        }
+    }
+    for (; j + 32 <= len; j += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*) (ptr + j));
+        unsigned m = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, n));
+        if (m) {
+            return ptr + j + __builtin_ctz(m);
+        }
+    }
+    if (j < len) {
+        size_t k = len - 32;
+        __m256i v = _mm256_loadu_si256((const __m256i*) (ptr + k));
+        unsigned m = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, n));
+        m &= 0xffffffffU << (j - k);
+        if (m) {
+            return ptr + k + __builtin_ctz(m);
+        }
+    }
+    return 0;
+}
+
+__attribute__((target("avx2")))
+static const char* byte_reverse_avx2(const char* ptr, size_t len, char t) {
+    if (len < 32) {
+        return byte_reverse_sse2(ptr, len, t);
+    }
+    const __m256i n = _mm256_set1_epi8(t);
+    size_t j = len;
+    while (j >= 32) {
+        j -= 32;
+        __m256i v = _mm256_loadu_si256((const __m256i*) (ptr + j));
+        unsigned m = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, n));
+        if (m) {
+            return ptr + j + 31 - __builtin_clz(m);
+        }
+    }
+    if (j > 0) {
+        __m256i v = _mm256_loadu_si256((const __m256i*) ptr);
+        unsigned m = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, n));
+        m &= (1U << j) - 1;
+        if (m) {
+            return ptr + 31 - __builtin_clz(m);
+        }
+    }
+    return 0;
+}
+
+// A ScanSet, ready to be used with AVX2 instructions.
+typedef struct SetAvx2 {
+    __m256i n[SCAN_SET_MAX_BYTES];  // each byte in the set, broadcast
+    __m256i lo;                     // nibble tables, in both lanes
+    __m256i hi;
+    int count;
+    int by_nibbles;
+} SetAvx2;
+
+// Prepare a ScanSet for AVX2; return 0 if it cannot be used with AVX2.
+__attribute__((target("avx2")))
+static inline int set_prepare_avx2(SetAvx2* s, const ScanSet* set) {
+    s->count = set->count;
+    s->by_nibbles = set->nibbles && set->count > SCAN_SET_FEW_BYTES;
+    if (s->by_nibbles) {
+        // shuffles work on each 128-bit lane, so both lanes get the tables
+        s->lo = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*) set->lo));
+        s->hi = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*) set->hi));
+        return 1;
+    }
+    if (set->count > SCAN_SET_MAX_BYTES) {
+        return 0;
+    }
+    for (int k = 0; k < set->count; ++k) {
+        s->n[k] = _mm256_set1_epi8(set->bytes[k]);
+    }
+    return 1;
+}
+
+// Return a mask with the bytes in a 32-byte block that are in the set.
+__attribute__((target("avx2")))
+static inline unsigned set_block_avx2(const SetAvx2* s, __m256i v) {
+    if (s->by_nibbles) {
+        const __m256i low_nibble = _mm256_set1_epi8(0x0f);
+        __m256i l = _mm256_shuffle_epi8(s->lo, _mm256_and_si256(v, low_nibble));
+        __m256i h = _mm256_shuffle_epi8(s->hi, _mm256_and_si256(_mm256_srli_epi16(v, 4), low_nibble));
+        __m256i none = _mm256_cmpeq_epi8(_mm256_and_si256(l, h), _mm256_setzero_si256());
+        return ~(unsigned) _mm256_movemask_epi8(none);
+    }
+    __m256i acc = _mm256_setzero_si256();
+    for (int k = 0; k < s->count; ++k) {
+        acc = _mm256_or_si256(acc, _mm256_cmpeq_epi8(v, s->n[k]));
+    }
+    return _mm256_movemask_epi8(acc);
+}
+
+__attribute__((target("avx2")))
+static const char* set_avx2(const char* ptr, size_t len, const ScanSet* set, int in) {
+    SetAvx2 s;
+    if (!set_prepare_avx2(&s, set)) {
+        return set_scalar(ptr, len, set, in);
+    }
+    if (len < 32) {
+        return set_sse2(ptr, len, set, in);
+    }
+
+    // flip the bits when looking for bytes NOT in the set
+    unsigned flip = in ? 0 : 0xffffffffU;
+    size_t j = 0;
+    size_t top = len - 32;
+    size_t skip = 0;
+    while (1) {
+        __m256i v = _mm256_loadu_si256((const __m256i*) (ptr + j));
+        unsigned m = (set_block_avx2(&s, v) ^ flip) & (0xffffffffU << skip);
+        if (m) {
+            return ptr + j + __builtin_ctz(m);
+        }
+        if (j >= top) {
+            break;
+        }
+        j += 32;
+        if (j > top) {
+            skip = j - top;
+            j = top;
+        }
+    }
+    return 0;
+}
+
+__attribute__((target("avx2")))
+static void masks_avx2(const char* ptr, size_t len, const ScanSet* set, uint64_t* masks) {
+    SetAvx2 s;
+    if (!set_prepare_avx2(&s, set)) {
+        masks_scalar(ptr, len, set, masks);
+        return;
+    }
+    size_t j = 0;
+    for (; j < len; j += 64) {
+        // the last block is copied, padded with zeros, and masked
+        const char* p = ptr + j;
+        char tmp[64];
+        size_t left = len - j;
+        if (left < 64) {
+            memset(tmp, 0, sizeof(tmp));
+            memcpy(tmp, p, left);
+            p = tmp;
+        }
+        __m256i v0 = _mm256_loadu_si256((const __m256i*) p);
+        __m256i v1 = _mm256_loadu_si256((const __m256i*) (p + 32));
+        uint64_t m = set_block_avx2(&s, v0) | ((uint64_t) set_block_avx2(&s, v1) << 32);
+        if (left < 64) {
+            m &= (1ULL << left) - 1;
+        }
+        masks[j / 64] = m;
+    }
+}
+
+// Turn the upper case ASCII letters in a 32-byte block into lower case.
+__attribute__((target("avx2")))
+static inline __m256i lower_avx2(__m256i v) {
+    __m256i upper = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('A' - 1)),
+                                     _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), v));
+    return _mm256_or_si256(v, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+}
+
+__attribute__((target("avx2")))
+static void fold_avx2(char* ptr, size_t len, int upper) {
+    const __m256i lo = _mm256_set1_epi8(upper ? 'a' - 1 : 'A' - 1);
+    const __m256i hi = _mm256_set1_epi8(upper ? 'z' + 1 : 'Z' + 1);
+    const __m256i bit = _mm256_set1_epi8(0x20);
+    size_t j = 0;
+    for (; j + 32 <= len; j += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*) (ptr + j));
+        __m256i in = _mm256_and_si256(_mm256_cmpgt_epi8(v, lo), _mm256_cmpgt_epi8(hi, v));
+        _mm256_storeu_si256((__m256i*) (ptr + j), _mm256_xor_si256(v, _mm256_and_si256(in, bit)));
+    }
+    fold_sse2(ptr + j, len - j, upper);
+}
+
+__attribute__((target("avx2")))
+static size_t prefix_nocase_avx2(const char* l, const char* r, size_t len) {
+    size_t j = 0;
+    for (; j + 32 <= len; j += 32) {
+        __m256i a = lower_avx2(_mm256_loadu_si256((const __m256i*) (l + j)));
+        __m256i b = lower_avx2(_mm256_loadu_si256((const __m256i*) (r + j)));
+        unsigned m = ~(unsigned) _mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b));
+        if (m) {
+            return j + __builtin_ctz(m);
+        }
+    }
+    return j + prefix_nocase_sse2(l + j, r + j, len - j);
+}
+
+__attribute__((target("avx2")))
+static const char* find_nocase_avx2(const char* ptr, size_t len, const char* needle, size_t nlen) {
+    size_t last = nlen - 1;
+    if (len - last < 32) {
+        return find_nocase_sse2(ptr, len, needle, nlen);
+    }
+    char bit = 0;
+    char target = 0;
+    nocase_target(needle[0], &bit, &target);
+    const __m256i first_bit = _mm256_set1_epi8(bit);
+    const __m256i first = _mm256_set1_epi8(target);
+    nocase_target(needle[last], &bit, &target);
+    const __m256i last_bit = _mm256_set1_epi8(bit);
+    const __m256i last_byte = _mm256_set1_epi8(target);
+
+    size_t j = 0;
+    size_t top = len - last - 32;
+    size_t skip = 0;
+    while (1) {
+        __m256i v0 = _mm256_loadu_si256((const __m256i*) (ptr + j));
+        __m256i v1 = _mm256_loadu_si256((const __m256i*) (ptr + j + last));
+        __m256i e0 = _mm256_cmpeq_epi8(_mm256_or_si256(v0, first_bit), first);
+        __m256i e1 = _mm256_cmpeq_epi8(_mm256_or_si256(v1, last_bit), last_byte);
+        unsigned m = (unsigned) _mm256_movemask_epi8(_mm256_and_si256(e0, e1)) & (0xffffffffU << skip);
+        while (m) {
+            size_t k = j + __builtin_ctz(m);
+            if (prefix_nocase_avx2(ptr + k, needle, nlen) == nlen) {
+                return ptr + k;
+            }
+            m &= m - 1;
+        }
+        if (j >= top) {
+            break;
+        }
+        j += 32;
+        if (j > top) {
+            skip = j - top;
+            j = top;
+        }
+    }
+    return 0;
+}
+
+#endif
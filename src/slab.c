@@ -0,0 +1,133 @@
+#include "pizza/memory.h"
+#include "pizza/slab.h"
+
+struct SlabPage {
+    SlabPage* next;                      // next page in the list
+    _Alignas(SLAB_MIN_SIZE) char data[]; // space for objects
+};
+
+// A released object, linked into the free list for its class.
+typedef struct SlabFree {
+    struct SlabFree* next;
+} SlabFree;
+
+static int class_index(size_t len);
+static void* slab_allocator_realloc(void* ctx, void* ptr, size_t len);
+
+void slab_build(Slab* slab) {
+    memset(slab, 0, sizeof(Slab));
+}
+
+void slab_destroy(Slab* slab) {
+    SlabPage* p = slab->pages;
+    while (p) {
+        SlabPage* n = p->next;
+        memory_realloc_system(p, 0);
+        p = n;
+    }
+    memset(slab, 0, sizeof(Slab));
+}
+
+void* slab_alloc(Slab* slab, size_t len) {
+    int idx = class_index(len);
+    if (idx < 0) {
+        return memory_realloc_system(0, len);
+    }
+
+    SlabClass* c = &slab->classes[idx];
+    ++c->live;
+
+    // fast path: reuse a released object
+    SlabFree* f = (SlabFree*) c->free;
+    if (f) {
+        c->free = f->next;
+        return f;
+    }
+
+    // carve a new object, getting a new page if needed
+    size_t size = SLAB_MIN_SIZE << idx;
+    if (!c->next || c->next + size > c->top) {
+        SlabPage* p = (SlabPage*) memory_realloc_system(0, sizeof(SlabPage) + SLAB_PAGE_SIZE);
+        p->next = slab->pages;
+        slab->pages = p;
+        c->next = p->data;
+        c->top = p->data + SLAB_PAGE_SIZE;
+    }
+    void* ptr = c->next;
+    c->next += size;
+    return ptr;
+}
+
+void slab_free(Slab* slab, void* ptr, size_t len) {
+    if (!ptr) {
+        return;
+    }
+
+    int idx = class_index(len);
+    if (idx < 0) {
+        memory_realloc_system(ptr, 0);
+        return;
+    }
+
+    SlabClass* c = &slab->classes[idx];
+    --c->live;
+    SlabFree* f = (SlabFree*) ptr;
+    f->next = (SlabFree*) c->free;
+    c->free = f;
+}
+
+size_t slab_class_size(size_t len) {
+    int idx = class_index(len);
+    return idx < 0 ? 0 : SLAB_MIN_SIZE << idx;
+}
+
+void slab_allocator(Slab* slab, MemoryAllocator* allocator) {
+    allocator->name = "slab";
+    allocator->realloc = slab_allocator_realloc;
+    allocator->ctx = slab;
+}
+
+static void* slab_allocator_realloc(void* ctx, void* ptr, size_t len) {
+    // memory_realloc() does not tell us the old size, so we keep it in a
+    // header right before each block
+    Slab* slab = (Slab*) ctx;
+    size_t olen = 0;
+    char* block = 0;
+    if (ptr) {
+        block = (char*) ptr - SLAB_MIN_SIZE;
+        memcpy(&olen, block, sizeof(size_t));
+    }
+    if (len && ptr && slab_class_size(len + SLAB_MIN_SIZE) == slab_class_size(olen + SLAB_MIN_SIZE)) {
+        // same class -- just remember the new size
+        if (slab_class_size(len + SLAB_MIN_SIZE)) {
+            memcpy(block, &len, sizeof(size_t));
+            return ptr;
+        }
+    }
+
+    char* tmp = 0;
+    if (len) {
+        tmp = (char*) slab_alloc(slab, len + SLAB_MIN_SIZE);
+        memcpy(tmp, &len, sizeof(size_t));
+        tmp += SLAB_MIN_SIZE;
+        if (ptr) {
+            memcpy(tmp, ptr, olen < len ? olen : len);
+        }
+    }
+    if (ptr) {
+        slab_free(slab, block, olen + SLAB_MIN_SIZE);
+    }
+    return tmp;
+}
+
+static int class_index(size_t len) {
+    if (len <= SLAB_MIN_SIZE) {
+        return 0;
+    }
+    if (len > SLAB_MAX_SIZE) {
+        return -1;
+    }
+    // number of bits needed for len - 1 gives the power of two that fits len
+    int bits = (int) (sizeof(unsigned long) * 8) - __builtin_clzl(len - 1);
+    return bits - SLAB_MIN_SHIFT;
+}
@@ -1,12 +1,14 @@
 #include <ctype.h>
 #include <string.h>
+#include "pizza/matcher.h"
+#include "pizza/numparse.h"
 #include "pizza/slice.h"
 
 static Slice slice_null = { .ptr = 0, .len = 0 };
 
 static void lookup_init(SliceLookup* lookup, Slice src, Slice set);
 
-Slice slice_from_memory(const char* ptr, uint32_t len) {
+Slice slice_from_memory(const char* ptr, SliceLen len) {
     Slice s = { .ptr = ptr, .len = len };
     return s;
 }
@@ -19,8 +21,8 @@ Slice slice_from_string(const char* str, int len) {
 }
 
 Slice slice_trim(Slice s) {
-    uint32_t b = 0;
-    uint32_t e = s.len;
+    SliceLen b = 0;
+    SliceLen e = s.len;
     while (b < s.len && isspace(s.ptr[b])) {
         ++b;
     }
@@ -33,7 +35,7 @@ Slice slice_trim(Slice s) {
 int slice_int(Slice s, int* val) {
     int ret = 1;
     *val = 0;
-    for (uint32_t j = 0; j < s.len; ++j) {
+    for (SliceLen j = 0; j < s.len; ++j) {
         if (!isdigit(s.ptr[j])) {
             ret = 0;
             break;
@@ -43,8 +45,20 @@ int slice_int(Slice s, int* val) {
     return ret;
 }
 
+int slice_parse_i64(Slice s, int64_t* val) {
+    return numparse_i64(s.ptr, s.len, val);
+}
+
+int slice_parse_u64(Slice s, uint64_t* val) {
+    return numparse_u64(s.ptr, s.len, val);
+}
+
+int slice_parse_double(Slice s, double* val) {
+    return numparse_double(s.ptr, s.len, val);
+}
+
 int slice_compare(Slice l, Slice r) {
-    for (uint32_t j = 0; 1; ++j) {
+    for (SliceLen j = 0; 1; ++j) {
         if (j >= l.len && j >= r.len) {
             return 0;
         }
@@ -64,15 +78,24 @@ int slice_compare(Slice l, Slice r) {
     return 0;
 }
 
-Slice slice_find_byte(Slice s, char t) {
-    uint32_t j = 0;
-    for (j = 0; j < s.len; ++j) {
-        if (s.ptr[j] == t) {
-            break;
-        }
+int slice_compare_nocase(Slice l, Slice r) {
+    SliceLen len = l.len < r.len ? l.len : r.len;
+    SliceLen j = scan_prefix_nocase(l.ptr, r.ptr, len);
+    if (j < len) {
+        char a = l.ptr[j] >= 'A' && l.ptr[j] <= 'Z' ? l.ptr[j] + ('a' - 'A') : l.ptr[j];
+        char b = r.ptr[j] >= 'A' && r.ptr[j] <= 'Z' ? r.ptr[j] + ('a' - 'A') : r.ptr[j];
+        return a < b ? -1 : +1;
     }
-    if (j < s.len) {
-        return slice_from_memory(s.ptr + j, 1);
+    if (l.len != r.len) {
+        return l.len < r.len ? -1 : +1;
+    }
+    return 0;
+}
+
+Slice slice_find_byte(Slice s, char t) {
+    const char* p = scan_byte(s.ptr, s.len, t);
+    if (p) {
+        return slice_from_memory(p, 1);
     }
     return slice_null;
 }
@@ -88,25 +111,23 @@ Slice slice_find_slice(Slice s, Slice t) {
         return slice_from_memory(p, t.len);
     }
 #else
-    // TODO: implement a good search algorithm here?
-    uint32_t j = 0;
-    uint32_t top = s.len - t.len + 1;
-    for (j = 0; j < top; ++j) {
-        if (memcmp(s.ptr + j, t.ptr, t.len) == 0) {
-            break;
-        }
-    }
-    if (j < top) {
-        return slice_from_memory(s.ptr + j, t.len);
-    }
+    return matcher_find_slice(s, t);
 #endif
 
     return slice_null;
 }
 
+Slice slice_find_slice_nocase(Slice s, Slice t) {
+    const char* p = scan_find_nocase(s.ptr, s.len, t.ptr, t.len);
+    if (p) {
+        return slice_from_memory(p, t.len);
+    }
+    return slice_null;
+}
+
 static bool slice_tokenize(Slice src, Slice s, SliceLookup* lookup) {
     bool first = !lookup->result.ptr;
-    uint32_t start = 0;
+    SliceLen start = 0;
     if (!first) {
         // not the first time we were called -- we already found a previous
         // token, and stopped at a separator.
@@ -124,30 +145,23 @@ static bool slice_tokenize(Slice src, Slice s, SliceLookup* lookup) {
 
     // current position and remaining length
     const char* p = src.ptr + start;
-    uint32_t l = src.len - start;
+    SliceLen l = src.len - start;
 
-    // skip all separators using our map
-    uint32_t j = 0;
-    for (; j < l; ++j) {
-        if (!lookup->map[(int)p[j]]) {
-            break;
-        }
-    }
-    if (j >= l) {
+    // skip all separators using our set
+    const char* b = scan_set_first_not_in(p, l, &lookup->set);
+    if (!b) {
         return false; // no bytes left
     }
 
     // we are looking at a token
-    // find separator after token using our map
-    uint32_t k = j;
-    for (; k < l; ++k) {
-        if (lookup->map[(int)p[k]]) {
-            break;
-        }
+    // find separator after token using our set
+    const char* e = scan_set_first_in(b, p + l - b, &lookup->set);
+    if (!e) {
+        e = p + l;
     }
 
     // produce current result
-    lookup->result = slice_from_memory(p + j, (k < l) ? (k-j) : (l-j));
+    lookup->result = slice_from_memory(b, e - b);
 
     return true; // found next token
 }
@@ -162,12 +176,12 @@ bool slice_tokenize_by_byte(Slice src, char t, SliceLookup* lookup) {
 }
 
 int slice_split_by_byte_l2r(Slice s, char t, Slice* l, Slice* r) {
-    for (int32_t j = 0; j < (int32_t) s.len; ++j) {
-        if (s.ptr[j] == t) {
-            *l = slice_from_memory(s.ptr, j);
-            *r = slice_from_memory(s.ptr + j + 1, s.len - j - 1);
-            return 1;
-        }
+    const char* p = scan_byte(s.ptr, s.len, t);
+    if (p) {
+        SliceLen j = p - s.ptr;
+        *l = slice_from_memory(s.ptr, j);
+        *r = slice_from_memory(s.ptr + j + 1, s.len - j - 1);
+        return 1;
     }
     *l = s;
     *r = slice_from_memory(s.ptr + s.len, 0);
@@ -175,12 +189,12 @@ int slice_split_by_byte_l2r(Slice s, char t, Slice* l, Slice* r) {
 }
 
 int slice_split_by_byte_r2l(Slice s, char t, Slice* l, Slice* r) {
-    for (int32_t j = (int32_t) s.len - 1; j >= 0; --j) {
-        if (s.ptr[j] == t) {
-            *l = slice_from_memory(s.ptr, j);
-            *r = slice_from_memory(s.ptr + j + 1, s.len - j - 1);
-            return 1;
-        }
+    const char* p = scan_byte_reverse(s.ptr, s.len, t);
+    if (p) {
+        SliceLen j = p - s.ptr;
+        *l = slice_from_memory(s.ptr, j);
+        *r = slice_from_memory(s.ptr + j + 1, s.len - j - 1);
+        return 1;
     }
     *l = slice_from_memory(s.ptr, 0);
     *r = s;
@@ -191,9 +205,6 @@ static void lookup_init(SliceLookup* lookup, Slice src, Slice set) {
     // reset result
     lookup->result = slice_from_memory(src.ptr, 0);
 
-    // create a quick map of the bytes / chars we are interested in
-    memset(lookup->map, 0, 256);
-    for (uint32_t j = 0; j < set.len; ++j) {
-        lookup->map[(int)set.ptr[j]] = 1;
-    }
+    // create a quick set of the bytes / chars we are interested in
+    scan_set_build(&lookup->set, set.ptr, set.len);
 }
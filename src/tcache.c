@@ -0,0 +1,172 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include "pizza/slab.h"
+#include "pizza/tcache.h"
+
+// Every block starts with this header; it keeps user data properly aligned.
+#define TCACHE_HEADER_SIZE SLAB_MIN_SIZE
+
+typedef struct TCache TCache;
+
+typedef struct TCacheHeader {
+    TCache* owner;      // cache that owns the block; 0 if it came from system
+    size_t len;         // bytes requested by the user
+} TCacheHeader;
+
+// A block released by another thread, waiting to go back to its owner.
+typedef struct TCacheRemote {
+    TCacheHeader header;
+    struct TCacheRemote* next;
+} TCacheRemote;
+
+struct TCache {
+    Slab slab;                       // where blocks come from
+    _Atomic(TCacheRemote*) remote;   // blocks released by other threads
+    TCache* next;                    // next orphaned cache
+};
+
+static void* tcache_realloc(void* ctx, void* ptr, size_t len);
+static TCache* tcache_get(void);
+static void tcache_orphan(void* arg);
+static void tcache_drain(TCache* tc);
+static void* block_alloc(size_t len);
+static void block_free(TCacheHeader* h);
+
+static const MemoryAllocator allocator = {
+    .name = "tcache",
+    .realloc = tcache_realloc,
+    .ctx = 0,
+};
+
+static _Thread_local TCache* local = 0;
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t key;
+static pthread_mutex_t orphans_lock = PTHREAD_MUTEX_INITIALIZER;
+static TCache* orphans = 0;
+
+const MemoryAllocator* tcache_allocator(void) {
+    return &allocator;
+}
+
+static void* tcache_realloc(void* ctx, void* ptr, size_t len) {
+    (void) ctx;
+    if (!ptr) {
+        return len ? block_alloc(len) : 0;
+    }
+
+    TCacheHeader* h = (TCacheHeader*) ((char*) ptr - TCACHE_HEADER_SIZE);
+    if (!len) {
+        block_free(h);
+        return 0;
+    }
+
+    if (!h->owner) {
+        // large block, let the system deal with it
+        size_t total = len + TCACHE_HEADER_SIZE;
+        if (!slab_class_size(total)) {
+            h = (TCacheHeader*) memory_realloc_system(h, total);
+            h->len = len;
+            return (char*) h + TCACHE_HEADER_SIZE;
+        }
+    } else if (slab_class_size(len + TCACHE_HEADER_SIZE) == slab_class_size(h->len + TCACHE_HEADER_SIZE)) {
+        // still the same size class
+        h->len = len;
+        return ptr;
+    }
+
+    void* tmp = block_alloc(len);
+    memcpy(tmp, ptr, h->len < len ? h->len : len);
+    block_free(h);
+    return tmp;
+}
+
+static void* block_alloc(size_t len) {
+    size_t total = len + TCACHE_HEADER_SIZE;
+    TCacheHeader* h = 0;
+    if (!slab_class_size(total)) {
+        h = (TCacheHeader*) memory_realloc_system(0, total);
+        h->owner = 0;
+    } else {
+        TCache* tc = tcache_get();
+        if (atomic_load_explicit(&tc->remote, memory_order_relaxed)) {
+            tcache_drain(tc);
+        }
+        h = (TCacheHeader*) slab_alloc(&tc->slab, total);
+        h->owner = tc;
+    }
+    h->len = len;
+    return (char*) h + TCACHE_HEADER_SIZE;
+}
+
+static void block_free(TCacheHeader* h) {
+    TCache* owner = h->owner;
+    if (!owner) {
+        memory_realloc_system(h, 0);
+        return;
+    }
+
+    if (owner == local) {
+        slab_free(&owner->slab, h, h->len + TCACHE_HEADER_SIZE);
+        return;
+    }
+
+    // block belongs to another thread -- push it into its remote list
+    TCacheRemote* r = (TCacheRemote*) h;
+    TCacheRemote* head = atomic_load_explicit(&owner->remote, memory_order_relaxed);
+    do {
+        r->next = head;
+    } while (!atomic_compare_exchange_weak_explicit(&owner->remote, &head, r,
+                                                    memory_order_release,
+                                                    memory_order_relaxed));
+}
+
+static void tcache_drain(TCache* tc) {
+    // grab the whole list in one go; nobody else pops from it
+    TCacheRemote* r = atomic_exchange_explicit(&tc->remote, 0, memory_order_acquire);
+    while (r) {
+        TCacheRemote* n = r->next;
+        slab_free(&tc->slab, r, r->header.len + TCACHE_HEADER_SIZE);
+        r = n;
+    }
+}
+
+static void key_create(void) {
+    pthread_key_create(&key, tcache_orphan);
+}
+
+static TCache* tcache_get(void) {
+    if (local) {
+        return local;
+    }
+
+    // first allocation in this thread -- adopt an orphaned cache if possible
+    pthread_once(&key_once, key_create);
+    TCache* tc = 0;
+    pthread_mutex_lock(&orphans_lock);
+    if (orphans) {
+        tc = orphans;
+        orphans = tc->next;
+    }
+    pthread_mutex_unlock(&orphans_lock);
+
+    if (!tc) {
+        tc = (TCache*) memory_realloc_system(0, sizeof(TCache));
+        slab_build(&tc->slab);
+        atomic_init(&tc->remote, 0);
+    }
+    tc->next = 0;
+    local = tc;
+    pthread_setspecific(key, tc);
+    return tc;
+}
+
+static void tcache_orphan(void* arg) {
+    // thread is exiting; its blocks may still be alive, so keep the cache
+    TCache* tc = (TCache*) arg;
+    tcache_drain(tc);
+    pthread_mutex_lock(&orphans_lock);
+    tc->next = orphans;
+    orphans = tc;
+    pthread_mutex_unlock(&orphans_lock);
+    local = 0;
+}
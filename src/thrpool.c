@@ -1,5 +1,4 @@
 #include <pthread.h>
-#include <stdlib.h>
 #include "pizza/memory.h"
 #include "pizza/thrpool.h"
 
@@ -22,6 +21,7 @@ typedef struct ThrPoolTask {
 // The pool data
 struct PoolData {
     pthread_t* threads;        // Array containing worker thread ids
+    int capacity;              // Size of the threads array
     int size;                  // Number of threads
     int started;               // Number of started threads
 };
@@ -64,7 +64,7 @@ ThrPool* thrpool_create(int thread_count, int queue_size) {
         }
 
         size_t pool_bytes = sizeof(ThrPool);
-        tp = (ThrPool*) memory_realloc(0, pool_bytes);
+        tp = (ThrPool*) memory_realloc_tag(0, 0, pool_bytes, MEMORY_TAG_THRPOOL);
         if (!tp) {
             break;
         }
@@ -75,15 +75,16 @@ ThrPool* thrpool_create(int thread_count, int queue_size) {
 
         // Allocate array for threads
         size_t thread_bytes = thread_count * sizeof(pthread_t);
-        tp->pool.threads = (pthread_t*) memory_realloc(0, thread_bytes);
+        tp->pool.threads = (pthread_t*) memory_realloc_tag(0, 0, thread_bytes, MEMORY_TAG_THRPOOL);
         if (!tp->pool.threads) {
             break;
         }
         memset(tp->pool.threads, 0, thread_bytes);
+        tp->pool.capacity = thread_count;
 
         // Allocate array for queue
         size_t queue_bytes = queue_size * sizeof(ThrPoolTask);
-        tp->queue.tasks = (ThrPoolTask*) memory_realloc(0, queue_bytes);
+        tp->queue.tasks = (ThrPoolTask*) memory_realloc_tag(0, 0, queue_bytes, MEMORY_TAG_THRPOOL);
         if (!tp->queue.tasks) {
             break;
         }
@@ -137,18 +138,15 @@ ThrPool* thrpool_create(int thread_count, int queue_size) {
     }
 
     if (tp && tp->queue.tasks) {
-        free((void*) tp->queue.tasks);
-        tp->queue.tasks = 0;
+        tp->queue.tasks = memory_realloc_tag(tp->queue.tasks, tp->queue.size * sizeof(ThrPoolTask), 0, MEMORY_TAG_THRPOOL);
     }
 
     if (tp && tp->pool.threads) {
-        free((void*) tp->pool.threads);
-        tp->pool.threads = 0;
+        tp->pool.threads = memory_realloc_tag(tp->pool.threads, tp->pool.capacity * sizeof(pthread_t), 0, MEMORY_TAG_THRPOOL);
     }
 
     if (tp) {
-        free((void*) tp);
-        tp = 0;
+        tp = memory_realloc_tag(tp, sizeof(ThrPool), 0, MEMORY_TAG_THRPOOL);
     }
 
     return tp;
@@ -302,9 +300,9 @@ static int thrpool_stop(ThrPool* tp, int immediate) {
 static int thrpool_free(ThrPool* tp) {
     pthread_cond_destroy(&tp->notify);
     pthread_mutex_destroy(&tp->lock);
-    free((void*) tp->queue.tasks);
-    free((void*) tp->pool.threads);
-    free((void*) tp);
+    memory_realloc_tag(tp->queue.tasks, tp->queue.size * sizeof(ThrPoolTask), 0, MEMORY_TAG_THRPOOL);
+    memory_realloc_tag(tp->pool.threads, tp->pool.capacity * sizeof(pthread_t), 0, MEMORY_TAG_THRPOOL);
+    memory_realloc_tag(tp, sizeof(ThrPool), 0, MEMORY_TAG_THRPOOL);
     return THRPOOL_STATUS_OK;
 }
 
@@ -0,0 +1,99 @@
+#include "pizza/tokenizer.h"
+
+#define TOKENIZER_BLOCKS            64  // 64-byte blocks classified in one go
+#define TOKENIZER_INITIAL_OFFSETS  128  // initial offsets allocated from Arena
+#define TOKENIZER_GROWTH_FACTOR      2  // how offsets grow in Arena
+
+// Where the offsets go.
+typedef struct Sink {
+    SliceLen* offsets;
+    SliceLen cap;       // room in offsets, as number of values
+    SliceLen cnt;       // number of offsets found so far
+    Arena* arena;       // if not null, grow offsets here
+} Sink;
+
+static void split(const Tokenizer* t, Slice src, Sink* sink);
+static void sink_reserve(Sink* sink, SliceLen n);
+
+void tokenizer_build(Tokenizer* t, Slice sep) {
+    scan_set_build(&t->set, sep.ptr, sep.len);
+}
+
+SliceLen tokenizer_split(const Tokenizer* t, Slice src, SliceLen* offsets, SliceLen cap) {
+    Sink sink = { .offsets = offsets, .cap = 2 * cap, .cnt = 0, .arena = 0 };
+    split(t, src, &sink);
+    return sink.cnt / 2;
+}
+
+SliceLen tokenizer_split_in_arena(const Tokenizer* t, Slice src, Arena* arena, SliceLen** offsets) {
+    Sink sink = { .offsets = 0, .cap = 0, .cnt = 0, .arena = arena };
+    split(t, src, &sink);
+    *offsets = sink.offsets;
+    return sink.cnt / 2;
+}
+
+static void split(const Tokenizer* t, Slice src, Sink* sink) {
+    uint64_t masks[TOKENIZER_BLOCKS];
+    const SliceLen batch = TOKENIZER_BLOCKS * 64;
+
+    // a bit is set for each separator; a token starts or ends wherever a byte
+    // is different from the one before it -- the start of the input counts
+    // as a separator, and so does anything past its end
+    uint64_t prev = 1;
+    for (SliceLen base = 0; base < src.len; base += batch) {
+        SliceLen len = src.len - base < batch ? src.len - base : batch;
+        scan_set_masks(src.ptr + base, len, &t->set, masks);
+        for (SliceLen w = 0; w * 64 < len; ++w) {
+            uint64_t sep = masks[w];
+            SliceLen left = len - w * 64;
+            if (left < 64) {
+                sep |= ~0ULL << left;
+            }
+            uint64_t bounds = sep ^ ((sep << 1) | prev);
+            prev = sep >> 63;
+            if (!bounds) {
+                continue;
+            }
+
+            SliceLen pos = base + w * 64;
+            SliceLen n = __builtin_popcountll(bounds);
+            sink_reserve(sink, n);
+            if (sink->cnt + n <= sink->cap) {
+                SliceLen* out = sink->offsets + sink->cnt;
+                while (bounds) {
+                    *out++ = pos + __builtin_ctzll(bounds);
+                    bounds &= bounds - 1;
+                }
+            } else {
+                // no room for all of them -- store what fits
+                for (SliceLen j = sink->cnt; bounds && j < sink->cap; ++j) {
+                    sink->offsets[j] = pos + __builtin_ctzll(bounds);
+                    bounds &= bounds - 1;
+                }
+            }
+            sink->cnt += n;
+        }
+    }
+    if (sink->cnt % 2) {
+        // input ended in the middle of a token
+        sink_reserve(sink, 1);
+        if (sink->cnt < sink->cap) {
+            sink->offsets[sink->cnt] = src.len;
+        }
+        ++sink->cnt;
+    }
+}
+
+static void sink_reserve(Sink* sink, SliceLen n) {
+    if (!sink->arena || sink->cnt + n <= sink->cap) {
+        return;
+    }
+    SliceLen cap = sink->cap ? sink->cap : TOKENIZER_INITIAL_OFFSETS;
+    while (cap < sink->cnt + n) {
+        cap *= TOKENIZER_GROWTH_FACTOR;
+    }
+    sink->offsets = (SliceLen*) arena_realloc(sink->arena, sink->offsets,
+                                              sink->cap * sizeof(SliceLen),
+                                              cap * sizeof(SliceLen));
+    sink->cap = cap;
+}
@@ -52,45 +52,59 @@ static char* uri_encode_tbl[256] = {
    "%f0","%f1","%f2","%f3","%f4","%f5","%f6","%f7","%f8","%f9","%fa","%fb","%fc","%fd","%fe","%ff",  /* f: 240 ~ 255 */
 };
 
-int uri_decode(Slice encoded, Buffer *decoded) {
-    uint32_t orig = decoded->len;
-    for (uint32_t p = 0; p < encoded.len; ) {
+SliceLen uri_decode(Slice encoded, Buffer *decoded) {
+    // output is never longer than input
+    char* out = buffer_reserve_tail(decoded, encoded.len);
+    SliceLen len = 0;
+    for (SliceLen p = 0; p < encoded.len; ) {
         if (encoded.ptr[p+0] == '%') {
             if ((p+2) < encoded.len &&
                 isxdigit(encoded.ptr[p+1]) &&
                 isxdigit(encoded.ptr[p+2])) {
                 /* put a byte together from the next two hex digits */
-                uint8_t b = MAKE_BYTE(uri_decode_tbl[(int)encoded.ptr[p+1]],
-                        uri_decode_tbl[(int)encoded.ptr[p+2]]);
-                buffer_append_byte(decoded, b);
+                out[len++] = MAKE_BYTE(uri_decode_tbl[(int)encoded.ptr[p+1]],
+                                       uri_decode_tbl[(int)encoded.ptr[p+2]]);
                 /* we used up 3 characters (%XY) from source */
                 p += 3;
             } else {
+                /* invalid encoding -- nothing is added to decoded */
                 return 0;
             }
         } else {
-            buffer_append_byte(decoded, encoded.ptr[p+0]);
+            out[len++] = encoded.ptr[p+0];
             p += 1;
         }
     }
-    return decoded->len - orig;
+    buffer_commit(decoded, len);
+    return len;
 }
 
-int uri_encode(Slice decoded, Buffer *encoded) {
-    uint32_t orig = encoded->len;
-    for (uint32_t p = 0; p < decoded.len; ++p) {
+SliceLen uri_encode(Slice decoded, Buffer *encoded) {
+    // first pass: compute exact size of output
+    SliceLen total = 0;
+    for (SliceLen p = 0; p < decoded.len; ++p) {
+        total += uri_encode_tbl[(unsigned char) decoded.ptr[p]] ? 3 : 1;
+    }
+
+    // second pass: write output directly into buffer
+    char* out = buffer_reserve_tail(encoded, total);
+    SliceLen len = 0;
+    for (SliceLen p = 0; p < decoded.len; ++p) {
         unsigned char b = decoded.ptr[p];
         char* v = uri_encode_tbl[(int)b];
 
         // current source character doesn't need encoding => copy it
         if (!v) {
-            buffer_append_byte(encoded, b);
+            out[len++] = b;
             continue;
         }
 
-        // copy encoded character from our table */
-        buffer_append_string(encoded, v, 3);
+        // copy encoded character from our table
+        out[len++] = v[0];
+        out[len++] = v[1];
+        out[len++] = v[2];
     }
 
-    return encoded->len - orig;
+    buffer_commit(encoded, len);
+    return len;
 }
@@ -51,39 +51,33 @@ uint32_t utf8_decode(Slice* s) {
 }
 
 unsigned int utf8_encode(uint32_t rune, Buffer* b) {
+    // a rune never needs more than 4 bytes
+    uint8_t* out = (uint8_t*) buffer_reserve_tail(b, 4);
+    unsigned int len = 0;
     if (rune <= 0x7f) {
         // length 1, simple ASCII
-        buffer_append_byte(b, (uint8_t) rune);
-        return 1;
-    }
-
-    if (rune <= 0x07ff) {
+        out[len++] = (uint8_t) rune;
+    } else if (rune <= 0x07ff) {
         // length 2
-        buffer_append_byte(b, (uint8_t) (((rune >> 6) & 0x1f) | 0xc0));
-        buffer_append_byte(b, (uint8_t) (((rune >> 0) & 0x3f) | 0x80));
-        return 2;
-    }
-
-    if (rune <= 0xffff) {
+        out[len++] = (uint8_t) (((rune >> 6) & 0x1f) | 0xc0);
+        out[len++] = (uint8_t) (((rune >> 0) & 0x3f) | 0x80);
+    } else if (rune <= 0xffff) {
         // length 3
-        buffer_append_byte(b, (uint8_t) (((rune >> 12) & 0x0f) | 0xe0));
-        buffer_append_byte(b, (uint8_t) (((rune >>  6) & 0x3f) | 0x80));
-        buffer_append_byte(b, (uint8_t) (((rune >>  0) & 0x3f) | 0x80));
-        return 3;
-    }
-
-    if (rune <= 0x10ffff) {
+        out[len++] = (uint8_t) (((rune >> 12) & 0x0f) | 0xe0);
+        out[len++] = (uint8_t) (((rune >>  6) & 0x3f) | 0x80);
+        out[len++] = (uint8_t) (((rune >>  0) & 0x3f) | 0x80);
+    } else if (rune <= 0x10ffff) {
         // length 4 and valid
-        buffer_append_byte(b, (uint8_t) (((rune >> 18) & 0x07) | 0xf0));
-        buffer_append_byte(b, (uint8_t) (((rune >> 12) & 0x3f) | 0x80));
-        buffer_append_byte(b, (uint8_t) (((rune >>  6) & 0x3f) | 0x80));
-        buffer_append_byte(b, (uint8_t) (((rune >>  0) & 0x3f) | 0x80));
-        return 4;
+        out[len++] = (uint8_t) (((rune >> 18) & 0x07) | 0xf0);
+        out[len++] = (uint8_t) (((rune >> 12) & 0x3f) | 0x80);
+        out[len++] = (uint8_t) (((rune >>  6) & 0x3f) | 0x80);
+        out[len++] = (uint8_t) (((rune >>  0) & 0x3f) | 0x80);
+    } else {
+        // invalid -- use replacement character encoded as UTF-8
+        out[len++] = (uint8_t) 0xef;
+        out[len++] = (uint8_t) 0xbf;
+        out[len++] = (uint8_t) 0xbd;
     }
-
-    // invalid -- use replacement character encoded as UTF-8
-    buffer_append_byte(b, (uint8_t) 0xef);
-    buffer_append_byte(b, (uint8_t) 0xbf);
-    buffer_append_byte(b, (uint8_t) 0xbd);
-    return 3;
+    buffer_commit(b, len);
+    return len;
 }
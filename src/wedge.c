@@ -16,7 +16,7 @@ void wedge_build_from_string(Wedge* w, const char* str) {
     build_from_slice(w, s, 1);
 }
 
-void wedge_build_from_ptr_len(Wedge* w, const char* ptr, uint32_t len) {
+void wedge_build_from_ptr_len(Wedge* w, const char* ptr, SliceLen len) {
     // MAYBE null terminated?
     Slice s = slice_from_memory(ptr, len);
     wedge_build_from_slice(w, s);
@@ -0,0 +1,110 @@
+#include <stdint.h>
+#include <string.h>
+#include <tap.h>
+#include "pizza/arena.h"
+#include "pizza/buffer.h"
+
+#define ALEN(a) (int) ((sizeof(a) / sizeof((a)[0])))
+
+static void test_alloc(void) {
+    static size_t sizes[] = { 1, 3, 16, 17, 100, 1000, 5000 };
+    Arena a; arena_build(&a, 4096);
+    for (int j = 0; j < ALEN(sizes); ++j) {
+        size_t len = sizes[j];
+        char* p = arena_alloc(&a, len);
+        ok(p != 0, "arena_alloc(%zu) returns a pointer", len);
+        cmp_ok((uintptr_t) p % ARENA_ALIGNMENT, "==", 0, "arena_alloc(%zu) pointer is aligned", len);
+        memset(p, 'x', len);
+    }
+    cmp_ok(arena_capacity(&a), ">=", 5000, "arena capacity grew to fit large allocation");
+    arena_destroy(&a);
+}
+
+static void test_mark_rewind(void) {
+    Arena a; arena_build(&a, 1024);
+    char* first = arena_alloc(&a, 10);
+    ArenaMark mark = arena_mark(&a);
+    char* p = arena_alloc(&a, 100);
+    for (int j = 0; j < 50; ++j) {
+        arena_alloc(&a, 100);
+    }
+    size_t cap = arena_capacity(&a);
+    arena_rewind(&a, mark);
+    char* q = arena_alloc(&a, 100);
+    ok(q == p, "after rewind, arena reuses the same memory");
+    for (int j = 0; j < 50; ++j) {
+        arena_alloc(&a, 100);
+    }
+    cmp_ok(arena_capacity(&a), "==", cap, "after rewind, arena reuses its chunks");
+
+    arena_reset(&a);
+    char* r = arena_alloc(&a, 10);
+    ok(r == first, "after reset, arena starts again from the beginning");
+    arena_destroy(&a);
+}
+
+static void test_realloc(void) {
+    Arena a; arena_build(&a, 1024);
+    char* p = arena_alloc(&a, 32);
+    memset(p, 'a', 32);
+    char* q = arena_realloc(&a, p, 32, 64);
+    ok(q == p, "arena_realloc grows last allocation in place");
+    char* r = arena_alloc(&a, 32);
+    (void) r;
+    char* s = arena_realloc(&a, q, 64, 128);
+    ok(s != q, "arena_realloc moves an allocation that is not the last one");
+    ok(s[0] == 'a' && s[31] == 'a', "arena_realloc keeps data when moving");
+    arena_destroy(&a);
+}
+
+static void test_buffer(void) {
+    const char* str = "0123456789";
+    int slen = strlen(str);
+    Arena a; arena_build(&a, 0);
+    Buffer b; buffer_build_in_arena(&b, &a);
+    for (int j = 0; j < 100; ++j) {
+        buffer_append_string(&b, str, slen);
+    }
+    cmp_ok(b.len, "==", 100 * slen, "arena buffer has all data");
+    ok(BUFFER_FLAG_CHK(&b, BUFFER_FLAG_PTR_IN_HEAP), "arena buffer moved out of its internal array");
+    int good = 1;
+    for (int j = 0; j < 100; ++j) {
+        if (memcmp(b.ptr + j * slen, str, slen) != 0) {
+            good = 0;
+        }
+    }
+    ok(good, "arena buffer has correct data");
+    cmp_ok(arena_capacity(&a), "==", ARENA_DEFAULT_CHUNK_SIZE, "arena buffer grew in place within a single chunk");
+    buffer_destroy(&b);
+    arena_destroy(&a);
+}
+
+static void test_allocator(void) {
+    Arena a; arena_build(&a, 0);
+    MemoryAllocator allocator;
+    arena_allocator(&a, &allocator);
+    memory_set_allocator(&allocator);
+    Buffer b; buffer_build(&b);
+    for (int j = 0; j < 100; ++j) {
+        buffer_append_string(&b, "0123456789", 10);
+    }
+    cmp_ok(b.len, "==", 1000, "buffer using arena allocator has all data");
+    ok(memcmp(b.ptr + 990, "0123456789", 10) == 0, "buffer using arena allocator has correct data");
+    buffer_destroy(&b);
+    memory_set_allocator(0);
+    cmp_ok(arena_capacity(&a), ">", 0, "memory came from the arena");
+    arena_destroy(&a);
+}
+
+int main (int argc, char* argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_alloc();
+    test_mark_rewind();
+    test_realloc();
+    test_buffer();
+    test_allocator();
+
+    done_testing();
+}
@@ -12,6 +12,8 @@ static void test_base64(void) {
         const char* encoded;
     } data[] = {
         { "binary", "\x01\x02\x03", 0, "AQID" },
+        { "one byte, 2 EQ", "A", 0, "QQ==" },
+        { "two bytes, 1 EQ", "AB", 0, "QUI=" },
         { "tinier", "Hey", 0, "SGV5" },
         { "tiny, 0 EQ", "Amsterdam", 0, "QW1zdGVyZGFt" },
         { "tiny, 2 EQ", "Belgium", 0, "QmVsZ2l1bQ==" },
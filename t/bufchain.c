@@ -0,0 +1,106 @@
+#include <string.h>
+#include <unistd.h>
+#include <tap.h>
+#include "pizza/buffer.h"
+#include "pizza/bufchain.h"
+
+#define ALEN(a) (int) ((sizeof(a) / sizeof((a)[0])))
+
+static void test_append(void) {
+    static const char* pieces[] = { "In a hole ", "in the ground ", "there lived ", "a Hobbit." };
+    const char* expected = "In a hole in the ground there lived a Hobbit.";
+
+    BufferChain c; bufchain_build(&c);
+    for (int j = 0; j < ALEN(pieces); ++j) {
+        bufchain_append_slice(&c, slice_from_string(pieces[j], 0));
+    }
+    int cnt = 0;
+    const struct iovec* iov = bufchain_iovec(&c, &cnt);
+    cmp_ok(cnt, "==", ALEN(pieces), "chain has one segment per piece");
+    ok(iov[0].iov_base == pieces[0], "segments are kept by reference");
+    cmp_ok(c.len, "==", strlen(expected), "chain has correct total length");
+
+    Buffer b; buffer_build(&b);
+    bufchain_flatten(&c, &b);
+    cmp_mem(b.ptr, expected, strlen(expected), "flattened chain has correct contents");
+
+    bufchain_clear(&c);
+    cmp_ok(c.len, "==", 0, "cleared chain is empty");
+    bufchain_append_buffer(&c, &b);
+    bufchain_append_slice(&c, slice_from_string("", 0));
+    iov = bufchain_iovec(&c, &cnt);
+    cmp_ok(cnt, "==", 1, "empty slices do not add segments");
+    ok(iov[0].iov_base == b.ptr, "buffers are kept by reference");
+
+    buffer_destroy(&b);
+    bufchain_destroy(&c);
+}
+
+static void test_contiguous(void) {
+    const char* text = "This was a Hobbit hole, and that means comfort.";
+    BufferChain c; bufchain_build(&c);
+    Slice s = slice_from_string(text, 0);
+    bufchain_append_slice(&c, slice_from_memory(s.ptr, 10));
+    bufchain_append_slice(&c, slice_from_memory(s.ptr + 10, 10));
+    bufchain_append_slice(&c, slice_from_memory(s.ptr + 20, s.len - 20));
+    int cnt = 0;
+    bufchain_iovec(&c, &cnt);
+    cmp_ok(cnt, "==", 1, "contiguous slices are merged into one segment");
+
+    for (int j = 0; j < 100; ++j) {
+        bufchain_append_copy(&c, slice_from_string("x", 0));
+    }
+    bufchain_iovec(&c, &cnt);
+    cmp_ok(cnt, "==", 2, "consecutive copies are merged into one segment");
+    cmp_ok(c.len, "==", s.len + 100, "chain has correct length after copies");
+    bufchain_destroy(&c);
+}
+
+static void test_many(void) {
+    // interleave slices from two strings so that nothing gets merged
+    const char* a = "0123456789";
+    const char* b = "abcdefghij";
+    int count = 1000;
+    BufferChain c; bufchain_build(&c);
+    Buffer e; buffer_build(&e);
+    for (int j = 0; j < count; ++j) {
+        const char* p = (j % 2) ? b : a;
+        Slice s = slice_from_memory(p + j % 10, 1);
+        bufchain_append_slice(&c, s);
+        buffer_append_slice(&e, s);
+    }
+    int cnt = 0;
+    bufchain_iovec(&c, &cnt);
+    cmp_ok(cnt, "==", count, "chain grew to %d segments", count);
+
+    int fds[2];
+    ok(pipe(fds) == 0, "created a pipe");
+    int ret = bufchain_write_fd(&c, fds[1]);
+    cmp_ok(ret, "==", 0, "wrote chain with %d segments to pipe", count);
+    close(fds[1]);
+
+    Buffer r; buffer_build(&r);
+    char tmp[256];
+    ssize_t nread = 0;
+    while ((nread = read(fds[0], tmp, sizeof(tmp))) > 0) {
+        buffer_append_string(&r, tmp, nread);
+    }
+    close(fds[0]);
+    cmp_ok(r.len, "==", e.len, "read back correct number of bytes");
+    cmp_mem(r.ptr, e.ptr, e.len, "read back correct contents");
+
+    buffer_destroy(&r);
+    buffer_destroy(&e);
+    bufchain_destroy(&c);
+}
+
+int main (int argc, char* argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_append();
+    test_contiguous();
+    test_many();
+
+    done_testing();
+}
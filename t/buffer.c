@@ -1,4 +1,8 @@
+#include <errno.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
 #include <tap.h>
 #include "pizza/util.h"
 #include "pizza/buffer.h"
@@ -35,12 +39,17 @@ static void test_format_numbers(void) {
         { 0ULL , 0, 0, 0 },
         { 1ULL , 0, 0, 0 },
         { 11ULL, 0, 0, 0 },
+        { 100ULL, 0, 0, 0 },
+        { 12345ULL, 0, 0, 0 },
+        { 18446744073709551615ULL, 0, 0, 0 },
 
         { 0,   0LL, 0, 1 },
         { 0,   1LL, 0, 1 },
         { 0,  -1LL, 0, 1 },
         { 0,  12LL, 0, 1 },
         { 0, -12LL, 0, 1 },
+        { 0, 9223372036854775807LL, 0, 1 },
+        { 0, -9223372036854775807LL - 1, 0, 1 },
 
         { 0, 0,   0.0, 2 },
         { 0, 0,   1.0, 2 },
@@ -68,11 +77,33 @@ static void test_format_numbers(void) {
                 continue;
         }
 
-        cmp_mem(b.ptr, tmp, b.len, "buffer_format_NUMBER %s => OK", tmp);
+        cmp_ok(b.len, "==", strlen(tmp), "buffer_format_NUMBER %.20s has correct length", tmp);
+        cmp_mem(b.ptr, tmp, b.len, "buffer_format_NUMBER %.20s => OK", tmp);
         buffer_destroy(&b);
     }
 }
 
+static void test_format_double_shortest(void) {
+    static struct {
+        double d;
+        const char* s;
+    } data[] = {
+        { 0.0, "0" },
+        { 3.14, "3.14" },
+        { -0.001, "-0.001" },
+        { 1e100, "1e+100" },
+    };
+    Buffer b; buffer_build(&b);
+    for (int j = 0; j < ALEN(data); ++j) {
+        buffer_clear(&b);
+        buffer_append_string(&b, "x=", 2);
+        buffer_format_double_shortest(&b, data[j].d);
+        cmp_ok(b.len, "==", 2 + strlen(data[j].s), "buffer_format_double_shortest %s has correct length", data[j].s);
+        cmp_mem(b.ptr + 2, data[j].s, b.len - 2, "buffer_format_double_shortest %s => OK", data[j].s);
+    }
+    buffer_destroy(&b);
+}
+
 static void print_and_compare(Buffer* b, char* str, const char* fmt, ...) {
     va_list ap;
     va_list aq;
@@ -159,16 +190,292 @@ static void test_pack(void) {
     }
 }
 
+static void test_mmap(void) {
+    static uint8_t flags[] = { 0, BUFFER_FLAG_HUGE_PAGES };
+    for (int f = 0; f < ALEN(flags); ++f) {
+        Buffer b; buffer_build(&b);
+        BUFFER_FLAG_SET(&b, flags[f]);
+        char chunk[1024];
+        for (int j = 0; j < (int) sizeof(chunk); ++j) {
+            chunk[j] = 'a' + j % 26;
+        }
+        uint32_t total = 2 * BUFFER_MMAP_THRESHOLD + 100;
+        while (b.len < total) {
+            buffer_append_string(&b, chunk, sizeof(chunk));
+            if (b.len == BUFFER_MMAP_THRESHOLD / 2) {
+                ok(!BUFFER_FLAG_CHK(&b, BUFFER_FLAG_PTR_IN_MMAP), "buffer with flags %u and %u bytes is not mapped", flags[f], b.len);
+            }
+        }
+        ok(BUFFER_FLAG_CHK(&b, BUFFER_FLAG_PTR_IN_MMAP), "buffer with flags %u and %u bytes is mapped", flags[f], b.len);
+        cmp_ok((uintptr_t) b.ptr % 64, "==", 0, "mapped buffer with flags %u is aligned", flags[f]);
+        int good = 1;
+        for (uint32_t j = 0; j < b.len; ++j) {
+            if (b.ptr[j] != (char) ('a' + (j % sizeof(chunk)) % 26)) {
+                good = 0;
+                break;
+            }
+        }
+        ok(good, "mapped buffer with flags %u has correct data", flags[f]);
+
+        b.len = 100;
+        buffer_pack(&b);
+        ok(!BUFFER_FLAG_CHK(&b, BUFFER_FLAG_PTR_IN_MMAP), "packed buffer with flags %u is not mapped", flags[f]);
+        cmp_mem(b.ptr, chunk, 100, "packed buffer with flags %u keeps data", flags[f]);
+        buffer_destroy(&b);
+    }
+}
+
+static void test_reserve_commit(void) {
+    Buffer b; buffer_build(&b);
+    buffer_append_string(&b, "abc", 3);
+
+    char* out = buffer_reserve_tail(&b, 1000);
+    ok(out == b.ptr + 3, "reserved tail starts right after current data");
+    cmp_ok(b.cap - b.len, ">=", 1000, "reserved tail has requested room");
+    cmp_ok(b.len, "==", 3, "reserving does not change length");
+    for (int j = 0; j < 600; ++j) {
+        out[j] = 'x';
+    }
+    buffer_commit(&b, 600);
+    cmp_ok(b.len, "==", 603, "commit adds written bytes to length");
+    cmp_mem(b.ptr, "abcxxx", 6, "committed bytes are part of buffer");
+
+    out = buffer_reserve_tail(&b, 0);
+    ok(out == b.ptr + b.len, "reserving zero bytes returns current tail");
+    buffer_destroy(&b);
+}
+
+static void test_consume(void) {
+    Buffer b; buffer_build(&b);
+    buffer_append_string(&b, "hello world", 11);
+    buffer_consume(&b, 6);
+    Slice s = buffer_slice(&b);
+    ok(slice_equal(s, slice_from_string("world", 0)), "consumed bytes are not part of the buffer");
+    cmp_ok(b.pos, "==", 6, "small consumed prefix is not moved");
+
+    buffer_append_string(&b, "!", 1);
+    s = buffer_slice(&b);
+    ok(slice_equal(s, slice_from_string("world!", 0)), "appending after consuming works");
+
+    buffer_consume(&b, 100);
+    cmp_ok(b.len, "==", 0, "consuming everything empties the buffer");
+    cmp_ok(b.pos, "==", 0, "consuming everything resets the cursor");
+    buffer_destroy(&b);
+
+    // simulate a parser reading fixed-size messages from a stream
+    const int msg = 100;
+    const int total = 1000;
+    buffer_build(&b);
+    int good = 1;
+    int next = 0;
+    SliceLen max_cap = 0;
+    for (int j = 0; j < total; ++j) {
+        // receive a message and a half
+        for (int k = 0; k < msg + msg / 2; ++k) {
+            buffer_append_byte(&b, (char) ('a' + (j * (msg + msg / 2) + k) % 26));
+        }
+        // parse all complete messages
+        while (buffer_slice(&b).len >= (SliceLen) msg) {
+            s = buffer_slice(&b);
+            for (int k = 0; k < msg; ++k) {
+                if (s.ptr[k] != (char) ('a' + (next + k) % 26)) {
+                    good = 0;
+                }
+            }
+            next += msg;
+            buffer_consume(&b, msg);
+        }
+        if (b.cap > max_cap) {
+            max_cap = b.cap;
+        }
+    }
+    ok(good, "all streamed messages were parsed correctly");
+    cmp_ok(b.pos, "<", BUFFER_COMPACT_THRESHOLD + 2 * msg, "consumed prefix was compacted");
+    cmp_ok(max_cap, "<=", 4 * BUFFER_COMPACT_THRESHOLD, "buffer reused consumed space instead of growing");
+    buffer_destroy(&b);
+}
+
+static int temp_file(char* name, const Buffer* contents) {
+    strcpy(name, "/tmp/pizza_test_buffer_XXXXXX");
+    int fd = mkstemp(name);
+    if (contents) {
+        buffer_write_fd(contents, fd);
+        lseek(fd, 0, SEEK_SET);
+    }
+    return fd;
+}
+
+static void test_case(void) {
+    Buffer b; buffer_build(&b);
+    buffer_append_string(&b, "skip Hello, World! [\x80\xc1] @`{}", -1);
+    buffer_consume(&b, 5);
+    buffer_to_upper(&b);
+    ok(slice_equal(buffer_slice(&b), slice_from_string("HELLO, WORLD! [\x80\xc1] @`{}", 0)), "buffer converted to upper case");
+    buffer_to_lower(&b);
+    ok(slice_equal(buffer_slice(&b), slice_from_string("hello, world! [\x80\xc1] @`{}", 0)), "buffer converted to lower case");
+    ok(memcmp(b.ptr, "skip ", 5) == 0, "consumed data is not converted");
+    buffer_destroy(&b);
+}
+
+static void test_fd(void) {
+    Buffer data; buffer_build(&data);
+    for (int j = 0; j < 10000; ++j) {
+        buffer_format_print(&data, "line %d of some data\n", j);
+    }
+    char name[64];
+    char copy[64];
+
+    // regular file: the Buffer is sized up front
+    int fd = temp_file(name, &data);
+    Buffer b; buffer_build(&b);
+    buffer_append_string(&b, "X", 1);
+    int ret = buffer_read_fd(&b, fd);
+    cmp_ok(ret, "==", 0, "read regular file into Buffer");
+    cmp_ok(b.len, "==", data.len + 1, "read all %u bytes from regular file", (unsigned) data.len);
+    ok(slice_equal(slice_from_memory(b.ptr + 1, b.len - 1), buffer_slice(&data)), "read correct data from regular file");
+    cmp_ok(b.cap, "<", 2 * (data.len + 2), "Buffer was sized for the file");
+    buffer_destroy(&b);
+
+    // regular file to regular file, with sendfile()
+    lseek(fd, 0, SEEK_SET);
+    int to = temp_file(copy, 0);
+    uint64_t copied = 0;
+    ret = buffer_copy_fd(fd, to, &copied);
+    cmp_ok(ret, "==", 0, "copied regular file to regular file");
+    cmp_ok(copied, "==", data.len, "copied all bytes from regular file to regular file");
+    lseek(to, 0, SEEK_SET);
+    buffer_build(&b);
+    buffer_read_fd(&b, to);
+    ok(slice_equal(buffer_slice(&b), buffer_slice(&data)), "copied correct data from regular file to regular file");
+    buffer_destroy(&b);
+    close(to);
+    unlink(copy);
+
+    // regular file to pipe, with sendfile(), and pipe to regular file, with
+    // splice(); a child process sits in between, so the pipe never fills up
+    int fds[2];
+    ok(pipe(fds) == 0, "created a pipe");
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        lseek(fd, 0, SEEK_SET);
+        _exit(buffer_copy_fd(fd, fds[1], 0) != 0);
+    }
+    close(fds[1]);
+    to = temp_file(copy, 0);
+    copied = 0;
+    ret = buffer_copy_fd(fds[0], to, &copied);
+    cmp_ok(ret, "==", 0, "copied pipe to regular file");
+    cmp_ok(copied, "==", data.len, "copied all bytes through pipe");
+    lseek(to, 0, SEEK_SET);
+    buffer_build(&b);
+    buffer_read_fd(&b, to);
+    ok(slice_equal(buffer_slice(&b), buffer_slice(&data)), "copied correct data through pipe");
+    buffer_destroy(&b);
+    close(fds[0]);
+    waitpid(pid, 0, 0);
+    close(to);
+    unlink(copy);
+    close(fd);
+    unlink(name);
+
+    // pipe to pipe, with splice(); one child writes the data into the first
+    // pipe, and another one checks what comes out of the second
+    int out[2];
+    ok(pipe(fds) == 0 && pipe(out) == 0, "created two pipes");
+    pid_t writer = fork();
+    if (writer == 0) {
+        close(fds[0]);
+        close(out[0]);
+        close(out[1]);
+        _exit(buffer_write_fd(&data, fds[1]) != 0);
+    }
+    pid_t reader = fork();
+    if (reader == 0) {
+        close(fds[0]);
+        close(fds[1]);
+        close(out[1]);
+        buffer_build(&b);
+        int bad = buffer_read_fd(&b, out[0]) != 0 || !slice_equal(buffer_slice(&b), buffer_slice(&data));
+        _exit(bad);
+    }
+    close(fds[1]);
+    close(out[0]);
+    copied = 0;
+    ret = buffer_copy_fd(fds[0], out[1], &copied);
+    cmp_ok(ret, "==", 0, "copied pipe to pipe");
+    cmp_ok(copied, "==", data.len, "copied all bytes from pipe to pipe");
+    close(fds[0]);
+    close(out[1]);
+    int status = -1;
+    waitpid(writer, 0, 0);
+    waitpid(reader, &status, 0);
+    ok(WIFEXITED(status) && WEXITSTATUS(status) == 0, "copied correct data from pipe to pipe");
+
+    // invalid source: nothing is copied, and the error is returned
+    to = temp_file(copy, 0);
+    copied = 1;
+    ret = buffer_copy_fd(-1, to, &copied);
+    cmp_ok(ret, "==", EBADF, "copying from an invalid fd fails with EBADF");
+    cmp_ok(copied, "==", 0, "copying from an invalid fd copies nothing");
+    close(to);
+    unlink(copy);
+
+    // pipe: there is no size, so the Buffer grows as needed
+    ok(pipe(fds) == 0, "created a pipe");
+    pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        _exit(buffer_write_fd(&data, fds[1]) != 0);
+    }
+    close(fds[1]);
+    buffer_build(&b);
+    ret = buffer_read_fd(&b, fds[0]);
+    cmp_ok(ret, "==", 0, "read pipe into Buffer");
+    ok(slice_equal(buffer_slice(&b), buffer_slice(&data)), "read correct data from pipe");
+    buffer_destroy(&b);
+    close(fds[0]);
+    waitpid(pid, 0, 0);
+
+    ret = buffer_read_fd(&data, -1);
+    cmp_ok(ret, "==", EBADF, "reading from an invalid descriptor fails");
+    buffer_destroy(&data);
+}
+
+static void test_overflow(void) {
+    Buffer b; buffer_build(&b);
+    buffer_append_string(&b, "hello", 5);
+
+    // pretend buffer is about to reach the largest possible length
+    SliceLen cap = b.cap;
+    b.cap = SLICE_LEN_MAX;
+    b.len = SLICE_LEN_MAX - 2;
+    dies_ok({ buffer_append_string(&b, "hello", 5); }, "growing buffer past SLICE_LEN_MAX dies");
+
+    b.cap = cap;
+    b.len = 5;
+    buffer_append_string(&b, " world", 6);
+    cmp_mem(b.ptr, "hello world", 11, "buffer still works after overflow check");
+    buffer_destroy(&b);
+}
+
 int main (int argc, char* argv[]) {
     (void) argc;
     (void) argv;
 
     test_sizes();
     test_format_numbers();
+    test_format_double_shortest();
     test_format_print();
     test_stack();
     test_stack_heap();
     test_pack();
+    test_mmap();
+    test_reserve_commit();
+    test_consume();
+    test_case();
+    test_fd();
+    test_overflow();
 
     done_testing();
 }
@@ -0,0 +1,213 @@
+#include <stdatomic.h>
+#include <string.h>
+#include <tap.h>
+#include "pizza/arena.h"
+#include "pizza/buffer.h"
+#include "pizza/bufpool.h"
+#include "pizza/thrpool.h"
+
+#define NUM_THREADS 4
+
+typedef struct ThreadResults {
+    _Atomic int bad;
+    _Atomic uint64_t hits;
+} ThreadResults;
+
+static int class_of(size_t size) {
+    return __builtin_ctzl(size) - BUFPOOL_MIN_SHIFT;
+}
+
+static void grow_buffer(int len) {
+    Buffer b; buffer_build(&b);
+    for (int j = 0; j < len; ++j) {
+        buffer_append_byte(&b, 'x');
+    }
+    buffer_destroy(&b);
+}
+
+static void test_classes(void) {
+    ok(bufpool_get(100) == 0, "size that is not a power of two is not pooled");
+    ok(bufpool_get(BUFPOOL_MIN_SIZE / 2) == 0, "size below smallest class is not pooled");
+    ok(bufpool_get(BUFPOOL_MAX_SIZE * 2) == 0, "size above largest class is not pooled");
+    cmp_ok(bufpool_get_limit(BUFPOOL_MIN_SIZE), ">", 1, "smallest class keeps several blocks");
+    cmp_ok(bufpool_get_limit(BUFPOOL_MAX_SIZE), "==", 1, "largest class keeps one block");
+    cmp_ok(bufpool_get_limit(100), "==", 0, "invalid class has no limit");
+}
+
+static void test_recycle(void) {
+    bufpool_flush();
+    BufPoolStats before;
+    bufpool_stats(&before);
+
+    grow_buffer(1000);
+    BufPoolStats after;
+    bufpool_stats(&after);
+    cmp_ok(after.puts - before.puts, "==", 1, "destroyed buffer gave its block to the pool");
+    cmp_ok(after.cached[class_of(1024)], "==", 1, "block was kept in its class");
+
+    before = after;
+    grow_buffer(1000);
+    bufpool_stats(&after);
+    cmp_ok(after.hits - before.hits, ">=", 1, "second buffer reused a block from the pool");
+
+    // every reused block gives back the smaller one it replaced, so after a
+    // few rounds all classes up to 1024 bytes are filled
+    for (int j = 0; j < 10; ++j) {
+        grow_buffer(1000);
+    }
+    bufpool_stats(&before);
+    grow_buffer(1000);
+    bufpool_stats(&after);
+    cmp_ok(after.misses - before.misses, "==", 0, "third buffer found all its blocks in the pool");
+
+    bufpool_flush();
+    bufpool_stats(&after);
+    int cached = 0;
+    for (int j = 0; j < BUFPOOL_NUM_CLASSES; ++j) {
+        cached += after.cached[j];
+    }
+    cmp_ok(cached, "==", 0, "flushed pool holds no blocks");
+}
+
+static void test_data(void) {
+    bufpool_flush();
+    grow_buffer(5000);
+
+    // a buffer built from recycled blocks must still have the right data
+    Buffer b; buffer_build(&b);
+    int good = 1;
+    for (int j = 0; j < 5000; ++j) {
+        buffer_append_byte(&b, (char) ('a' + j % 26));
+    }
+    for (int j = 0; j < 5000; ++j) {
+        if (b.ptr[j] != (char) ('a' + j % 26)) {
+            good = 0;
+            break;
+        }
+    }
+    ok(good, "buffer grown with recycled blocks has correct data");
+    buffer_destroy(&b);
+    bufpool_flush();
+}
+
+static void test_limit(void) {
+    size_t size = 4096;
+    uint32_t old = bufpool_get_limit(size);
+    bufpool_flush();
+
+    bufpool_set_limit(size, 0);
+    cmp_ok(bufpool_get_limit(size), "==", 0, "limit can be set to zero");
+    BufPoolStats before;
+    BufPoolStats after;
+    bufpool_stats(&before);
+    grow_buffer(3000);
+    bufpool_stats(&after);
+    cmp_ok(after.drops - before.drops, "==", 1, "block is dropped when class is disabled");
+    cmp_ok(after.cached[class_of(size)], "==", 0, "disabled class holds no blocks");
+
+    bufpool_set_limit(size, 2);
+    Buffer bufs[3];
+    for (int j = 0; j < 3; ++j) {
+        buffer_build(&bufs[j]);
+        buffer_ensure_total(&bufs[j], size);
+    }
+    for (int j = 0; j < 3; ++j) {
+        buffer_destroy(&bufs[j]);
+    }
+    bufpool_stats(&after);
+    cmp_ok(after.cached[class_of(size)], "==", 2, "class holds at most its limit of blocks");
+
+    bufpool_set_limit(size, old);
+    bufpool_flush();
+}
+
+static void test_allocator(void) {
+    bufpool_flush();
+    grow_buffer(1000);
+    BufPoolStats before;
+    bufpool_stats(&before);
+    cmp_ok(before.cached[class_of(1024)], "==", 1, "pool holds a system block");
+
+    Arena a; arena_build(&a, 0);
+    MemoryAllocator allocator;
+    arena_allocator(&a, &allocator);
+    memory_set_allocator(&allocator);
+    BufPoolStats after;
+    bufpool_stats(&after);
+    cmp_ok(after.cached[class_of(1024)], "==", 0, "switching allocator flushed the pool");
+
+    grow_buffer(1000);
+    bufpool_stats(&after);
+    cmp_ok(after.puts, "==", before.puts, "blocks from another allocator are not pooled");
+    cmp_ok(after.hits, "==", before.hits, "pool is not used with another allocator");
+    memory_set_allocator(0);
+    arena_destroy(&a);
+
+    // with arena blocks in the pool, this would use freed memory
+    Buffer b; buffer_build(&b);
+    for (int j = 0; j < 1000; ++j) {
+        buffer_append_byte(&b, 'y');
+    }
+    ok(b.len == 1000 && b.ptr[999] == 'y', "buffer after arena is gone has correct data");
+    buffer_destroy(&b);
+    bufpool_stats(&after);
+    cmp_ok(after.puts - before.puts, ">=", 1, "pool is used again with system allocator");
+    bufpool_flush();
+}
+
+static void thread_grow(void* arg) {
+    ThreadResults* results = (ThreadResults*) arg;
+    BufPoolStats before;
+    bufpool_stats(&before);
+    for (int j = 0; j < 100; ++j) {
+        Buffer b; buffer_build(&b);
+        char c = (char) ('a' + j % 26);
+        for (int k = 0; k < 2000; ++k) {
+            buffer_append_byte(&b, c);
+        }
+        for (int k = 0; k < 2000; ++k) {
+            if (b.ptr[k] != c) {
+                atomic_fetch_add(&results->bad, 1);
+                break;
+            }
+        }
+        buffer_destroy(&b);
+    }
+    BufPoolStats after;
+    bufpool_stats(&after);
+    atomic_fetch_add(&results->hits, after.hits - before.hits);
+}
+
+static void test_threads(void) {
+    bufpool_flush();
+    BufPoolStats before;
+    bufpool_stats(&before);
+
+    ThreadResults results = { .bad = 0, .hits = 0 };
+    ThrPool* pool = thrpool_create(NUM_THREADS, 64);
+    for (int j = 0; j < NUM_THREADS * 4; ++j) {
+        thrpool_add(pool, thread_grow, &results);
+    }
+    thrpool_destroy(pool, 0);
+
+    BufPoolStats after;
+    bufpool_stats(&after);
+    cmp_ok(atomic_load(&results.bad), "==", 0, "threads grew buffers with correct data");
+    cmp_ok(atomic_load(&results.hits), ">", 0, "threads reused blocks from their pools");
+    cmp_ok(after.hits, "==", before.hits, "threads did not take blocks from main pool");
+    cmp_ok(after.misses, "==", before.misses, "threads did not ask main pool for blocks");
+}
+
+int main (int argc, char* argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_classes();
+    test_recycle();
+    test_data();
+    test_limit();
+    test_allocator();
+    test_threads();
+
+    done_testing();
+}
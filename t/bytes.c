@@ -0,0 +1,141 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <tap.h>
+#include "pizza/buffer.h"
+#include "pizza/bytes.h"
+#include "pizza/thrpool.h"
+
+#define NUM_THREADS 4
+#define NUM_TASKS  64
+
+static void test_freeze(void) {
+    static int sizes[] = { 5, 1000, 100000 };
+    for (int s = 0; s < (int) (sizeof(sizes) / sizeof(sizes[0])); ++s) {
+        int size = sizes[s];
+        Buffer b; buffer_build(&b);
+        for (int j = 0; j < size; ++j) {
+            buffer_append_byte(&b, (char) ('a' + j % 26));
+        }
+        const char* heap = b.ptr != b.buf ? b.ptr : 0;
+
+        Bytes* bytes = bytes_freeze(&b);
+        cmp_ok(b.len, "==", 0, "frozen buffer of %d bytes is left empty", size);
+        ok(b.ptr == b.buf, "frozen buffer of %d bytes uses its own space again", size);
+
+        Slice s0 = bytes_slice(bytes);
+        cmp_ok(s0.len, "==", size, "bytes frozen from %d bytes has correct length", size);
+        if (heap) {
+            ok(s0.ptr == heap, "bytes frozen from %d bytes took over data without copying", size);
+        }
+        int good = 1;
+        for (int j = 0; j < size; ++j) {
+            if (s0.ptr[j] != (char) ('a' + j % 26)) {
+                good = 0;
+                break;
+            }
+        }
+        ok(good, "bytes frozen from %d bytes has correct data", size);
+
+        // reusing the buffer does not affect the frozen data
+        buffer_append_string(&b, "zzzzz", 5);
+        ok(s0.ptr[0] == 'a', "bytes frozen from %d bytes not affected by reusing buffer", size);
+
+        buffer_destroy(&b);
+        bytes_release(bytes);
+    }
+}
+
+static void test_views(void) {
+    Bytes* bytes = bytes_from_slice(slice_from_string("In a hole in the ground", 0));
+    Slice v = bytes_view(bytes, 5, 4);
+    ok(slice_equal(v, slice_from_string("hole", 0)), "view in the middle");
+    v = bytes_view(bytes, 17, 100);
+    ok(slice_equal(v, slice_from_string("ground", 0)), "view past the end is clamped");
+    v = bytes_view(bytes, 100, 5);
+    cmp_ok(v.len, "==", 0, "view starting past the end is empty");
+
+    cmp_ok(bytes_refs(bytes), "==", 1, "new bytes has one reference");
+    Bytes* other = bytes_retain(bytes);
+    ok(other == bytes, "retain returns the same bytes");
+    cmp_ok(bytes_refs(bytes), "==", 2, "retained bytes has two references");
+    bytes_release(other);
+    cmp_ok(bytes_refs(bytes), "==", 1, "released bytes has one reference again");
+    bytes_release(bytes);
+}
+
+typedef struct Work {
+    Bytes* bytes;
+    _Atomic int* good;
+} Work;
+
+static void check_in_worker(void* arg) {
+    Work* work = (Work*) arg;
+    Slice s = bytes_slice(work->bytes);
+    int good = s.len == 26;
+    for (int j = 0; good && j < 26; ++j) {
+        good = s.ptr[j] == (char) ('a' + j);
+    }
+    if (good) {
+        atomic_fetch_add(work->good, 1);
+    }
+    bytes_release(work->bytes);
+}
+
+static void test_threads(void) {
+    Buffer b; buffer_build(&b);
+    for (int j = 0; j < 26; ++j) {
+        buffer_append_byte(&b, (char) ('a' + j));
+    }
+    Bytes* bytes = bytes_freeze(&b);
+    buffer_destroy(&b);
+
+    _Atomic int good = 0;
+    Work work[NUM_TASKS];
+    ThrPool* pool = thrpool_create(NUM_THREADS, NUM_TASKS);
+    for (int j = 0; j < NUM_TASKS; ++j) {
+        work[j].bytes = bytes_retain(bytes);
+        work[j].good = &good;
+        thrpool_add(pool, check_in_worker, &work[j]);
+    }
+    bytes_release(bytes);
+    thrpool_destroy(pool, 0);
+    cmp_ok(atomic_load(&good), "==", NUM_TASKS, "all %d workers saw the shared data", NUM_TASKS);
+}
+
+static void* release_in_thread(void* arg) {
+    bytes_release((Bytes*) arg);
+    return 0;
+}
+
+static void test_arena(void) {
+    Arena arena; arena_build(&arena, 0);
+    Buffer b; buffer_build_in_arena(&b, &arena);
+    for (int j = 0; j < 1000; ++j) {
+        buffer_append_byte(&b, (char) ('a' + j % 26));
+    }
+    const char* data = b.ptr;
+    Bytes* bytes = bytes_freeze(&b);
+    buffer_destroy(&b);
+    ok(bytes_slice(bytes).ptr == data, "bytes frozen from arena buffer took over data without copying");
+
+    // the last reference goes away in another thread, without touching the arena
+    pthread_t thread;
+    pthread_create(&thread, 0, release_in_thread, bytes);
+    pthread_join(thread, 0);
+    ok(data[0] == 'a' && data[999] == 'a' + 999 % 26, "arena data is still there after releasing bytes in another thread");
+
+    arena_destroy(&arena);
+}
+
+int main (int argc, char* argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_freeze();
+    test_views();
+    test_threads();
+    test_arena();
+
+    done_testing();
+}
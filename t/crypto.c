@@ -70,11 +70,40 @@ static void test_crypto(void) {
     buffer_destroy(&b);
 }
 
+static void test_secure(void) {
+    Slice p = slice_from_string("my beautiful passphrase", 0);
+    uint8_t iv[] = { 0xde, 0xad, 0xbe, 0xef, 0xab, 0xad, 0xca, 0xfe };
+    Slice i = slice_from_memory((const char*) iv, 8);
+
+    Crypto* crypto = memory_secure_alloc(sizeof(Crypto), MEMORY_SECURE_LOCK);
+    ok(crypto != 0, "Could allocate Crypto in secure memory");
+    crypto_init(crypto, p, i);
+
+    char text[] = "some secret";
+    uint8_t buf[32];
+    uint32_t len = sizeof(text);
+    memcpy(buf, text, len);
+    len = crypto_encrypt_cbc(crypto, buf, len);
+    len = crypto_decrypt_cbc(crypto, buf, len);
+    ok(len == sizeof(text) && memcmp(buf, text, len) == 0, "Could roundtrip data with Crypto in secure memory");
+
+    crypto_destroy(crypto);
+    int wiped = 1;
+    for (uint32_t j = 0; j < sizeof(Crypto); ++j) {
+        if (((uint8_t*) crypto)[j]) {
+            wiped = 0;
+        }
+    }
+    ok(wiped, "crypto_destroy wipes all key material");
+    memory_secure_free(crypto, sizeof(Crypto), MEMORY_SECURE_LOCK);
+}
+
 int main (int argc, char* argv[]) {
     (void) argc;
     (void) argv;
 
     test_crypto();
+    test_secure();
 
     done_testing();
 }
@@ -0,0 +1,132 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tap.h>
+#include "pizza/dtoa.h"
+
+#define ALEN(a) (int) ((sizeof(a) / sizeof((a)[0])))
+
+static void test_known(void) {
+    static struct {
+        double d;
+        const char* s;
+    } data[] = {
+        { 0.0, "0" },
+        { -0.0, "-0" },
+        { 1.0, "1" },
+        { -1.0, "-1" },
+        { 3.14, "3.14" },
+        { -3.14, "-3.14" },
+        { 0.1, "0.1" },
+        { 0.3, "0.3" },
+        { 0.1 + 0.2, "0.30000000000000004" },
+        { 100.0, "100" },
+        { 123456789012.0, "123456789012" },
+        { 0.001234, "0.001234" },
+        { 0.000001, "0.000001" },
+        { 1e-7, "1e-7" },
+        { 1.5e-7, "1.5e-7" },
+        { 1e20, "100000000000000000000" },
+        { 1e21, "1e+21" },
+        { 1.7976931348623157e308, "1.7976931348623157e+308" },
+        { 5e-324, "5e-324" },
+        { 2.2250738585072014e-308, "2.2250738585072014e-308" },
+        { 9007199254740993.0, "9007199254740992" },
+    };
+    for (int j = 0; j < ALEN(data); ++j) {
+        char out[DTOA_MAX_LEN];
+        int len = dtoa_shortest(data[j].d, out);
+        cmp_ok(len, "==", (int) strlen(data[j].s), "dtoa_shortest(%s) has correct length", data[j].s);
+        cmp_mem(out, data[j].s, len, "dtoa_shortest(%s) has correct digits", data[j].s);
+    }
+}
+
+static void test_special(void) {
+    char out[DTOA_MAX_LEN];
+    int len = dtoa_shortest(NAN, out);
+    cmp_mem(out, "nan", len, "dtoa_shortest(NAN) => nan");
+    len = dtoa_shortest(INFINITY, out);
+    cmp_mem(out, "inf", len, "dtoa_shortest(INFINITY) => inf");
+    len = dtoa_shortest(-INFINITY, out);
+    cmp_mem(out, "-inf", len, "dtoa_shortest(-INFINITY) => -inf");
+}
+
+// Number of significant digits in a representation, ignoring leading and
+// trailing zeros and any exponent.
+static int significant_digits(const char* s, int len) {
+    int first = -1;
+    int last = -1;
+    for (int k = 0; k < len && s[k] != 'e'; ++k) {
+        if (s[k] >= '1' && s[k] <= '9') {
+            if (first < 0) {
+                first = k;
+            }
+            last = k;
+        }
+    }
+    if (first < 0) {
+        return 0;
+    }
+    int digits = 0;
+    for (int k = first; k <= last; ++k) {
+        digits += s[k] >= '0' && s[k] <= '9';
+    }
+    return digits;
+}
+
+// Number of digits in the shortest %.Ng representation that reads back as d.
+static int shortest_printf(double d) {
+    char tmp[64];
+    for (int p = 1; p <= 17; ++p) {
+        int len = sprintf(tmp, "%.*g", p, d);
+        if (strtod(tmp, 0) == d) {
+            return significant_digits(tmp, len);
+        }
+    }
+    return 17;
+}
+
+static void test_roundtrip(void) {
+    int count = 100000;
+    int bad = 0;
+    int longer = 0;
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    for (int j = 0; j < count; ++j) {
+        // xorshift64 to get random bit patterns, covering all exponents
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        double d = 0;
+        memcpy(&d, &state, sizeof(d));
+        if (isnan(d) || isinf(d)) {
+            continue;
+        }
+
+        char out[DTOA_MAX_LEN + 1];
+        int len = dtoa_shortest(d, out);
+        out[len] = '\0';
+        if (strtod(out, 0) != d) {
+            ++bad;
+            continue;
+        }
+
+        // check we did not produce more digits than needed
+        if (significant_digits(out, len) > shortest_printf(d)) {
+            ++longer;
+        }
+    }
+    cmp_ok(bad, "==", 0, "all %d random doubles read back as the same value", count);
+    cmp_ok(longer, "<", count / 100, "almost all of %d random doubles are shortest (%d are not)", count, longer);
+}
+
+int main (int argc, char* argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_known();
+    test_special();
+    test_roundtrip();
+
+    done_testing();
+}
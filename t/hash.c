@@ -1,10 +1,14 @@
 #include <stdint.h>
 #include <string.h>
 #include <tap.h>
+#include "pizza/scan.h"
+#include "pizza/bufchain.h"
 #include "pizza/hash.h"
 
 #define ALEN(a) (int) ((sizeof(a) / sizeof((a)[0])))
 
+#define XXH3_DATA_LEN 4096
+
 static void test_djb2(void) {
     struct {
         const char* str;
@@ -55,6 +59,123 @@ static void test_pcg(void) {
     ok(1, "DON'T HAVE ANY DATA TO COMPARE WITH FOR hash_pcg()");
 }
 
+// Data for XXH3 tests; same as the Python code
+//   bytes(((j*131 + (j>>7)*17 + 5) & 0xff) for j in range(4096))
+// used to get the expected values from the reference implementation.
+static const char* xxh3_data(void) {
+    static char data[XXH3_DATA_LEN];
+    for (int j = 0; j < XXH3_DATA_LEN; ++j) {
+        data[j] = (char) ((j * 131 + (j >> 7) * 17 + 5) & 0xff);
+    }
+    return data;
+}
+
+static void test_xxh3(int level) {
+    static struct {
+        uint32_t len;
+        uint64_t seed;
+        uint64_t hash64;
+        Hash128 hash128;
+    } values[] = {
+        {    0, 0x0000000000000000ULL, 0x2d06800538d394c2ULL, { 0x6001c324468d497fULL, 0x99aa06d3014798d8ULL } },
+        {    1, 0x0000000000000000ULL, 0x929e358d27ae3ee2ULL, { 0x929e358d27ae3ee2ULL, 0xe1325e21416bcdb2ULL } },
+        {    3, 0x0000000000000000ULL, 0x30069c90b99182f2ULL, { 0x30069c90b99182f2ULL, 0x6314f62690261693ULL } },
+        {    4, 0x0000000000000000ULL, 0xd829f6f5a95030ddULL, { 0xbee8c76c7e70385dULL, 0x1c0809605e05a2b1ULL } },
+        {    8, 0x0000000000000000ULL, 0x69a0b1f9db1af9caULL, { 0x9dab33761e888bdcULL, 0xf638c7d0289261a5ULL } },
+        {    9, 0x0000000000000000ULL, 0xa15196770bf453d4ULL, { 0x80315196bcceb453ULL, 0xbe5e2367d8076a4eULL } },
+        {   16, 0x0000000000000000ULL, 0x98ea59f608d94941ULL, { 0x75750de25ef8b2ceULL, 0xb7c9f9df6d6bd8b0ULL } },
+        {   17, 0x0000000000000000ULL, 0xa08e9bdf66b32953ULL, { 0x1210b42b2844b708ULL, 0xd633e30463db164aULL } },
+        {  128, 0x0000000000000000ULL, 0x99c2e662da058357ULL, { 0x684810c47dfc23b1ULL, 0x1f89463d95789d07ULL } },
+        {  129, 0x0000000000000000ULL, 0x1cd4628f0cf1168eULL, { 0xba5f106439e0fb24ULL, 0xb1aadb80efa83001ULL } },
+        {  240, 0x0000000000000000ULL, 0x5a632d6838b0282dULL, { 0x3f41115d0f8a9129ULL, 0x23edfc615d9c1405ULL } },
+        {  241, 0x0000000000000000ULL, 0x26dc8f598a4b4699ULL, { 0x26dc8f598a4b4699ULL, 0x269a82b10a1ec113ULL } },
+        { 1024, 0x0000000000000000ULL, 0xd0449ffb55831268ULL, { 0xd0449ffb55831268ULL, 0x569f4bcd3e03f3d8ULL } },
+        { 1025, 0x0000000000000000ULL, 0x7c86b9ce06886635ULL, { 0x7c86b9ce06886635ULL, 0xee73d05012272a2cULL } },
+        { 4000, 0x0000000000000000ULL, 0xc573a0c095a9cc6bULL, { 0xc573a0c095a9cc6bULL, 0x1ff0a78bc4c4409dULL } },
+        {    0, 0x9e3779b97f4a7c15ULL, 0x602b0e2cd6662c8bULL, { 0x4ca5176998171787ULL, 0xd142977a2cca554bULL } },
+        {    1, 0x9e3779b97f4a7c15ULL, 0x968c4cd158c76e3cULL, { 0x968c4cd158c76e3cULL, 0xa65f8646615de7bcULL } },
+        {    3, 0x9e3779b97f4a7c15ULL, 0x956ff9a665f8862aULL, { 0x956ff9a665f8862aULL, 0x5d09896fa3396e24ULL } },
+        {    4, 0x9e3779b97f4a7c15ULL, 0x7ef5ef8db190d4ecULL, { 0x8f9d90ea1684db3cULL, 0x9a2fac89def95b2aULL } },
+        {    8, 0x9e3779b97f4a7c15ULL, 0xefd25e96682eddeeULL, { 0xfd49f9ff306de620ULL, 0xd1aebbf32707be1aULL } },
+        {    9, 0x9e3779b97f4a7c15ULL, 0x7bfac1f602372fa9ULL, { 0x3549d8138f6cb1efULL, 0xa6a9ca8ffb87c5a8ULL } },
+        {   16, 0x9e3779b97f4a7c15ULL, 0xba739f6992a7284fULL, { 0x0c9aecfcbd4819d2ULL, 0x5a532ffbf3c1b880ULL } },
+        {   17, 0x9e3779b97f4a7c15ULL, 0x123d8085a18dec32ULL, { 0xcda96862ac92e845ULL, 0x823f31d092f094daULL } },
+        {  128, 0x9e3779b97f4a7c15ULL, 0x1c749c176736b73fULL, { 0xba2c454381ad0f2eULL, 0xaf27550901297fedULL } },
+        {  129, 0x9e3779b97f4a7c15ULL, 0x94159c436b591f77ULL, { 0xc50cb30028098bf1ULL, 0x84c456fd55fa4164ULL } },
+        {  240, 0x9e3779b97f4a7c15ULL, 0x7b73a790bcc8e025ULL, { 0xad05b0645c04c08eULL, 0xcb4547af68fe19f7ULL } },
+        {  241, 0x9e3779b97f4a7c15ULL, 0x9816f33d4ea31617ULL, { 0x9816f33d4ea31617ULL, 0x274d34939e5b5d07ULL } },
+        { 1024, 0x9e3779b97f4a7c15ULL, 0x53643dfd66221461ULL, { 0x53643dfd66221461ULL, 0x068dd88b8bb640a7ULL } },
+        { 1025, 0x9e3779b97f4a7c15ULL, 0x19c777b7f625d7c5ULL, { 0x19c777b7f625d7c5ULL, 0x7366cbf60e6cfca9ULL } },
+        { 4000, 0x9e3779b97f4a7c15ULL, 0x7eca1b757685d714ULL, { 0x7eca1b757685d714ULL, 0xe3f81a40596e9e59ULL } },
+    };
+
+    const char* data = xxh3_data();
+    for (int j = 0; j < ALEN(values); ++j) {
+        uint32_t len = values[j].len;
+        uint64_t seed = values[j].seed;
+        uint64_t got = hash_xxh3_64(data, len, seed);
+        ok(got == values[j].hash64,
+           "level %d: xxh3 64-bit hash for %u bytes with seed 0x%llx is 0x%llx, looks good",
+           level, len, (unsigned long long) seed, (unsigned long long) got);
+        Hash128 wide = hash_xxh3_128(data, len, seed);
+        ok(wide.lo == values[j].hash128.lo && wide.hi == values[j].hash128.hi,
+           "level %d: xxh3 128-bit hash for %u bytes with seed 0x%llx is 0x%016llx%016llx, looks good",
+           level, len, (unsigned long long) seed, (unsigned long long) wide.hi, (unsigned long long) wide.lo);
+    }
+
+    const char* str = "Hello, world!";
+    ok(hash_xxh3_64(str, strlen(str), 0) == 0xf3c34bf11915e869ULL,
+       "level %d: xxh3 64-bit hash for [%s] looks good", level, str);
+}
+
+static void test_xxh3_stream(int level) {
+    static const uint32_t lengths[] = { 0, 5, 200, 240, 241, 256, 257, 1024, 1025, 3000, XXH3_DATA_LEN };
+    static const uint32_t chunks[] = { 1, 7, 64, 100, 255, 256, 1000 };
+    const char* data = xxh3_data();
+    uint64_t seed = 1234;
+    for (int j = 0; j < ALEN(lengths); ++j) {
+        uint32_t len = lengths[j];
+        uint64_t expected64 = hash_xxh3_64(data, len, seed);
+        Hash128 expected128 = hash_xxh3_128(data, len, seed);
+        int bad = 0;
+        for (int k = 0; k < ALEN(chunks); ++k) {
+            HashXXH3 h; hash_xxh3_reset(&h, seed);
+            for (uint32_t pos = 0; pos < len; pos += chunks[k]) {
+                uint32_t size = len - pos < chunks[k] ? len - pos : chunks[k];
+                hash_xxh3_update(&h, data + pos, size);
+                hash_xxh3_update(&h, data, 0);
+            }
+            Hash128 got = hash_xxh3_final128(&h);
+            bad += hash_xxh3_final64(&h) != expected64;
+            bad += got.lo != expected128.lo || got.hi != expected128.hi;
+        }
+        cmp_ok(bad, "==", 0, "level %d: xxh3 hashes for %u bytes in pieces are the same as in one go", level, len);
+    }
+}
+
+static void test_xxh3_bufchain(void) {
+    const char* data = xxh3_data();
+    BufferChain c; bufchain_build(&c);
+    for (int j = 0; j < 20; ++j) {
+        bufchain_append_slice(&c, slice_from_memory(data + j * 150, 50 + j * 5));
+    }
+    Buffer b; buffer_build(&b);
+    bufchain_flatten(&c, &b);
+
+    // hash the segments one by one, without putting them together
+    HashXXH3 h; hash_xxh3_reset(&h, 0);
+    int cnt = 0;
+    const struct iovec* seg = bufchain_iovec(&c, &cnt);
+    for (int j = 0; j < cnt; ++j) {
+        hash_xxh3_update(&h, seg[j].iov_base, seg[j].iov_len);
+    }
+    ok(hash_xxh3_final64(&h) == hash_xxh3_64(b.ptr, b.len, 0),
+       "xxh3 hash for a BufferChain is the same as for its flattened data");
+
+    buffer_destroy(&b);
+    bufchain_destroy(&c);
+}
+
 int main (int argc, char* argv[]) {
     (void) argc;
     (void) argv;
@@ -64,5 +185,14 @@ int main (int argc, char* argv[]) {
     test_wang();
     test_pcg();
 
+    int best = scan_get_level();
+    for (int level = SCAN_LEVEL_SCALAR; level <= best; ++level) {
+        scan_set_level(level);
+        test_xxh3(level);
+        test_xxh3_stream(level);
+    }
+    scan_set_level(-1);
+    test_xxh3_bufchain();
+
     done_testing();
 }
@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <string.h>
+#include <tap.h>
+#include "pizza/hashmap.h"
+
+#define ALEN(a) (int) ((sizeof(a) / sizeof((a)[0])))
+
+#define KEY_RANGE 5000
+#define OPERATIONS 200000
+
+typedef struct Value {
+    uint64_t key;
+    uint32_t count;
+} Value;
+
+static void test_int(Arena* arena) {
+    // random inserts and erases, checked against a plain array of keys
+    static char present[KEY_RANGE];
+    memset(present, 0, sizeof(present));
+    HashMap m;
+    if (arena) {
+        hashmap_build_in_arena(&m, HASHMAP_KEY_INT, sizeof(Value), arena);
+    } else {
+        hashmap_build(&m, HASHMAP_KEY_INT, sizeof(Value));
+    }
+    const char* label = arena ? "arena" : "heap";
+
+    int bad = 0;
+    size_t size = 0;
+    unsigned seed = 3;
+    for (int j = 0; j < OPERATIONS; ++j) {
+        seed = seed * 1103515245U + 12345U;
+        // spread the keys over the whole 64 bits
+        uint64_t k = (seed >> 8) % KEY_RANGE;
+        uint64_t key = k * 0x9e3779b97f4a7c15ULL;
+        // erase less often as the table goes on, so that it grows and shrinks
+        int erasing = (seed >> 4) % 16 < (j < OPERATIONS / 2 ? 6 : 10);
+        if (erasing) {
+            bad += hashmap_erase_int(&m, key) != present[k];
+            size -= present[k];
+            present[k] = 0;
+        } else {
+            int added = 0;
+            Value* v = hashmap_insert_int(&m, key, &added);
+            bad += added == present[k];
+            if (added) {
+                v->key = key;
+            }
+            ++v->count;
+            size += !present[k];
+            present[k] = 1;
+        }
+        bad += m.size != size;
+    }
+    cmp_ok(bad, "==", 0, "%s: %d random inserts / erases are correct", label, OPERATIONS);
+
+    bad = 0;
+    for (uint64_t k = 0; k < KEY_RANGE; ++k) {
+        uint64_t key = k * 0x9e3779b97f4a7c15ULL;
+        Value* v = hashmap_find_int(&m, key);
+        bad += !v != !present[k];
+        bad += v && (v->key != key || !v->count);
+    }
+    cmp_ok(bad, "==", 0, "%s: all keys are found, or not", label);
+
+    // iterate, erasing half the keys along the way
+    size_t seen = 0;
+    bad = 0;
+    for (size_t j = hashmap_scan(&m, 0); j < m.buckets; j = hashmap_scan(&m, j + 1)) {
+        uint64_t key = hashmap_key_int(&m, j);
+        Value* v = hashmap_value(&m, j);
+        bad += v->key != key;
+        if (seen++ % 2) {
+            hashmap_erase_int(&m, key);
+        }
+    }
+    cmp_ok(bad, "==", 0, "%s: iteration gives keys with their values", label);
+    cmp_ok(seen, "==", size, "%s: iteration sees all %u keys", label, (unsigned) size);
+    cmp_ok(m.size, "==", size - size / 2, "%s: keys can be erased while iterating", label);
+
+    hashmap_rehash(&m, 0);
+    ok(m.buckets < KEY_RANGE, "%s: rehash shrinks the table", label);
+    seen = 0;
+    for (size_t j = hashmap_scan(&m, 0); j < m.buckets; j = hashmap_scan(&m, j + 1)) {
+        seen += hashmap_find_int(&m, hashmap_key_int(&m, j)) == hashmap_value(&m, j);
+    }
+    cmp_ok(seen, "==", m.size, "%s: all keys are found after rehashing", label);
+
+    hashmap_clear(&m);
+    cmp_ok(m.size, "==", 0, "%s: cleared table is empty", label);
+    cmp_ok(hashmap_scan(&m, 0), "==", m.buckets, "%s: cleared table has nothing to iterate", label);
+    hashmap_destroy(&m);
+}
+
+static void test_slice(void) {
+    static const char* words[] = {
+        "", "a", "b", "ab", "ba", "host", "Host", "content-length", "content-type",
+        "a somewhat longer key that needs more than one block for the hash",
+    };
+    HashMap m; hashmap_build(&m, HASHMAP_KEY_SLICE, sizeof(int));
+    for (int j = 0; j < ALEN(words); ++j) {
+        int added = 0;
+        int* v = hashmap_insert_slice(&m, slice_from_string(words[j], 0), &added);
+        cmp_ok(added, "==", 1, "[%s] is added", words[j]);
+        *v = j;
+    }
+    for (int j = 0; j < ALEN(words); ++j) {
+        // a copy, so that only the bytes are the same
+        char copy[100];
+        strcpy(copy, words[j]);
+        int added = 1;
+        int* v = hashmap_insert_slice(&m, slice_from_string(copy, 0), &added);
+        cmp_ok(added, "==", 0, "[%s] is already there", words[j]);
+        v = hashmap_find_slice(&m, slice_from_string(copy, 0));
+        ok(v && *v == j, "[%s] is found with its value", words[j]);
+    }
+    ok(!hashmap_find_slice(&m, slice_from_string("hos", 0)), "a prefix is not found");
+    ok(hashmap_erase_slice(&m, slice_from_string("host", 0)), "a key is erased");
+    ok(!hashmap_erase_slice(&m, slice_from_string("host", 0)), "an erased key is not erased again");
+    ok(!hashmap_find_slice(&m, slice_from_string("host", 0)), "an erased key is not found");
+    ok(hashmap_find_slice(&m, slice_from_string("Host", 0)) != 0, "other keys are still found");
+    cmp_ok(m.size, "==", ALEN(words) - 1, "table has the right size");
+    hashmap_destroy(&m);
+}
+
+static void test_reserve(void) {
+    HashMap m; hashmap_build(&m, HASHMAP_KEY_SLICE, 0);
+    ok(!hashmap_find_slice(&m, slice_from_string("x", 0)), "nothing is found in an empty table");
+    ok(!hashmap_erase_slice(&m, slice_from_string("x", 0)), "nothing is erased from an empty table");
+
+    // slices for all the numbers, kept in a single array
+    static char keys[10000 * 8];
+    hashmap_reserve(&m, 10000);
+    const int8_t* ctrl = m.ctrl;
+    for (int j = 0; j < 10000; ++j) {
+        int len = sprintf(keys + 8 * j, "%d", j);
+        hashmap_insert_slice(&m, slice_from_memory(keys + 8 * j, len), 0);
+    }
+    ok(m.ctrl == ctrl, "reserved table does not rehash");
+    cmp_ok(m.size, "==", 10000, "reserved table has all keys");
+    hashmap_destroy(&m);
+}
+
+int main (int argc, char* argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_int(0);
+    Arena arena; arena_build(&arena, 0);
+    test_int(&arena);
+    arena_destroy(&arena);
+    test_slice();
+    test_reserve();
+
+    done_testing();
+}
@@ -0,0 +1,126 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <tap.h>
+#include "pizza/hash.h"
+#include "pizza/intern.h"
+
+#define ALEN(a) (int) ((sizeof(a) / sizeof((a)[0])))
+
+#define MANY_ATOMS 100000
+#define THREADS 4
+#define THREAD_ATOMS 20000
+
+static void test_basic(void) {
+    static const char* words[] = { "host", "path", "", "Host", "content-length", "hos" };
+    Interner in; intern_build(&in);
+    Atom atoms[ALEN(words)];
+    for (int j = 0; j < ALEN(words); ++j) {
+        Slice s = slice_from_string(words[j], 0);
+        cmp_ok(intern_find(&in, s), "==", ATOM_NONE, "[%s] is not there before adding it", words[j]);
+        atoms[j] = intern_add(&in, s);
+        cmp_ok(atoms[j], "!=", ATOM_NONE, "[%s] gets an atom", words[j]);
+    }
+    cmp_ok(intern_count(&in), "==", ALEN(words), "there are %d atoms", ALEN(words));
+
+    for (int j = 0; j < ALEN(words); ++j) {
+        // a copy, so that the Slice points somewhere else
+        char copy[32];
+        strcpy(copy, words[j]);
+        Slice s = slice_from_string(copy, 0);
+        cmp_ok(intern_add(&in, s), "==", atoms[j], "[%s] gets the same atom when added again", words[j]);
+        cmp_ok(intern_find(&in, s), "==", atoms[j], "[%s] gets the same atom when found", words[j]);
+
+        Slice a = intern_slice(&in, atoms[j]);
+        ok(slice_equal(a, s), "[%s] has the same bytes", words[j]);
+        ok(a.ptr != copy && a.ptr[a.len] == '\0', "[%s] bytes are a null-terminated copy", words[j]);
+        cmp_ok(intern_hash(&in, atoms[j]), "==", hash_murmur3(copy, strlen(copy), INTERN_HASH_SEED), "[%s] has the right hash", words[j]);
+    }
+    cmp_ok(intern_count(&in), "==", ALEN(words), "there are still %d atoms", ALEN(words));
+
+    Slice none = intern_slice(&in, ATOM_NONE);
+    ok(none.ptr == 0 && none.len == 0, "ATOM_NONE has a null slice");
+    cmp_ok(intern_hash(&in, ATOM_NONE), "==", 0, "ATOM_NONE has a zero hash");
+    intern_destroy(&in);
+}
+
+static void test_many(void) {
+    // enough atoms to need several segments and to grow the table many times
+    Interner in; intern_build(&in);
+    char str[32];
+    int bad = 0;
+    for (int j = 0; j < MANY_ATOMS; ++j) {
+        int len = sprintf(str, "key-%d", j);
+        Atom atom = intern_add(&in, slice_from_string(str, len));
+        bad += atom != (Atom) j + 1;
+    }
+    cmp_ok(bad, "==", 0, "%d atoms get consecutive ids", MANY_ATOMS);
+    cmp_ok(intern_count(&in), "==", MANY_ATOMS, "there are %d atoms", MANY_ATOMS);
+
+    bad = 0;
+    for (int j = 0; j < MANY_ATOMS; ++j) {
+        int len = sprintf(str, "key-%d", j);
+        Slice s = slice_from_string(str, len);
+        Atom atom = intern_find(&in, s);
+        bad += atom != (Atom) j + 1;
+        bad += !slice_equal(intern_slice(&in, atom), s);
+    }
+    cmp_ok(bad, "==", 0, "%d atoms are found with their bytes", MANY_ATOMS);
+    intern_destroy(&in);
+}
+
+typedef struct Worker {
+    Interner* in;
+    int id;
+    Atom atoms[THREAD_ATOMS];
+} Worker;
+
+static void* work(void* arg) {
+    // every thread adds the same keys, in a different order
+    Worker* w = (Worker*) arg;
+    char str[32];
+    for (int j = 0; j < THREAD_ATOMS; ++j) {
+        int k = (j * 7919 + w->id * 104729) % THREAD_ATOMS;
+        int len = sprintf(str, "worker-key-%d", k);
+        w->atoms[k] = intern_add(w->in, slice_from_string(str, len));
+    }
+    return 0;
+}
+
+static void test_threads(void) {
+    static Worker workers[THREADS];
+    pthread_t threads[THREADS];
+    Interner in; intern_build(&in);
+    for (int t = 0; t < THREADS; ++t) {
+        workers[t].in = &in;
+        workers[t].id = t;
+        pthread_create(&threads[t], 0, work, &workers[t]);
+    }
+    for (int t = 0; t < THREADS; ++t) {
+        pthread_join(threads[t], 0);
+    }
+    cmp_ok(intern_count(&in), "==", THREAD_ATOMS, "%d threads added %d distinct atoms", THREADS, THREAD_ATOMS);
+
+    int bad = 0;
+    char str[32];
+    for (int j = 0; j < THREAD_ATOMS; ++j) {
+        for (int t = 1; t < THREADS; ++t) {
+            bad += workers[t].atoms[j] != workers[0].atoms[j];
+        }
+        int len = sprintf(str, "worker-key-%d", j);
+        bad += !slice_equal(intern_slice(&in, workers[0].atoms[j]), slice_from_string(str, len));
+    }
+    cmp_ok(bad, "==", 0, "all threads got the same atoms for the same keys");
+    intern_destroy(&in);
+}
+
+int main (int argc, char* argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_basic();
+    test_many();
+    test_threads();
+
+    done_testing();
+}
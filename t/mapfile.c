@@ -0,0 +1,84 @@
+#include <errno.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <tap.h>
+#include "pizza/mapfile.h"
+
+static void make_path(Path* p, const char* name) {
+    char tmp[512];
+    sprintf(tmp, "/tmp/pizza_test_mapfile_%s_%d", name, getpid());
+    path_from_string(p, tmp, 0);
+}
+
+static void test_map(void) {
+    Path p; make_path(&p, "data");
+    Buffer data; buffer_build(&data);
+    for (int j = 0; j < 20000; ++j) {
+        buffer_format_print(&data, "%d bottles of beer on the wall\n", j);
+    }
+    int ret = path_spew(&p, buffer_slice(&data));
+    cmp_ok(ret, "==", 0, "created file [%s]", p.name.ptr);
+
+    MappedFile m;
+    ret = mapfile_build(&m, &p);
+    cmp_ok(ret, "==", 0, "mapped file [%s]", p.name.ptr);
+    Slice s = mapfile_slice(&m);
+    cmp_ok(s.len, "==", data.len, "mapped file has correct size");
+    ok(slice_equal(s, buffer_slice(&data)), "mapped file has correct contents");
+
+    static const unsigned flags[] = {
+        MAPFILE_ADVISE_SEQUENTIAL,
+        MAPFILE_ADVISE_RANDOM,
+        MAPFILE_ADVISE_WILLNEED,
+        MAPFILE_ADVISE_HUGEPAGE,
+        MAPFILE_ADVISE_SEQUENTIAL | MAPFILE_ADVISE_WILLNEED | MAPFILE_ADVISE_HUGEPAGE,
+    };
+    for (unsigned j = 0; j < sizeof(flags) / sizeof(flags[0]); ++j) {
+        ret = mapfile_advise(&m, flags[j]);
+        cmp_ok(ret, "==", 0, "advised mapped file with flags 0x%x", flags[j]);
+    }
+    ok(slice_equal(mapfile_slice(&m), buffer_slice(&data)), "mapped file has correct contents after advising");
+
+    // the mapping survives the file being removed
+    path_unlink(&p);
+    ok(slice_equal(mapfile_slice(&m), buffer_slice(&data)), "mapped file has correct contents after being removed");
+
+    mapfile_destroy(&m);
+    ok(m.ptr == 0 && m.len == 0, "destroyed mapped file");
+
+    buffer_destroy(&data);
+    path_destroy(&p);
+}
+
+static void test_special(void) {
+    MappedFile m;
+
+    Path p; make_path(&p, "empty");
+    path_touch(&p);
+    int ret = mapfile_build(&m, &p);
+    cmp_ok(ret, "==", 0, "mapped empty file");
+    cmp_ok(mapfile_slice(&m).len, "==", 0, "empty file gives an empty Slice");
+    cmp_ok(mapfile_advise(&m, MAPFILE_ADVISE_WILLNEED), "==", 0, "advised empty file");
+    mapfile_destroy(&m);
+    path_unlink(&p);
+
+    ret = mapfile_build(&m, &p);
+    cmp_ok(ret, "==", ENOENT, "cannot map missing file");
+    ok(m.ptr == 0, "failed map leaves no mapping");
+    path_destroy(&p);
+
+    path_from_string(&p, "/tmp", 0);
+    ret = mapfile_build(&m, &p);
+    cmp_ok(ret, "==", EINVAL, "cannot map a directory");
+    path_destroy(&p);
+}
+
+int main (int argc, char* argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_map();
+    test_special();
+
+    done_testing();
+}
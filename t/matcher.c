@@ -0,0 +1,206 @@
+#include <stdlib.h>
+#include <string.h>
+#include <tap.h>
+#include "pizza/scan.h"
+#include "pizza/matcher.h"
+
+#define ALEN(a) (int) ((sizeof(a) / sizeof((a)[0])))
+
+#define MAX_MATCHES 8192
+
+static const char* level_name[] = { "scalar", "SSE2", "AVX2" };
+
+static int cmp_match(const void* l, const void* r) {
+    const SliceMatch* ml = (const SliceMatch*) l;
+    const SliceMatch* mr = (const SliceMatch*) r;
+    if (ml->pos != mr->pos) {
+        return ml->pos < mr->pos ? -1 : 1;
+    }
+    if (ml->pattern != mr->pattern) {
+        return ml->pattern < mr->pattern ? -1 : 1;
+    }
+    return 0;
+}
+
+// Find all matches comparing every pattern at every position, in order.
+static SliceLen naive_find_all(const Slice* patterns, int count, Slice text, SliceMatch* matches) {
+    SliceLen n = 0;
+    for (SliceLen pos = 0; pos < text.len; ++pos) {
+        for (int j = 0; j < count; ++j) {
+            Slice p = patterns[j];
+            if (p.len && p.len <= text.len - pos && memcmp(text.ptr + pos, p.ptr, p.len) == 0) {
+                matches[n].pos = pos;
+                matches[n].pattern = j;
+                ++n;
+            }
+        }
+    }
+    return n;
+}
+
+// Return the number of differences between the matches found by a
+// SliceMatcher and the naive ones.
+static int check_matches(const Slice* patterns, int count, Slice text) {
+    static SliceMatch got[MAX_MATCHES];
+    static SliceMatch exp[MAX_MATCHES];
+    SliceMatcher m; matcher_build(&m, patterns, count);
+    SliceLen ng = matcher_find_all(&m, text, got, MAX_MATCHES);
+    SliceLen ne = naive_find_all(patterns, count, text, exp);
+    matcher_destroy(&m);
+    if (ng != ne) {
+        return 1;
+    }
+    qsort(got, ng, sizeof(SliceMatch), cmp_match);
+    return memcmp(got, exp, ng * sizeof(SliceMatch)) != 0;
+}
+
+// Fill data with a pseudo-random mix of the bytes in alphabet.
+static void fill(char* data, size_t len, const char* alphabet, size_t alen, unsigned* seed) {
+    for (size_t j = 0; j < len; ++j) {
+        *seed = *seed * 1103515245U + 12345U;
+        data[j] = alphabet[(*seed >> 16) % alen];
+    }
+}
+
+static void test_single(void) {
+    static const char* needles[] = {
+        "a", "ab", "aaa", "abab", "aabaa", "abcabcab", "baaaab", "abaabaaabaab",
+        "bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbba", "\xff\x80", "zzz",
+    };
+    static const char alphabet[] = "aab\xff\x80";
+    char text[1000];
+    unsigned seed = 7;
+    fill(text, sizeof(text), alphabet, sizeof(alphabet) - 1, &seed);
+    memcpy(text + 900, needles[8], strlen(needles[8]));
+
+    int bad = 0;
+    for (int j = 0; j < ALEN(needles); ++j) {
+        Slice n = slice_from_string(needles[j], 0);
+        for (SliceLen len = 0; len <= sizeof(text); len += 37) {
+            Slice t = slice_from_memory(text, len);
+            bad += check_matches(&n, 1, t);
+
+            Slice f = matcher_find_slice(t, n);
+            const char* p = len >= n.len ? memmem(t.ptr, t.len, n.ptr, n.len) : 0;
+            bad += f.ptr != p;
+        }
+    }
+    cmp_ok(bad, "==", 0, "single patterns are found as with a naive search");
+
+    Slice f = matcher_find_slice(slice_from_string("foo", 0), slice_from_string("", 0));
+    ok(f.ptr && f.len == 0, "empty slice is found at the start");
+}
+
+static void test_sets(int level) {
+    static struct {
+        const char* label;
+        const char* alphabet;
+        const char* patterns[40];
+    } data[] = {
+        { "no patterns", "abc", { 0 } },
+        { "empty patterns", "abc", { "", "", 0 } },
+        { "one and empty", "abc", { "", "ab", "", 0 } },
+        { "two", "abc", { "ab", "ca", 0 } },
+        { "overlapping", "ab", { "a", "aa", "aaa", "ba", "aba", 0 } },
+        { "duplicated", "ab", { "ab", "b", "ab", "b", 0 } },
+        { "suffixes", "abcd", { "abcd", "bcd", "cd", "d", "dab", 0 } },
+        { "high bytes", "a\x80\xff", { "\xff\x80", "\x80\x80", "a\xff", 0 } },
+        { "same nibbles", "!1AQaq", { "!1A", "QA", "aq1", "q!", "1!", "AAA", "Qa", "qq", "!!!", 0 } },
+        { "keywords", "abcdefgh ",
+          { "abc", "bad", "cafe", "dead", "beef", "face", "fade", "bead", "deaf", "babe",
+            "cab", "dab", "ace", "bee", "add", "egg", "hag", "had", "head", "edge",
+            "a b", "b a", "fee", "gab", "dig", "big", "bag", "beg", "hid", "chef", 0 } },
+        { "many", "abcdefgh",
+          { "a", "bc", "def", "gh", "hg", "fed", "cb", "ab", "ba", "cd", "dc", "ef", "fe",
+            "gha", "hga", "abcd", "dcba", "efgh", "hgfe", "aa", "bb", "cc", "dd", "ee", "ff",
+            "gg", "hh", "abc", "bcd", "cde", "def", "efg", "fgh", "ghab", "habc", 0 } },
+    };
+    char text[2000];
+    int bad = 0;
+    for (int k = 0; k < ALEN(data); ++k) {
+        Slice patterns[40];
+        int count = 0;
+        while (data[k].patterns[count]) {
+            patterns[count] = slice_from_string(data[k].patterns[count], 0);
+            ++count;
+        }
+        unsigned seed = 17 + k;
+        fill(text, sizeof(text), data[k].alphabet, strlen(data[k].alphabet), &seed);
+        bad = 0;
+        for (SliceLen len = 0; len <= sizeof(text); len += len < 100 ? 1 : 97) {
+            bad += check_matches(patterns, count, slice_from_memory(text, len));
+        }
+        cmp_ok(bad, "==", 0, "%s: %s are found as with a naive search", level_name[level], data[k].label);
+    }
+}
+
+static int stop_visit(uint32_t pattern, SliceLen pos, void* arg) {
+    (void) pattern;
+    (void) pos;
+    int* seen = (int*) arg;
+    return ++*seen == 3;
+}
+
+static void test_stop(void) {
+    Slice patterns[] = { slice_from_string("x", 0), slice_from_string("yy", 0) };
+    Slice text = slice_from_string("x x yy x yy x", 0);
+    for (int count = 1; count <= 2; ++count) {
+        SliceMatcher m; matcher_build(&m, patterns, count);
+        int seen = 0;
+        SliceLen found = matcher_search(&m, text, stop_visit, &seen);
+        cmp_ok(found, "==", 3, "with %d patterns, search stops when asked to", count);
+
+        SliceMatch matches[2];
+        found = matcher_find_all(&m, text, matches, 2);
+        cmp_ok(found, "==", count == 1 ? 4 : 6, "with %d patterns, all matches are counted with a small array", count);
+        matcher_destroy(&m);
+    }
+}
+
+static void test_log(void) {
+    // patterns must be found at their positions in a few log lines, also
+    // after the original patterns are gone
+    static const char* words[] = { "ERROR", "WARN", "timeout", "refused", "disk" };
+    static const char* lines =
+        "2024-01-01 INFO started\n"
+        "2024-01-01 WARN disk almost full\n"
+        "2024-01-01 ERROR connection refused: timeout\n";
+    char copy[ALEN(words)][16];
+    Slice patterns[ALEN(words)];
+    for (int j = 0; j < ALEN(words); ++j) {
+        strcpy(copy[j], words[j]);
+        patterns[j] = slice_from_string(copy[j], 0);
+    }
+    SliceMatcher m; matcher_build(&m, patterns, ALEN(words));
+    memset(copy, 0, sizeof(copy));
+
+    Slice text = slice_from_string(lines, 0);
+    SliceMatch matches[10];
+    SliceLen found = matcher_find_all(&m, text, matches, ALEN(matches));
+    cmp_ok(found, "==", 5, "all keywords are found in log lines");
+    int bad = 0;
+    for (SliceLen j = 0; j < found; ++j) {
+        const char* w = words[matches[j].pattern];
+        bad += strncmp(lines + matches[j].pos, w, strlen(w)) != 0;
+    }
+    cmp_ok(bad, "==", 0, "keywords are found at their positions");
+    matcher_destroy(&m);
+}
+
+int main (int argc, char* argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_single();
+    test_stop();
+    test_log();
+
+    int best = scan_get_level();
+    for (int level = SCAN_LEVEL_SCALAR; level <= best; ++level) {
+        scan_set_level(level);
+        test_sets(level);
+    }
+    scan_set_level(-1);
+
+    done_testing();
+}
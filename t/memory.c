@@ -0,0 +1,156 @@
+#include <string.h>
+#include <tap.h>
+#include "pizza/memory.h"
+#include "pizza/buffer.h"
+#include "pizza/bufpool.h"
+#include "pizza/path.h"
+#include "pizza/thrpool.h"
+
+#define NUM_THREADS 4
+
+static void grow_buffer(void* arg) {
+    (void) arg;
+    Buffer b; buffer_build(&b);
+    for (int j = 0; j < 1000; ++j) {
+        buffer_append_string(&b, "0123456789", 10);
+    }
+    buffer_destroy(&b);
+}
+
+static void test_disabled(void) {
+    MemoryStats before;
+    MemoryStats after;
+    memory_stats_snapshot(&before);
+    grow_buffer(0);
+    memory_stats_snapshot(&after);
+    ok(memcmp(&before, &after, sizeof(MemoryStats)) == 0, "nothing is accounted for when stats are disabled");
+}
+
+static void test_buffer(void) {
+    // start without recycled blocks, so that all of them are accounted for
+    bufpool_flush();
+
+    MemoryStats stats;
+    memory_stats_enable(1);
+    memory_stats_snapshot(&stats);
+    MemoryTagStats old = stats.tag[MEMORY_TAG_BUFFER];
+
+    Buffer b; buffer_build(&b);
+    for (int j = 0; j < 1000; ++j) {
+        buffer_append_string(&b, "0123456789", 10);
+    }
+    memory_stats_snapshot(&stats);
+    MemoryTagStats* s = &stats.tag[MEMORY_TAG_BUFFER];
+    cmp_ok(s->live - old.live, "==", b.cap, "live bytes for buffers match buffer capacity %u", b.cap);
+    cmp_ok(s->peak, ">=", b.cap, "peak bytes for buffers are at least buffer capacity");
+    cmp_ok(s->allocs - old.allocs, "==", 1, "buffer was allocated once");
+    cmp_ok(s->reallocs - old.reallocs, ">", 1, "buffer was reallocated several times");
+
+    // destroying the buffer may keep its block in the pool, until flushed
+    buffer_destroy(&b);
+    bufpool_flush();
+    memory_stats_snapshot(&stats);
+    cmp_ok(s->live, "==", old.live, "live bytes for buffers go back after destroying buffer");
+    cmp_ok(s->frees - old.frees, "==", 1, "buffer was released once");
+    memory_stats_enable(0);
+}
+
+static void test_path(void) {
+    MemoryStats stats;
+    memory_stats_enable(1);
+    memory_stats_snapshot(&stats);
+    int64_t old = stats.tag[MEMORY_TAG_PATH].live;
+
+    const char* name = "/this/is/a/rather/long/path/that/does/not/fit/in/the/buffer/itself";
+    Path p; path_from_string(&p, name, 0);
+    memory_stats_snapshot(&stats);
+    cmp_ok(stats.tag[MEMORY_TAG_PATH].live - old, "==", p.name.cap, "path memory is accounted for as path");
+    path_destroy(&p);
+    memory_stats_snapshot(&stats);
+    cmp_ok(stats.tag[MEMORY_TAG_PATH].live, "==", old, "path memory is released");
+    memory_stats_enable(0);
+}
+
+static void test_threads(void) {
+    MemoryStats stats;
+    memory_stats_enable(1);
+    memory_stats_snapshot(&stats);
+    MemoryTagStats old = stats.tag[MEMORY_TAG_BUFFER];
+    uint64_t thrpool_allocs = stats.tag[MEMORY_TAG_THRPOOL].allocs;
+
+    ThrPool* pool = thrpool_create(NUM_THREADS, 64);
+    for (int j = 0; j < NUM_THREADS; ++j) {
+        thrpool_add(pool, grow_buffer, 0);
+    }
+    thrpool_destroy(pool, 0);
+
+    memory_stats_snapshot(&stats);
+    MemoryTagStats* s = &stats.tag[MEMORY_TAG_BUFFER];
+    cmp_ok(s->allocs - old.allocs, "==", NUM_THREADS, "counters from exited threads are kept");
+    cmp_ok(s->frees - old.frees, "==", NUM_THREADS, "releases from exited threads are kept");
+    cmp_ok(s->live, "==", old.live, "no buffer memory left behind by threads");
+    cmp_ok(stats.tag[MEMORY_TAG_THRPOOL].allocs - thrpool_allocs, "==", 3, "thrpool allocations are accounted for");
+    cmp_ok(stats.tag[MEMORY_TAG_THRPOOL].live, "==", 0, "thrpool memory is released");
+
+    uint64_t total = 0;
+    for (int j = 0; j < MEMORY_HISTOGRAM_BUCKETS; ++j) {
+        total += s->histogram[j];
+    }
+    cmp_ok(total, "==", s->allocs + s->reallocs, "histogram counts all allocations");
+    memory_stats_enable(0);
+}
+
+static void test_secure(void) {
+    static unsigned flags[] = { 0, MEMORY_SECURE_LOCK };
+    memory_stats_enable(1);
+    for (int j = 0; j < 2; ++j) {
+        MemoryStats stats;
+        memory_stats_snapshot(&stats);
+        int64_t old = stats.tag[MEMORY_TAG_CRYPTO].live;
+
+        size_t len = 100;
+        unsigned char* p = memory_secure_alloc(len, flags[j]);
+        int clear = 1;
+        for (size_t k = 0; k < len; ++k) {
+            if (p[k]) {
+                clear = 0;
+            }
+        }
+        ok(clear, "secure memory with flags %u starts cleared", flags[j]);
+        memory_stats_snapshot(&stats);
+        cmp_ok(stats.tag[MEMORY_TAG_CRYPTO].live - old, "==", len, "secure memory with flags %u is accounted for", flags[j]);
+
+        memset(p, 0xaa, len);
+        memory_secure_wipe(p, len);
+        clear = 1;
+        for (size_t k = 0; k < len; ++k) {
+            if (p[k]) {
+                clear = 0;
+            }
+        }
+        ok(clear, "secure memory with flags %u is wiped", flags[j]);
+        memory_secure_free(p, len, flags[j]);
+        memory_stats_snapshot(&stats);
+        cmp_ok(stats.tag[MEMORY_TAG_CRYPTO].live, "==", old, "secure memory with flags %u is released", flags[j]);
+    }
+    memory_stats_enable(0);
+}
+
+static void test_tag_names(void) {
+    is(memory_tag_name(MEMORY_TAG_BUFFER), "buffer", "name for buffer tag");
+    is(memory_tag_name(MEMORY_TAG_LAST), "", "name for invalid tag");
+}
+
+int main (int argc, char* argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_disabled();
+    test_buffer();
+    test_path();
+    test_threads();
+    test_secure();
+    test_tag_names();
+
+    done_testing();
+}
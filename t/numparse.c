@@ -0,0 +1,182 @@
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tap.h>
+#include "pizza/numparse.h"
+
+#define ALEN(a) (int) ((sizeof(a) / sizeof((a)[0])))
+
+static void test_u64(void) {
+    static struct {
+        const char* str;
+        int ret;
+        uint64_t val;
+    } data[] = {
+        { "0", 0, 0 },
+        { "7", 0, 7 },
+        { "+42", 0, 42 },
+        { "12345678", 0, 12345678 },
+        { "123456789", 0, 123456789 },
+        { "0000000000000000000000001", 0, 1 },
+        { "1234567890123456789", 0, 1234567890123456789ULL },
+        { "18446744073709551615", 0, UINT64_MAX },
+        { "18446744073709551616", ERANGE, UINT64_MAX },
+        { "99999999999999999999999", ERANGE, UINT64_MAX },
+        { "", EINVAL, 0 },
+        { "+", EINVAL, 0 },
+        { "-1", EINVAL, 0 },
+        { " 1", EINVAL, 0 },
+        { "1 ", EINVAL, 0 },
+        { "1234567x", EINVAL, 0 },
+        { "12345678x", EINVAL, 0 },
+        { "123:4567", EINVAL, 0 },
+        { "99999999999999999999x", EINVAL, 0 },
+    };
+    for (int j = 0; j < ALEN(data); ++j) {
+        uint64_t val = 0;
+        int ret = numparse_u64(data[j].str, strlen(data[j].str), &val);
+        cmp_ok(ret, "==", data[j].ret, "u64 [%s] => ret %d", data[j].str, data[j].ret);
+        ok(val == data[j].val, "u64 [%s] => %llu", data[j].str, (unsigned long long) data[j].val);
+    }
+}
+
+static void test_i64(void) {
+    static struct {
+        const char* str;
+        int ret;
+        int64_t val;
+    } data[] = {
+        { "0", 0, 0 },
+        { "-0", 0, 0 },
+        { "+17", 0, 17 },
+        { "-17", 0, -17 },
+        { "-12345678901234", 0, -12345678901234LL },
+        { "9223372036854775807", 0, INT64_MAX },
+        { "-9223372036854775808", 0, INT64_MIN },
+        { "9223372036854775808", ERANGE, INT64_MAX },
+        { "-9223372036854775809", ERANGE, INT64_MIN },
+        { "-99999999999999999999999", ERANGE, INT64_MIN },
+        { "-", EINVAL, 0 },
+        { "--1", EINVAL, 0 },
+        { "1.5", EINVAL, 0 },
+    };
+    for (int j = 0; j < ALEN(data); ++j) {
+        int64_t val = 0;
+        int ret = numparse_i64(data[j].str, strlen(data[j].str), &val);
+        cmp_ok(ret, "==", data[j].ret, "i64 [%s] => ret %d", data[j].str, data[j].ret);
+        ok(val == data[j].val, "i64 [%s] => %lld", data[j].str, (long long) data[j].val);
+    }
+}
+
+// Return true if parsing str gives exactly the same double as strtod().
+static int same_as_strtod(const char* str) {
+    double val = 0;
+    int ret = numparse_double(str, strlen(str), &val);
+    if (ret == EINVAL) {
+        return 0;
+    }
+    double exp = strtod(str, 0);
+    if (isnan(exp)) {
+        return isnan(val);
+    }
+    return memcmp(&val, &exp, sizeof(double)) == 0;
+}
+
+static void test_double(void) {
+    static const char* data[] = {
+        "0", "-0", "0.0", "+0e10", "1", "-1", "0.1", ".5", "5.", "-.5e1",
+        "3.141592653589793", "2.718281828459045235360287",
+        "1e22", "1e23", "9007199254740992", "9007199254740993", "9007199254740995",
+        "123456789012345678901234567890",
+        "1.7976931348623157e308", "1.7976931348623158e308", "2.2250738585072014e-308",
+        "2.2250738585072011e-308", "4.9e-324", "5e-324", "2.4703282292062327e-324",
+        "2.4703282292062328e-324", "1e-400", "1e400", "-1e400", "1e-5000000000",
+        "0.000000000000000000000000000000000000000000001",
+        "7.038531e-26", "8.589973e9", "3.0540412e5", "1448997445238699",
+        "0.30000000000000004", "6.02214076E+23", "1.00000000000000011102230246251565404236316680908203125",
+        "1.00000000000000011102230246251565404236316680908203124",
+        "1.00000000000000011102230246251565404236316680908203126",
+        "9007199254740993.0000000000000000000000000000000000000000000000000001",
+        "inf", "-Infinity", "NaN", "nan",
+    };
+    for (int j = 0; j < ALEN(data); ++j) {
+        ok(same_as_strtod(data[j]), "double [%s] is the same as with strtod()", data[j]);
+    }
+
+    static struct {
+        const char* str;
+        int ret;
+    } errors[] = {
+        { "", EINVAL },
+        { "-", EINVAL },
+        { ".", EINVAL },
+        { "e5", EINVAL },
+        { "1e", EINVAL },
+        { "1e+", EINVAL },
+        { "1.2.3", EINVAL },
+        { "1,5", EINVAL },
+        { " 1", EINVAL },
+        { "infinit", EINVAL },
+        { "1e400", ERANGE },
+        { "-1e400", ERANGE },
+        { "1e-400", ERANGE },
+    };
+    for (int j = 0; j < ALEN(errors); ++j) {
+        double val = 0;
+        int ret = numparse_double(errors[j].str, strlen(errors[j].str), &val);
+        cmp_ok(ret, "==", errors[j].ret, "double [%s] => ret %d", errors[j].str, errors[j].ret);
+    }
+}
+
+static void test_double_random(void) {
+    // print lots of random doubles with all precisions, and also make up
+    // numbers with random digits and exponents; all of them must parse
+    // exactly as with strtod()
+    unsigned long long seed = 88172645463325252ULL;
+    int bad = 0;
+    int count = 0;
+    char str[128];
+    for (int j = 0; j < 20000; ++j) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        double d = 0;
+        uint64_t bits = seed;
+        memcpy(&d, &bits, sizeof(d));
+        if (isnan(d) || isinf(d)) {
+            continue;
+        }
+        for (int p = 1; p <= 17; p += 4) {
+            sprintf(str, "%.*g", p, d);
+            bad += !same_as_strtod(str);
+            ++count;
+        }
+
+        int ndigits = 1 + seed % 30;
+        int pos = 0;
+        for (int k = 0; k < ndigits; ++k) {
+            str[pos++] = '0' + (seed >> (k * 2)) % 10;
+            if (k == (int) (seed >> 40) % ndigits) {
+                str[pos++] = '.';
+            }
+        }
+        sprintf(str + pos, "e%d", (int) ((seed >> 48) % 700) - 350);
+        bad += !same_as_strtod(str);
+        ++count;
+    }
+    cmp_ok(bad, "==", 0, "%d random doubles are the same as with strtod()", count);
+}
+
+int main (int argc, char* argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_u64();
+    test_i64();
+    test_double();
+    test_double_random();
+
+    done_testing();
+}
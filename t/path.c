@@ -206,6 +206,52 @@ static void test_path_spew_slurp_append(Path* tmp) {
     path_destroy(&p);
 }
 
+static void test_path_spew_append_chain(Path* tmp) {
+    Path p; path_build(&p);
+    path_child(tmp, &p, slice_from_string("path_spew_append_chain.txt", 0));
+    Buffer be; buffer_build(&be);
+    Buffer br; buffer_build(&br);
+    BufferChain c; bufchain_build(&c);
+
+    Slice s1 = slice_from_string("It had a perfectly round door like a porthole, ", 0);
+    Slice s2 = slice_from_string("painted green, with a shiny yellow brass knob.\n", 0);
+    for (int j = 0; j < 100; ++j) {
+        bufchain_append_slice(&c, s1);
+        bufchain_append_slice(&c, s2);
+        buffer_append_slice(&be, s1);
+        buffer_append_slice(&be, s2);
+    }
+    path_spew_chain(&p, &c);
+    path_slurp(&p, &br);
+    ok(slice_equal(buffer_slice(&be), buffer_slice(&br)), "path [%s] has correct contents after chain was spewed to", p.name.ptr);
+
+    path_append_chain(&p, &c);
+    for (int j = 0; j < 100; ++j) {
+        buffer_append_slice(&be, s1);
+        buffer_append_slice(&be, s2);
+    }
+    buffer_clear(&br);
+    path_slurp(&p, &br);
+    ok(slice_equal(buffer_slice(&be), buffer_slice(&br)), "path [%s] has correct contents after chain was appended to", p.name.ptr);
+
+    Path q; path_build(&q);
+    path_child(tmp, &q, slice_from_string("path_copy.txt", 0));
+    int ret = path_copy(&p, &q);
+    ok(!ret, "path [%s] copied to [%s]", p.name.ptr, q.name.ptr);
+    buffer_clear(&br);
+    path_slurp(&q, &br);
+    ok(slice_equal(buffer_slice(&be), buffer_slice(&br)), "path [%s] has correct contents after being copied to", q.name.ptr);
+    path_unlink(&q);
+    path_destroy(&q);
+
+    path_unlink(&p);
+
+    bufchain_destroy(&c);
+    buffer_destroy(&br);
+    buffer_destroy(&be);
+    path_destroy(&p);
+}
+
 #define BAZ     "baz"
 #define INVALID "*INVALID*"
 
@@ -353,6 +399,7 @@ int main (int argc, char* argv[]) {
     test_path_symlink(&tmp);
     test_path_touch(&tmp);
     test_path_spew_slurp_append(&tmp);
+    test_path_spew_append_chain(&tmp);
 
     test_path_rmdir(&tmp);
     path_destroy(&tmp);
@@ -0,0 +1,153 @@
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <tap.h>
+#include "pizza/buffer.h"
+#include "pizza/ringbuf.h"
+
+static void test_build(void) {
+    RingBuffer r;
+    int ret = ringbuf_build(&r, 1000);
+    cmp_ok(ret, "==", 0, "built ring buffer");
+    long page = sysconf(_SC_PAGESIZE);
+    cmp_ok(r.size, "==", page, "size was rounded up to a page");
+    cmp_ok(ringbuf_room(&r), "==", r.size, "empty ring has all its room available");
+
+    // both mappings show the same memory
+    r.ptr[0] = 'x';
+    cmp_ok(r.ptr[r.size], "==", 'x', "write to first copy shows up in second copy");
+    r.ptr[r.size + 1] = 'y';
+    cmp_ok(r.ptr[1], "==", 'y', "write to second copy shows up in first copy");
+    ringbuf_destroy(&r);
+    ok(r.ptr == 0, "destroyed ring buffer");
+
+    ret = ringbuf_build(&r, SLICE_LEN_MAX);
+    cmp_ok(ret, "==", EINVAL, "cannot build ring buffer with size %llu", (unsigned long long) SLICE_LEN_MAX);
+}
+
+static void test_wraparound(void) {
+    RingBuffer r;
+    ringbuf_build(&r, 0);
+
+    // repeatedly add and remove chunks that do not divide the size, so that
+    // data wraps around at all possible positions
+    char chunk[777];
+    int good = 1;
+    unsigned char next_in = 0;
+    unsigned char next_out = 0;
+    for (int j = 0; j < 1000; ++j) {
+        for (unsigned k = 0; k < sizeof(chunk); ++k) {
+            chunk[k] = (char) next_in++;
+        }
+        SliceLen n = ringbuf_append_slice(&r, slice_from_memory(chunk, sizeof(chunk)));
+        next_in -= sizeof(chunk) - n;
+
+        // the readable data is always contiguous
+        Slice s = ringbuf_slice(&r);
+        SliceLen m = s.len / 2 + 1;
+        for (SliceLen k = 0; k < m && k < s.len; ++k) {
+            if ((unsigned char) s.ptr[k] != next_out++) {
+                good = 0;
+            }
+        }
+        ringbuf_consume(&r, m);
+    }
+    ok(good, "data survived wrapping around the ring");
+    ok(r.pos < r.size, "read position stays within the ring");
+
+    SliceLen n = ringbuf_append_slice(&r, slice_from_memory(chunk, sizeof(chunk)));
+    n += ringbuf_append_slice(&r, slice_from_memory(chunk, sizeof(chunk)));
+    while (n > 0 && ringbuf_room(&r) > 0) {
+        n = ringbuf_append_slice(&r, slice_from_memory(chunk, sizeof(chunk)));
+    }
+    cmp_ok(ringbuf_room(&r), "==", 0, "ring can be filled");
+    n = ringbuf_append_slice(&r, slice_from_memory(chunk, sizeof(chunk)));
+    cmp_ok(n, "==", 0, "full ring does not take more data");
+
+    ringbuf_consume(&r, r.size + 1);
+    cmp_ok(r.len, "==", 0, "consuming everything empties the ring");
+    ringbuf_destroy(&r);
+}
+
+static void test_fd(void) {
+    int in[2];
+    int out[2];
+    ok(pipe(in) == 0 && pipe(out) == 0, "created pipes");
+
+    RingBuffer r;
+    ringbuf_build(&r, 0);
+
+    // stream data from one pipe to the other through the ring, with the
+    // writer deliberately lagging behind
+    Buffer sent; buffer_build(&sent);
+    Buffer received; buffer_build(&received);
+    int errors = 0;
+    for (int j = 0; j < 200; ++j) {
+        char tmp[1500];
+        for (unsigned k = 0; k < sizeof(tmp); ++k) {
+            tmp[k] = (char) ('a' + (j + k) % 26);
+        }
+        buffer_append_string(&sent, tmp, sizeof(tmp));
+        if (write(in[1], tmp, sizeof(tmp)) != (ssize_t) sizeof(tmp)) {
+            ++errors;
+        }
+
+        SliceLen nread = 0;
+        if (ringbuf_read_fd(&r, in[0], &nread) != 0) {
+            ++errors;
+        }
+        SliceLen nwritten = 0;
+        if (ringbuf_write_fd(&r, out[1], &nwritten) != 0) {
+            ++errors;
+        }
+        ssize_t got = read(out[0], tmp, sizeof(tmp));
+        if (got > 0) {
+            buffer_append_string(&received, tmp, got);
+        }
+    }
+    close(in[1]);
+    while (1) {
+        SliceLen nread = 0;
+        if (ringbuf_read_fd(&r, in[0], &nread) != 0) {
+            ++errors;
+            break;
+        }
+        SliceLen nwritten = 0;
+        if (ringbuf_write_fd(&r, out[1], &nwritten) != 0) {
+            ++errors;
+            break;
+        }
+        if (nread == 0 && r.len == 0) {
+            break;
+        }
+    }
+    close(out[1]);
+    while (1) {
+        char tmp[4096];
+        ssize_t got = read(out[0], tmp, sizeof(tmp));
+        if (got <= 0) {
+            break;
+        }
+        buffer_append_string(&received, tmp, got);
+    }
+    cmp_ok(errors, "==", 0, "streamed data through ring without errors");
+    cmp_ok(received.len, "==", sent.len, "received all %u bytes", (unsigned) sent.len);
+    ok(slice_equal(buffer_slice(&received), buffer_slice(&sent)), "received correct data");
+
+    buffer_destroy(&received);
+    buffer_destroy(&sent);
+    ringbuf_destroy(&r);
+    close(in[0]);
+    close(out[0]);
+}
+
+int main (int argc, char* argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_build();
+    test_wraparound();
+    test_fd();
+
+    done_testing();
+}
@@ -0,0 +1,228 @@
+#include <string.h>
+#include <tap.h>
+#include "pizza/scan.h"
+
+#define ALEN(a) (int) ((sizeof(a) / sizeof((a)[0])))
+
+#define DATA_SIZE 300
+
+static const char* level_name[] = { "scalar", "SSE2", "AVX2" };
+
+static const char* naive_byte(const char* ptr, size_t len, char t) {
+    for (size_t j = 0; j < len; ++j) {
+        if (ptr[j] == t) {
+            return ptr + j;
+        }
+    }
+    return 0;
+}
+
+static const char* naive_byte_reverse(const char* ptr, size_t len, char t) {
+    for (size_t j = len; j-- > 0; ) {
+        if (ptr[j] == t) {
+            return ptr + j;
+        }
+    }
+    return 0;
+}
+
+static const char* naive_set(const char* ptr, size_t len, const char* set, size_t set_len, int in) {
+    for (size_t j = 0; j < len; ++j) {
+        int found = set_len && memchr(set, ptr[j], set_len) != 0;
+        if (found == in) {
+            return ptr + j;
+        }
+    }
+    return 0;
+}
+
+// Fill data with a pseudo-random mix of the bytes in alphabet.
+static void fill(char* data, size_t len, const char* alphabet, size_t alen, unsigned seed) {
+    for (size_t j = 0; j < len; ++j) {
+        seed = seed * 1103515245U + 12345U;
+        data[j] = alphabet[(seed >> 16) % alen];
+    }
+}
+
+static void test_bytes(int level) {
+    static const char alphabet[] = "abcdefgh\x80\xff";
+    char data[DATA_SIZE];
+    fill(data, sizeof(data), alphabet, sizeof(alphabet) - 1, 42);
+
+    // search for every byte in the alphabet and one that is never there,
+    // over all lengths and a few alignments
+    int bad = 0;
+    int count = 0;
+    for (int t = 0; t <= ALEN(alphabet) - 1; ++t) {
+        char c = alphabet[t];
+        if (c == '\0') {
+            c = 'z';
+        }
+        for (size_t off = 0; off < 4; ++off) {
+            for (size_t len = 0; len + off <= DATA_SIZE; ++len) {
+                const char* ptr = data + off;
+                bad += scan_byte(ptr, len, c) != naive_byte(ptr, len, c);
+                bad += scan_byte_reverse(ptr, len, c) != naive_byte_reverse(ptr, len, c);
+                count += 2;
+            }
+        }
+    }
+    cmp_ok(bad, "==", 0, "%s: %d byte searches give correct results", level_name[level], count);
+}
+
+static void test_sets(int level) {
+    static struct {
+        const char* label;
+        const char* set;
+        const char* alphabet;
+    } data[] = {
+        { "empty"      , ""                                 , "abc"                    },
+        { "one byte"   , ","                                , "abc,"                   },
+        { "few bytes"  , " \t\n"                            , "ab \t\n"                },
+        { "high bytes" , "\x80\xfe\xff"                     , "ab\x80\xfe\xff\x7f"     },
+        { "punctuation", " \t\r\n!\"#$%&'()*+,-./:;<=>?@[]{}|~", "abc ,;:.!?()[]{}\n\tZ" },
+        { "nibbles"    , "0123456789abcdefghijklmnopqrstuvwxyz"    , "0123456789az_-!ABZ"  },
+        { "scattered"  , "\x01\x12\x23\x34\x45\x56\x67\x78\x89\x9a\xab\xbc\xcd\xde\xef\xf0\x11\x22",
+                         "\x01\x12\x23\x34\x45\x56\x67\x78\x89\x9a\xab\xbc\xcd\xde\xef\xf0\x11\x22\x33\x44" },
+    };
+    char buf[DATA_SIZE];
+    for (int k = 0; k < ALEN(data); ++k) {
+        size_t set_len = strlen(data[k].set);
+        ScanSet set;
+        scan_set_build(&set, data[k].set, set_len);
+        fill(buf, sizeof(buf), data[k].alphabet, strlen(data[k].alphabet), 17 + k);
+
+        int bad = 0;
+        int count = 0;
+        for (size_t off = 0; off < 4; ++off) {
+            for (size_t len = 0; len + off <= DATA_SIZE; ++len) {
+                const char* ptr = buf + off;
+                for (int in = 0; in <= 1; ++in) {
+                    const char* got = in ? scan_set_first_in(ptr, len, &set)
+                                         : scan_set_first_not_in(ptr, len, &set);
+                    bad += got != naive_set(ptr, len, data[k].set, set_len, in);
+                    ++count;
+                }
+            }
+        }
+        cmp_ok(bad, "==", 0, "%s: %d searches for %s set give correct results", level_name[level], count, data[k].label);
+
+        bad = 0;
+        for (size_t len = 0; len <= DATA_SIZE; ++len) {
+            uint64_t masks[(DATA_SIZE + 63) / 64 + 1];
+            masks[(len + 63) / 64] = 0x5a5a;
+            scan_set_masks(buf, len, &set, masks);
+            for (size_t j = 0; j < (len + 63) / 64 * 64; ++j) {
+                int bit = (masks[j / 64] >> (j % 64)) & 1;
+                int in = j < len && memchr(data[k].set, buf[j], set_len) != 0;
+                bad += bit != in;
+            }
+            bad += masks[(len + 63) / 64] != 0x5a5a;
+        }
+        cmp_ok(bad, "==", 0, "%s: masks for %s set are correct", level_name[level], data[k].label);
+    }
+}
+
+static char naive_lower(char c) {
+    return c >= 'A' && c <= 'Z' ? c + 32 : c;
+}
+
+static void test_nocase(int level) {
+    static const char alphabet[] = "aAbBzZ@[`{\x80\xc1";
+    char data[DATA_SIZE];
+    fill(data, sizeof(data), alphabet, sizeof(alphabet) - 1, 99);
+
+    // convert all lengths, and check every byte
+    int bad = 0;
+    for (size_t len = 0; len <= DATA_SIZE; ++len) {
+        char lower[DATA_SIZE];
+        char upper[DATA_SIZE];
+        memcpy(lower, data, len);
+        memcpy(upper, data, len);
+        scan_to_lower(lower, len);
+        scan_to_upper(upper, len);
+        for (size_t j = 0; j < len; ++j) {
+            bad += lower[j] != naive_lower(data[j]);
+            bad += naive_lower(upper[j]) != naive_lower(data[j]);
+            bad += upper[j] >= 'a' && upper[j] <= 'z';
+        }
+    }
+    cmp_ok(bad, "==", 0, "%s: case conversions are correct", level_name[level]);
+
+    // compare with a copy in the other case that differs in one byte
+    bad = 0;
+    for (size_t len = 0; len <= DATA_SIZE; len += 7) {
+        char other[DATA_SIZE];
+        memcpy(other, data, len);
+        scan_to_upper(other, len);
+        bad += scan_prefix_nocase(data, other, len) != len;
+        for (size_t j = 0; j < len; j += 5) {
+            char save = other[j];
+            other[j] = '~';
+            bad += scan_prefix_nocase(data, other, len) != j;
+            other[j] = save;
+        }
+    }
+    cmp_ok(bad, "==", 0, "%s: case-insensitive comparisons are correct", level_name[level]);
+
+    // search for pieces of the data, in both cases, and for things that are
+    // not there
+    bad = 0;
+    int count = 0;
+    for (size_t nlen = 1; nlen <= 40; nlen += 3) {
+        for (size_t pos = 0; pos + nlen <= DATA_SIZE; pos += 11) {
+            char needle[40];
+            memcpy(needle, data + pos, nlen);
+            for (int k = 0; k < 3; ++k) {
+                if (k == 1) {
+                    scan_to_upper(needle, nlen);
+                }
+                if (k == 2) {
+                    needle[nlen / 2] = '~';
+                }
+                for (size_t len = nlen; len <= DATA_SIZE; len += 61) {
+                    const char* exp = 0;
+                    for (size_t j = 0; !exp && j + nlen <= len; ++j) {
+                        size_t m = 0;
+                        while (m < nlen && naive_lower(data[j + m]) == naive_lower(needle[m])) {
+                            ++m;
+                        }
+                        exp = m == nlen ? data + j : 0;
+                    }
+                    bad += scan_find_nocase(data, len, needle, nlen) != exp;
+                    ++count;
+                }
+            }
+        }
+    }
+    cmp_ok(bad, "==", 0, "%s: %d case-insensitive searches give correct results", level_name[level], count);
+}
+
+static void test_set_build(void) {
+    ScanSet set;
+    scan_set_build(&set, "aabbcc", 6);
+    cmp_ok(set.count, "==", 3, "repeated bytes are counted once");
+    cmp_ok(set.nibbles, "==", 1, "set with few high nibbles can be searched by nibbles");
+
+    scan_set_build(&set, "\x01\x12\x23\x34\x45\x56\x67\x78\x89", 9);
+    cmp_ok(set.nibbles, "==", 0, "set with many high nibbles cannot be searched by nibbles");
+}
+
+int main (int argc, char* argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_set_build();
+
+    int best = scan_get_level();
+    for (int level = SCAN_LEVEL_SCALAR; level <= best; ++level) {
+        int used = scan_set_level(level);
+        cmp_ok(used, "==", level, "using %s scan level", level_name[level]);
+        test_bytes(level);
+        test_sets(level);
+        test_nocase(level);
+    }
+    cmp_ok(scan_set_level(-1), "==", best, "invalid level selects best one");
+
+    done_testing();
+}
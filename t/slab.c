@@ -0,0 +1,111 @@
+#include <stdint.h>
+#include <string.h>
+#include <tap.h>
+#include "pizza/slab.h"
+
+#define ALEN(a) (int) ((sizeof(a) / sizeof((a)[0])))
+
+typedef struct Point {
+    double x;
+    double y;
+    double z;
+} Point;
+
+static void test_class_size(void) {
+    static struct {
+        size_t len;
+        size_t size;
+    } data[] = {
+        {    0,   16 },
+        {    1,   16 },
+        {   16,   16 },
+        {   17,   32 },
+        {   64,   64 },
+        {   65,  128 },
+        { 2048, 2048 },
+        { 2049,    0 },
+    };
+    for (int j = 0; j < ALEN(data); ++j) {
+        size_t got = slab_class_size(data[j].len);
+        cmp_ok(got, "==", data[j].size, "slab_class_size(%zu) => %zu OK", data[j].len, data[j].size);
+    }
+}
+
+static void test_alloc_free(void) {
+    Slab slab; slab_build(&slab);
+
+    Point* p = 0;
+    SLAB_ALLOC(&slab, p, Point);
+    ok(p != 0, "could allocate a Point from the slab");
+    cmp_ok((uintptr_t) p % SLAB_MIN_SIZE, "==", 0, "slab object is aligned");
+    p->x = p->y = p->z = 1.0;
+    void* old = p;
+    SLAB_FREE(&slab, p, Point);
+    ok(p == 0, "SLAB_FREE clears pointer");
+
+    SLAB_ALLOC(&slab, p, Point);
+    ok((void*) p == old, "released object is reused");
+    cmp_ok(slab.classes[1].live, "==", 1, "one live object in class for Point");
+    SLAB_FREE(&slab, p, Point);
+    cmp_ok(slab.classes[1].live, "==", 0, "no live objects in class for Point");
+
+    slab_destroy(&slab);
+}
+
+static void test_many(void) {
+    enum { COUNT = 10000 };
+    static char* ptrs[COUNT];
+    Slab slab; slab_build(&slab);
+
+    int good = 1;
+    for (int j = 0; j < COUNT; ++j) {
+        size_t len = 1 + j % 3000; // some of these will not fit in the slab
+        ptrs[j] = slab_alloc(&slab, len);
+        memset(ptrs[j], j & 0xff, len);
+    }
+    for (int j = 0; j < COUNT; ++j) {
+        size_t len = 1 + j % 3000;
+        if (ptrs[j][0] != (char) (j & 0xff) || ptrs[j][len-1] != (char) (j & 0xff)) {
+            good = 0;
+        }
+        slab_free(&slab, ptrs[j], len);
+    }
+    ok(good, "%d objects of different sizes kept their contents", COUNT);
+
+    uint32_t live = 0;
+    for (int j = 0; j < SLAB_NUM_CLASSES; ++j) {
+        live += slab.classes[j].live;
+    }
+    cmp_ok(live, "==", 0, "no live objects after releasing all of them");
+
+    slab_destroy(&slab);
+}
+
+static void test_allocator(void) {
+    Slab slab; slab_build(&slab);
+    MemoryAllocator allocator;
+    slab_allocator(&slab, &allocator);
+    memory_set_allocator(&allocator);
+    char* p = memory_realloc(0, 40);
+    memcpy(p, "slab", 4);
+    p = memory_realloc(p, 400);
+    ok(memcmp(p, "slab", 4) == 0, "slab allocator keeps data when growing");
+    p = memory_realloc(p, 40000);
+    ok(memcmp(p, "slab", 4) == 0, "slab allocator keeps data when growing past largest class");
+    p = memory_realloc(p, 0);
+    memory_set_allocator(0);
+    ok(p == 0, "slab allocator releases data");
+    slab_destroy(&slab);
+}
+
+int main (int argc, char* argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_class_size();
+    test_alloc_free();
+    test_many();
+    test_allocator();
+
+    done_testing();
+}
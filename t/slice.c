@@ -1,3 +1,4 @@
+#include <errno.h>
 #include <string.h>
 #include <tap.h>
 #include "pizza/util.h"
@@ -12,6 +13,7 @@ static void test_sizes(void) {
     cmp_ok(sizeof(Slice), "==", 2*size_ptr, "sizeof(Slice)");
     cmp_ok(sizeof(char) , "==", 1         , "sizeof(char)");
     cmp_ok(sizeof(char*), "==", size_ptr  , "sizeof(char*)");
+    cmp_ok(sizeof(SliceLen) * 8, "==", SLICE_LEN_BITS, "sizeof(SliceLen)");
 }
 
 static void test_slice_is_empty(void) {
@@ -51,6 +53,39 @@ static void test_slice_compare(void) {
     }
 }
 
+static void test_slice_compare_nocase(void) {
+    static struct {
+        const char* l;
+        const char* r;
+        int cmp;
+    } data[] = {
+        { ""                  , ""                  ,  0 },
+        { "Content-Length"    , "content-length"    ,  0 },
+        { "CONTENT-LENGTH"    , "content-length"    ,  0 },
+        { "Content-Length"    , "content-type"      , -1 },
+        { "ABC"               , "abcd"              , -1 },
+        { "abcd"              , "ABC"               ,  1 },
+        { "[x]"               , "{X}"               , -1 },
+        { "@"                 , "`"                 , -1 },
+        { "Transfer-Encoding: chunked, GZIP and more", "transfer-encoding: CHUNKED, gzip and more", 0 },
+        { "Transfer-Encoding: chunked, GZIP and more", "transfer-encoding: CHUNKED, gzip and morf", -1 },
+    };
+
+    for (int j = 0; j < ALEN(data); ++j) {
+        const char* L = data[j].l;
+        const char* R = data[j].r;
+        Slice l = slice_from_string(L, 0);
+        Slice r = slice_from_string(R, 0);
+        int e = data[j].cmp;
+        int c = slice_compare_nocase(l, r);
+        int ok = e == 0 ? c == 0
+               : e >  0 ? c >  0
+               :          c <  0;
+        cmp_ok(!!ok, "==", !!1, "slice_compare_nocase([%s], [%s]) => %d OK", L, R, e);
+        cmp_ok(!!slice_equal_nocase(l, r), "==", e == 0, "slice_equal_nocase([%s], [%s]) => %d OK", L, R, e == 0);
+    }
+}
+
 static void test_slice_trim(void) {
     static struct {
         const char* label;
@@ -104,6 +139,48 @@ static void test_slice_int(void) {
     }
 }
 
+static void test_slice_parse(void) {
+    static struct {
+        const char* label;
+        const char* s;
+        int r;
+        double v;
+    } data[] = {
+        { "empty"    , ""                    , EINVAL,  0 },
+        { "invalid"  , "12x"                 , EINVAL,  0 },
+        { "zero"     , "0"                   ,      0,  0 },
+        { "negative" , "-66"                 ,      0,  -66 },
+        { "large"    , "1234567890123"       ,      0,  1234567890123.0 },
+        { "too large", "99999999999999999999",  ERANGE, 0 },
+    };
+
+    for (int j = 0; j < ALEN(data); ++j) {
+        const char* L = data[j].label;
+        Slice s = slice_from_string(data[j].s, 0);
+        int64_t val = 0;
+        int ret = slice_parse_i64(s, &val);
+        cmp_ok(ret, "==", data[j].r, "slice_parse_i64() returns %d for %s OK", data[j].r, L);
+        if (!ret) {
+            ok(val == (int64_t) data[j].v, "slice_parse_i64() produces %.0f for %s OK", data[j].v, L);
+        }
+        double d = 0;
+        ret = slice_parse_double(s, &d);
+        if (data[j].r != ERANGE) {
+            cmp_ok(ret, "==", data[j].r, "slice_parse_double() returns %d for %s OK", data[j].r, L);
+        }
+        if (!data[j].r) {
+            ok(d == data[j].v, "slice_parse_double() produces %.0f for %s OK", data[j].v, L);
+        }
+    }
+
+    uint64_t u = 0;
+    int ret = slice_parse_u64(slice_from_string("18446744073709551615", 0), &u);
+    ok(ret == 0 && u == UINT64_MAX, "slice_parse_u64() parses largest value OK");
+    double d = 0;
+    ret = slice_parse_double(slice_from_string("-2.5e-3", 0), &d);
+    ok(ret == 0 && d == -2.5e-3, "slice_parse_double() parses fraction with exponent OK");
+}
+
 static void test_slice_find_byte(void) {
     static struct {
         const char* w;
@@ -169,6 +246,36 @@ static void test_slice_find_slice(void) {
     }
 }
 
+static void test_slice_find_slice_nocase(void) {
+    static struct {
+        const char* w;
+        const char* n;
+        int pos;
+    } data[] = {
+        { "foo"                 , "OO"    ,  1 },
+        { "FOO"                 , "ok"    , -1 },
+        { ""                    , "k"     , -1 },
+        { "You KNOW it is there", "know"  ,  4 },
+        { "this time it is not" , "REALLY", -1 },
+        { "Host: EXAMPLE.com\r\nAccept: */*\r\nX-Forwarded-For: 10.0.0.1\r\n", "x-forwarded-FOR", 32 },
+        { "Host: EXAMPLE.com\r\nAccept: */*\r\nX-Forwarded-For: 10.0.0.1\r\n", "x-forwarded-far", -1 },
+    };
+
+    for (int j = 0; j < ALEN(data); ++j) {
+        const char* W = data[j].w;
+        const char* N = data[j].n;
+        int e = data[j].pos;
+        Slice w = slice_from_string(W, 0);
+        Slice n = slice_from_string(N, 0);
+        Slice f = slice_find_slice_nocase(w, n);
+        if (e < 0) {
+            cmp_ok(!!slice_is_empty(f), "==", !!1, "slice_find_slice_nocase([%s], [%s]) => ABSENT", W, N);
+        } else {
+            cmp_ok(f.ptr - W, "==", e, "slice_find_slice_nocase([%s], [%s]) => FOUND at %d", W, N, e);
+        }
+    }
+}
+
 static void test_slice_tokenize(void) {
     static struct {
         const char* str;
@@ -188,6 +295,9 @@ static void test_slice_tokenize(void) {
         { "separators not found", ",;" },
         { "", ",;" },
         { "empty separators", "" },
+        { "caf\xc3\xa9\xff na\xc3\xafve\xffr\xc3\xa9sum\xc3\xa9", "\xff" },
+        { "In a hole in the ground there lived a hobbit. Not a nasty, dirty, wet hole, filled with the ends of worms", " ,." },
+        { "{\"key\": [1, 2, 3], \"other\": {\"nested\": true, \"list\": [\"a\", \"b\"]}, \"last\": null}", " \t\r\n{}[]:,\"" },
     };
 
     for (int j = 0; j < ALEN(data); ++j) {
@@ -244,10 +354,13 @@ int main (int argc, char* argv[]) {
     test_sizes();
     test_slice_is_empty();
     test_slice_compare();
+    test_slice_compare_nocase();
     test_slice_trim();
     test_slice_int();
+    test_slice_parse();
     test_slice_find_byte();
     test_slice_find_slice();
+    test_slice_find_slice_nocase();
     test_slice_tokenize();
 
     done_testing();
@@ -0,0 +1,126 @@
+#include <string.h>
+#include <tap.h>
+#include "pizza/buffer.h"
+#include "pizza/thrpool.h"
+#include "pizza/tcache.h"
+
+#define NUM_THREADS 4
+#define NUM_BLOCKS 1000
+
+typedef struct Work {
+    char* blocks[NUM_BLOCKS];
+    int good;
+} Work;
+
+static size_t block_size(int j) {
+    return 1 + (j * 37) % 4000; // some of these will be too large for a cache
+}
+
+static void fill_blocks(Work* w, int tag) {
+    for (int j = 0; j < NUM_BLOCKS; ++j) {
+        size_t len = block_size(j);
+        w->blocks[j] = memory_realloc(0, len);
+        memset(w->blocks[j], tag, len);
+    }
+}
+
+static int check_and_free_blocks(Work* w, int tag) {
+    int good = 1;
+    for (int j = 0; j < NUM_BLOCKS; ++j) {
+        size_t len = block_size(j);
+        if (w->blocks[j][0] != tag || w->blocks[j][len-1] != tag) {
+            good = 0;
+        }
+        w->blocks[j] = memory_realloc(w->blocks[j], 0);
+    }
+    return good;
+}
+
+static void free_in_worker(void* arg) {
+    Work* w = (Work*) arg;
+    w->good = check_and_free_blocks(w, 'M');
+}
+
+static void alloc_in_worker(void* arg) {
+    Work* w = (Work*) arg;
+    fill_blocks(w, 'W');
+    Buffer b; buffer_build(&b);
+    for (int j = 0; j < 1000; ++j) {
+        buffer_append_string(&b, "worker", 6);
+    }
+    w->good = b.len == 6000;
+    buffer_destroy(&b);
+}
+
+static void test_install(void) {
+    const MemoryAllocator* old = memory_set_allocator(tcache_allocator());
+    ok(old == &memory_allocator_system, "default allocator was the system one");
+    ok(memory_get_allocator() == tcache_allocator(), "tcache allocator is installed");
+    memory_set_allocator(old);
+    ok(memory_get_allocator() == &memory_allocator_system, "system allocator is installed again");
+}
+
+static void test_realloc(void) {
+    memory_set_allocator(tcache_allocator());
+    char* p = memory_realloc(0, 10);
+    memcpy(p, "0123456789", 10);
+    p = memory_realloc(p, 20);
+    ok(memcmp(p, "0123456789", 10) == 0, "tcache keeps data when growing within class");
+    p = memory_realloc(p, 100000);
+    ok(memcmp(p, "0123456789", 10) == 0, "tcache keeps data when growing to a large block");
+    p = memory_realloc(p, 5);
+    ok(memcmp(p, "01234", 5) == 0, "tcache keeps data when shrinking back to a small block");
+    p = memory_realloc(p, 0);
+    ok(p == 0, "tcache releases a block");
+    memory_set_allocator(0);
+}
+
+static void test_cross_thread(void) {
+    static Work work[NUM_THREADS];
+    memory_set_allocator(tcache_allocator());
+
+    // blocks allocated here are released in the workers
+    for (int j = 0; j < NUM_THREADS; ++j) {
+        fill_blocks(&work[j], 'M');
+        work[j].good = 0;
+    }
+    ThrPool* pool = thrpool_create(NUM_THREADS, 64);
+    for (int j = 0; j < NUM_THREADS; ++j) {
+        thrpool_add(pool, free_in_worker, &work[j]);
+    }
+    thrpool_destroy(pool, 0);
+    int good = 1;
+    for (int j = 0; j < NUM_THREADS; ++j) {
+        good = good && work[j].good;
+    }
+    ok(good, "blocks allocated in main thread were released by workers");
+
+    // blocks allocated in the workers are released here
+    pool = thrpool_create(NUM_THREADS, 64);
+    for (int j = 0; j < NUM_THREADS; ++j) {
+        thrpool_add(pool, alloc_in_worker, &work[j]);
+    }
+    thrpool_destroy(pool, 0);
+    for (int j = 0; j < NUM_THREADS; ++j) {
+        good = good && work[j].good && check_and_free_blocks(&work[j], 'W');
+    }
+    ok(good, "blocks allocated by workers were released in main thread");
+
+    // remote blocks are recycled on next allocation
+    char* p = memory_realloc(0, 32);
+    ok(p != 0, "can allocate after receiving remote blocks");
+    memory_realloc(p, 0);
+
+    memory_set_allocator(0);
+}
+
+int main (int argc, char* argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_install();
+    test_realloc();
+    test_cross_thread();
+
+    done_testing();
+}
@@ -0,0 +1,114 @@
+#include <string.h>
+#include <tap.h>
+#include "pizza/buffer.h"
+#include "pizza/tokenizer.h"
+
+#define ALEN(a) (int) ((sizeof(a) / sizeof((a)[0])))
+
+// Check the tokens found by the Tokenizer against those found one at a time
+// by slice_tokenize_by_slice(); return the number of differences.
+static int check_tokens(Slice src, Slice sep, const SliceLen* offsets, SliceLen count) {
+    int bad = 0;
+    SliceLen k = 0;
+    SliceLookup lookup = {0};
+    while (slice_tokenize_by_slice(src, sep, &lookup)) {
+        if (k >= count) {
+            ++bad;
+            continue;
+        }
+        Slice tok = tokenizer_token(src, offsets, k);
+        if (tok.ptr != lookup.result.ptr || tok.len != lookup.result.len) {
+            ++bad;
+        }
+        ++k;
+    }
+    if (k != count) {
+        ++bad;
+    }
+    return bad;
+}
+
+static void test_split(void) {
+    static struct {
+        const char* str;
+        const char* sep;
+        int count;
+    } data[] = {
+        { "", " ", 0 },
+        { "X", " ", 1 },
+        { "X", "X", 0 },
+        { "   ", " ", 0 },
+        { "foo bar baz", " ", 3 },
+        { "  foo   bar baz  ", " ", 3 },
+        { "3+4*5-11+323", "+-*/", 5 },
+        { "-+3+4*5", "%", 1 },
+        { "duplicated,;-separators;;;now", ",;", 3 },
+        { "empty separators", "", 1 },
+        { "a,b,c,d,e,f,g,h,i,j,k,l,m,n,o,p,q,r,s,t,u,v,w,x,y,z,0,1,2,3,4,5,6,7,8,9", ",", 36 },
+        { "a-token-that-goes-on-and-on-and-on-past-the-first-sixty-four-bytes-of-input", " ", 1 },
+        { "{\"key\": [1, 2, 3], \"other\": {\"nested\": true, \"list\": [\"a\", \"b\"]}, \"last\": null}", " \t\r\n{}[]:,\"", 12 },
+    };
+    for (int j = 0; j < ALEN(data); ++j) {
+        Slice src = slice_from_string(data[j].str, 0);
+        Slice sep = slice_from_string(data[j].sep, 0);
+        Tokenizer t; tokenizer_build(&t, sep);
+        SliceLen offsets[2 * 64];
+        SliceLen count = tokenizer_split(&t, src, offsets, 64);
+        cmp_ok(count, "==", data[j].count, "tokenizer found %d tokens in [%s]", data[j].count, data[j].str);
+        cmp_ok(check_tokens(src, sep, offsets, count), "==", 0, "tokenizer found correct tokens in [%s]", data[j].str);
+    }
+}
+
+static void test_small_array(void) {
+    Slice src = slice_from_string("one two three four five", 0);
+    Tokenizer t; tokenizer_build(&t, slice_from_string(" ", 0));
+    SliceLen offsets[2 * 2 + 1];
+    offsets[4] = 999;
+    SliceLen count = tokenizer_split(&t, src, offsets, 2);
+    cmp_ok(count, "==", 5, "tokenizer counts all tokens even with a small array");
+    ok(slice_equal(tokenizer_token(src, offsets, 1), slice_from_string("two", 0)), "tokenizer stores tokens that fit");
+    cmp_ok(offsets[4], "==", 999, "tokenizer does not write past the array");
+}
+
+static void test_large(void) {
+    // about a megabyte of words with runs of different separators, split
+    // with all the available scan levels
+    static const char* words[] = { "pizza", "margherita", "4", "quattro-stagioni", "x", "napoletana" };
+    static const char* seps[] = { " ", ", ", "\n", "\t  ", ";" };
+    Buffer b; buffer_build(&b);
+    unsigned seed = 1;
+    int expected = 0;
+    while (b.len < 1024 * 1024) {
+        seed = seed * 1103515245U + 12345U;
+        buffer_append_string(&b, words[(seed >> 16) % ALEN(words)], 0);
+        buffer_append_string(&b, seps[(seed >> 8) % ALEN(seps)], 0);
+        ++expected;
+    }
+    Slice src = buffer_slice(&b);
+    Slice sep = slice_from_string(" ,\n\t;", 0);
+    Tokenizer t; tokenizer_build(&t, sep);
+
+    int best = scan_get_level();
+    for (int level = SCAN_LEVEL_SCALAR; level <= best; ++level) {
+        scan_set_level(level);
+        Arena arena; arena_build(&arena, 0);
+        SliceLen* offsets = 0;
+        SliceLen count = tokenizer_split_in_arena(&t, src, &arena, &offsets);
+        cmp_ok(count, "==", expected, "level %d: tokenizer found %d tokens in %u bytes", level, expected, (unsigned) src.len);
+        cmp_ok(check_tokens(src, sep, offsets, count), "==", 0, "level %d: tokenizer found correct tokens in %u bytes", level, (unsigned) src.len);
+        arena_destroy(&arena);
+    }
+    scan_set_level(-1);
+    buffer_destroy(&b);
+}
+
+int main (int argc, char* argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_split();
+    test_small_array();
+    test_large();
+
+    done_testing();
+}
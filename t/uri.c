@@ -56,12 +56,31 @@ static void test_decode(void) {
     buffer_destroy(&b);
 }
 
+static void test_decode_invalid(void) {
+    static const char* data[] = {
+        "100%",
+        "bad %zz escape",
+        "short %2",
+    };
+
+    Buffer b; buffer_build(&b);
+    for (unsigned int j = 0; j < ALEN(data); ++j) {
+        Slice encoded = slice_from_string(data[j], 0);
+        buffer_set_to_slice(&b, slice_from_string("prefix", 0), 0);
+        uint32_t len = uri_decode(encoded, &b);
+        ok(len == 0, "Could not URI decode invalid [%s]", data[j]);
+        ok(slice_equal(buffer_slice(&b), slice_from_string("prefix", 0)), "Invalid [%s] left buffer untouched", data[j]);
+    }
+    buffer_destroy(&b);
+}
+
 int main (int argc, char* argv[]) {
     (void) argc;
     (void) argv;
 
     test_encode();
     test_decode();
+    test_decode_invalid();
 
     done_testing();
 }